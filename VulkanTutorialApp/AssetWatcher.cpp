@@ -0,0 +1,105 @@
+#include "AssetWatcher.h"
+#include "CpuProfiler.h"
+
+AssetWatcher::AssetWatcher()
+{
+	lastScan = std::chrono::steady_clock::now();
+}
+
+void AssetWatcher::watch(AssetKind kind, const std::string& name, const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const WatchedFile& file : files)
+	{
+		if (file.path == path) return;
+	}
+
+	WatchedFile file;
+	file.kind = kind;
+	file.name = name;
+	file.path = path;
+	file.lastWriteTime = getWriteTime(path);
+	files.push_back(file);
+}
+
+void AssetWatcher::update()
+{
+	if (scanInFlight.pending.load() > 0) return;
+
+	auto now = std::chrono::steady_clock::now();
+	if (std::chrono::duration<double, std::milli>(now - lastScan).count() < HOT_RELOAD_POLL_INTERVAL_MS) return;
+	lastScan = now;
+
+	JobSystem::run([this]() { scan(); }, &scanInFlight);
+}
+
+std::vector<AssetChange> AssetWatcher::takeChanges()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<AssetChange> result = std::move(changes);
+	changes.clear();
+	return result;
+}
+
+void AssetWatcher::stop()
+{
+	JobSystem::wait(scanInFlight);
+}
+
+// Only this job reads the write times, the file list is copied so watch() never waits for the file system
+void AssetWatcher::scan()
+{
+	CPU_PROFILE_ZONE("AssetWatcher::scan");
+
+	std::vector<std::string> paths;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		paths.reserve(files.size());
+		for (const WatchedFile& file : files)
+		{
+			paths.push_back(file.path);
+		}
+	}
+
+	std::vector<std::filesystem::file_time_type> writeTimes(paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		writeTimes[i] = getWriteTime(paths[i]);
+	}
+
+	// Files only get appended, the first paths.size() entries are the ones scanned
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		WatchedFile& file = files[i];
+		if (writeTimes[i] == file.lastWriteTime || writeTimes[i] == std::filesystem::file_time_type::min())
+		{
+			file.pending = false;
+			continue;
+		}
+
+		if (file.pending && writeTimes[i] == file.pendingWriteTime)
+		{
+			file.lastWriteTime = writeTimes[i];
+			file.pending = false;
+			changes.push_back({ file.kind, file.name });
+			continue;
+		}
+
+		file.pending = true;
+		file.pendingWriteTime = writeTimes[i];
+	}
+}
+
+// file_time_type::min() when the file can't be read (missing, being replaced)
+std::filesystem::file_time_type AssetWatcher::getWriteTime(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	return error ? std::filesystem::file_time_type::min() : writeTime;
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	stop();
+}
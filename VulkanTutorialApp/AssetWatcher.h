@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include "JobSystem.h"
+#include "Utility.h"
+
+// A watched file whose modification time changed
+struct AssetChange {
+	AssetKind kind;
+	std::string name;						// File name the renderer knows the asset by (import mesh / texture / shader file name)
+};
+
+// Polls the modification time of the watched files (std::filesystem, no OS notification API) every HOT_RELOAD_POLL_INTERVAL_MS.
+// The scan runs as a job so big scenes don't stall the render thread. A change is only reported once the time is the same
+// on 2 scans in a row, so a file still being written by an editor isn't picked up half way
+class AssetWatcher
+{
+public:
+	AssetWatcher();
+
+	// Watching a path twice is a no-op, a file missing now is picked up once it appears
+	void watch(AssetKind kind, const std::string& name, const std::string& path);
+	// Render thread, once per frame: starts a scan when the interval has passed and the previous one is done
+	void update();
+	// Changes found by the scans since the last call
+	std::vector<AssetChange> takeChanges();
+	// Waits for the scan in flight
+	void stop();
+
+	~AssetWatcher();
+
+private:
+	struct WatchedFile {
+		AssetKind kind;
+		std::string name;
+		std::string path;
+		std::filesystem::file_time_type lastWriteTime;			// Last reported (or seen when watch() was called)
+		std::filesystem::file_time_type pendingWriteTime;		// Seen on the last scan, not stable yet
+		bool pending = false;
+	};
+
+	std::mutex mutex;							// Guards files and changes, the scan runs on a job
+	std::vector<WatchedFile> files;
+	std::vector<AssetChange> changes;
+
+	JobCounter scanInFlight;
+	std::chrono::steady_clock::time_point lastScan;
+
+	void scan();
+	static std::filesystem::file_time_type getWriteTime(const std::string& path);
+};
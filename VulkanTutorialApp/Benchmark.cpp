@@ -0,0 +1,298 @@
+#define STB_IMAGE_IMPLEMENTATION	// Need this define to activate stb library
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // opengl the depth value (-1.0, 1.0), in vulkan it's (0.0, 1.0)
+
+// End to end frame benchmark: a grid of houses, a scripted camera and a fixed frame count, results written to JSON.
+// Everything is driven by the frame index (fixed timestep, seeded transforms), so 2 runs on the same box render the same frames
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#include "VulkanRenderer.h"
+
+const char* const BENCHMARK_MESH_FILE = "Old House 2 3D Models.obj";
+const float BENCHMARK_TIMESTEP = 1.0f / 60.0f;			// Seconds of scene time per frame, independent of the real frame time
+const float BENCHMARK_GRID_SPACING = 12.0f;				// Distance between 2 houses of the grid
+
+struct BenchmarkConfig {
+	uint32_t houseCount = 16;
+	uint32_t frameCount = 1000;
+	uint32_t warmupFrames = 100;						// Not measured: pipeline / driver warm up, first uploads
+	uint32_t seed = 1;
+	uint32_t width = 1600;
+	uint32_t height = 900;
+	bool windowed = false;								// Hidden window by default
+	uint32_t workerCount = 0;							// Job system workers, 0 = hardware threads - 1
+	bool pinThreads = false;
+	bool batchMeshes = false;							// ImportOptions::batchByTexture, compare draw_count with and without
+	bool packTextures = false;							// ImportOptions::packTextures, compare texture_binds with and without
+	bool depthPrepass = false;							// Depth pre-pass before subpass 0, compare fs_invocations with and without
+	bool pipelineStatistics = false;					// fs_invocations per pass, when the device supports pipeline statistics queries
+	LatencyProfile latencyProfile = LATENCY_PROFILE_THROUGHPUT;	// Not capped by vsync when the device allows it
+	std::string outputFile = "benchmark.json";
+};
+
+GLFWwindow* window;
+VulkanRenderer vulkanRenderer;
+std::vector<glm::mat4> houseTransforms;					// Seeded placement of every house, animated from the frame index
+
+// --name=value arguments, anything unknown is ignored
+BenchmarkConfig parseArguments(int argc, char** argv) {
+	BenchmarkConfig config;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		size_t equals = arg.find('=');
+		std::string name = arg.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+		if (name == "--houses") config.houseCount = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--frames") config.frameCount = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--warmup") config.warmupFrames = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--seed") config.seed = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--width") config.width = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--height") config.height = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--windowed") config.windowed = true;
+		else if (name == "--workers") config.workerCount = static_cast<uint32_t>(std::stoul(value));
+		else if (name == "--pin-threads") config.pinThreads = true;
+		else if (name == "--batch-meshes") config.batchMeshes = true;
+		else if (name == "--pack-textures") config.packTextures = true;
+		else if (name == "--depth-prepass") config.depthPrepass = true;
+		else if (name == "--pipeline-stats") config.pipelineStatistics = true;
+		else if (name == "--output") config.outputFile = value;
+		else if (arg == "--latency=low") config.latencyProfile = LATENCY_PROFILE_LOW_LATENCY;
+		else if (arg == "--latency=default") config.latencyProfile = LATENCY_PROFILE_DEFAULT;
+	}
+
+	// 1 dynamic uniform slot per import mesh
+	if (config.houseCount == 0 || config.houseCount > MAX_OBJECTS) {
+		config.houseCount = std::min<uint32_t>(std::max<uint32_t>(config.houseCount, 1), MAX_OBJECTS);
+		printf("Benchmark: house count clamped to %u\n", config.houseCount);
+	}
+	if (config.frameCount == 0) config.frameCount = 1;
+	return config;
+}
+
+void initWindow(const BenchmarkConfig& config) {
+	glfwInit();
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);						// A resize would change the workload mid run
+	glfwWindowHint(GLFW_VISIBLE, config.windowed ? GLFW_TRUE : GLFW_FALSE);
+
+	window = glfwCreateWindow(config.width, config.height, "Benchmark", nullptr, nullptr);
+	if (!window) {
+		throw std::runtime_error("Failed to create the benchmark window!");
+	}
+}
+
+// Houses on a square grid centered on the origin, each with a seeded yaw and scale
+void createScene(const BenchmarkConfig& config) {
+	std::mt19937 random(config.seed);
+	std::uniform_real_distribution<float> yawDistribution(0.0f, 360.0f);
+	std::uniform_real_distribution<float> scaleDistribution(0.08f, 0.12f);
+
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(config.houseCount))));
+	float gridOffset = (gridSize - 1) * BENCHMARK_GRID_SPACING * 0.5f;
+
+	for (uint32_t i = 0; i < config.houseCount; i++) {
+		glm::vec3 position((i % gridSize) * BENCHMARK_GRID_SPACING - gridOffset, 0.0f,
+			(i / gridSize) * BENCHMARK_GRID_SPACING - gridOffset);
+		glm::mat4 translate = glm::translate(glm::mat4(1.0f), position);
+		glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), glm::radians(yawDistribution(random)), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 scale = glm::scale(glm::mat4(1.0f), glm::vec3(scaleDistribution(random)));
+		houseTransforms.push_back(translate * rotate * scale);
+
+		vulkanRenderer.addNCreateImportMesh(BENCHMARK_MESH_FILE, houseTransforms.back());
+	}
+}
+
+// Scripted scene state of a frame: the camera orbits the grid while bobbing up and down, every house spins slowly
+void updateScene(uint32_t frameIndex, const BenchmarkConfig& config) {
+	float time = frameIndex * BENCHMARK_TIMESTEP;
+
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(config.houseCount))));
+	float radius = gridSize * BENCHMARK_GRID_SPACING * 0.75f + 10.0f;
+	glm::vec3 eye(radius * std::cos(time * 0.2f), 8.0f + 4.0f * std::sin(time * 0.5f), radius * std::sin(time * 0.2f));
+
+	VkExtent2D extent = vulkanRenderer.getSwapChainExtent();
+	glm::mat4 projectionMat = glm::perspective(glm::radians(45.0f), (float)extent.width / (float)extent.height, 0.1f, 500.0f);
+	projectionMat[1][1] *= -1;
+	glm::mat4 viewMat = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	vulkanRenderer.setViewProjectionMat(viewMat, projectionMat);
+
+	glm::mat4 spin = glm::rotate(glm::mat4(1.0f), time * 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
+	for (size_t i = 0; i < houseTransforms.size(); i++) {
+		vulkanRenderer.updateModel(static_cast<int>(i), houseTransforms[i] * spin);
+	}
+}
+
+// "name": { "p50": .., "p95": .., "p99": .. } from an ascending sorted list
+void writePercentiles(std::ofstream& file, const char* name, const std::vector<double>& sorted) {
+	char line[192];
+	snprintf(line, sizeof(line), "    \"%s\": { \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f },\n", name,
+		percentileOfSorted(sorted, 50.0), percentileOfSorted(sorted, 95.0), percentileOfSorted(sorted, 99.0));
+	file << line;
+}
+
+void writeResults(const BenchmarkConfig& config, std::vector<double> frameMs, uint32_t drawCount, uint32_t prepassDrawCount,
+	uint32_t textureBindCount) {
+	std::sort(frameMs.begin(), frameMs.end());
+
+	double totalMs = 0.0;
+	for (double ms : frameMs) totalMs += ms;
+
+	std::ofstream file(config.outputFile, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + config.outputFile + " for writing!");
+	}
+
+	char line[256];
+	file << "{\n";
+	file << "  \"device\": \"" << escapeJson(vulkanRenderer.getDeviceName()) << "\",\n";
+#ifdef NDEBUG
+	file << "  \"build\": \"release\",\n";
+#else
+	file << "  \"build\": \"debug\",\n";
+#endif
+	// frames: measured frames, fewer than --frames when the window was closed early
+	snprintf(line, sizeof(line), "  \"config\": { \"houses\": %u, \"frames\": %zu, \"warmup\": %u, \"seed\": %u, \"width\": %u, \"height\": %u, \"windowed\": %s, \"workers\": %u, \"pinned\": %s, \"batched\": %s, \"packed\": %s, \"depth_prepass\": %s },\n",
+		config.houseCount, frameMs.size(), config.warmupFrames, config.seed, config.width, config.height, config.windowed ? "true" : "false",
+		JobSystem::getWorkerCount(), config.pinThreads ? "true" : "false", config.batchMeshes ? "true" : "false",
+		config.packTextures ? "true" : "false", config.depthPrepass ? "true" : "false");
+	file << line;
+
+	file << "  \"cpu\": {\n";
+	snprintf(line, sizeof(line), "    \"frame_ms_avg\": %.4f,\n", totalMs / frameMs.size());
+	file << line;
+	writePercentiles(file, "frame_ms", frameMs);
+	// FPS percentiles are taken from the slow end: p99 FPS is the frame rate of the 1% slowest frames
+	snprintf(line, sizeof(line), "    \"fps\": { \"p50\": %.2f, \"p95\": %.2f, \"p99\": %.2f },\n",
+		1000.0 / percentileOfSorted(frameMs, 50.0), 1000.0 / percentileOfSorted(frameMs, 95.0), 1000.0 / percentileOfSorted(frameMs, 99.0));
+	file << line;
+	snprintf(line, sizeof(line), "    \"fps_avg\": %.2f\n  },\n", 1000.0 * frameMs.size() / totalMs);
+	file << line;
+
+	// GPU time of the same measured frames as the CPU stats, null when the queue can't write timestamps
+	GpuStatSummary gpuFrame;
+	if (vulkanRenderer.getGpuStats("Frame", gpuFrame)) {
+		snprintf(line, sizeof(line), "  \"gpu_frame_ms\": { \"avg\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"frames\": %zu },\n",
+			gpuFrame.avg, gpuFrame.p50, gpuFrame.p95, gpuFrame.p99, gpuFrame.sampleCount);
+		file << line;
+	}
+	else {
+		file << "  \"gpu_frame_ms\": null,\n";
+	}
+
+	snprintf(line, sizeof(line), "  \"draw_count\": %u,\n", drawCount);
+	file << line;
+	snprintf(line, sizeof(line), "  \"depth_prepass_draw_count\": %u,\n", prepassDrawCount);
+	file << line;
+	snprintf(line, sizeof(line), "  \"texture_binds\": %u,\n", textureBindCount);
+	file << line;
+
+	// Fragment shader invocations per frame (avg), null without --pipeline-stats or when the pass didn't run
+	file << "  \"fs_invocations\": {";
+	const char* statisticsPasses[][2] = { { "depth_prepass", "Depth pre-pass" }, { "subpass0", "Subpass 0" }, { "subpass1", "Subpass 1" } };
+	for (size_t i = 0; i < 3; i++) {
+		GpuStatSummary invocations;
+		if (vulkanRenderer.getGpuStats(std::string(statisticsPasses[i][1]) + " FS invocations", invocations)) {
+			snprintf(line, sizeof(line), "%s \"%s\": %.0f", i == 0 ? "" : ",", statisticsPasses[i][0], invocations.avg);
+		}
+		else {
+			snprintf(line, sizeof(line), "%s \"%s\": null", i == 0 ? "" : ",", statisticsPasses[i][0]);
+		}
+		file << line;
+	}
+	file << " },\n";
+
+	// Memory at the end of the run, with the peaks
+	MemorySnapshot memory = MemoryTracker::getSnapshot();
+	file << "  \"memory_mib\": {\n";
+	for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++) {
+		snprintf(line, sizeof(line), "    \"%s\": { \"current\": %.2f, \"peak\": %.2f },\n",
+			MemoryTracker::getCategoryName(static_cast<MemoryCategory>(c)),
+			memory.categories[c].currentBytes / (1024.0 * 1024.0), memory.categories[c].peakBytes / (1024.0 * 1024.0));
+		file << line;
+	}
+	file << "    \"heaps\": [";
+	for (size_t i = 0; i < memory.heaps.size(); i++) {
+		snprintf(line, sizeof(line), "%s{ \"usage\": %.2f, \"budget\": %.2f, \"tracked_peak\": %.2f }", i == 0 ? "" : ", ",
+			memory.heaps[i].usage / (1024.0 * 1024.0), memory.heaps[i].budget / (1024.0 * 1024.0),
+			memory.heaps[i].tracked.peakBytes / (1024.0 * 1024.0));
+		file << line;
+	}
+	file << "]\n  }\n}\n";
+	file.close();
+
+	printf("Benchmark: %zu frames, CPU frame p50 %.3f ms / p99 %.3f ms, results written to %s\n", frameMs.size(),
+		percentileOfSorted(frameMs, 50.0), percentileOfSorted(frameMs, 99.0), config.outputFile.c_str());
+}
+
+int main(int argc, char** argv) {
+	bool rendererInitialised = false;
+	try {
+		// std::stoul throws on a malformed value
+		BenchmarkConfig config = parseArguments(argc, argv);
+		JobSystem::init(config.workerCount, config.pinThreads);
+
+		initWindow(config);
+		vulkanRenderer.setLatencyProfile(config.latencyProfile);
+		ImportOptions importOptions;
+		importOptions.batchByTexture = config.batchMeshes;
+		importOptions.packTextures = config.packTextures;
+		vulkanRenderer.setImportOptions(importOptions);
+		vulkanRenderer.setDepthPrepass(config.depthPrepass);
+		vulkanRenderer.setPipelineStatistics(config.pipelineStatistics);
+		if (vulkanRenderer.init(window) == EXIT_FAILURE) {
+			throw std::runtime_error("Renderer init failed!");
+		}
+		rendererInitialised = true;
+		createScene(config);
+
+		// Same loop as the app, the scene time comes from the frame index instead of getDeltaTime()
+		std::vector<double> frameMs;
+		frameMs.reserve(config.frameCount);
+		uint32_t totalFrames = config.warmupFrames + config.frameCount;
+		for (uint32_t frame = 0; frame < totalFrames && !glfwWindowShouldClose(window); frame++) {
+			auto frameStart = std::chrono::steady_clock::now();
+
+			vulkanRenderer.waitForFrameSlot();
+			if (frame == config.warmupFrames) {
+				vulkanRenderer.resetGpuStats(config.frameCount);		// Warm-up frames stay out of the GPU stats too
+			}
+			glfwPollEvents();
+			vulkanRenderer.markInputSampled();
+			updateScene(frame, config);
+			vulkanRenderer.draw();
+
+			if (frame >= config.warmupFrames) {
+				frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+			}
+		}
+
+		if (!frameMs.empty()) {
+			vulkanRenderer.collectGpuStats();
+			writeResults(config, frameMs, vulkanRenderer.getDrawCount(), vulkanRenderer.getDepthPrepassDrawCount(),
+				vulkanRenderer.getTextureBindCount());
+		}
+		rendererInitialised = false;
+		vulkanRenderer.cleanup();
+	}
+	catch (const std::exception& e) {
+		printf("Benchmark ERROR: %s\n", e.what());
+		if (rendererInitialised) {
+			vulkanRenderer.cleanup();
+		}
+		JobSystem::shutdown();
+		return EXIT_FAILURE;
+	}
+	JobSystem::shutdown();
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}
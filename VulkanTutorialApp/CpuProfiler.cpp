@@ -0,0 +1,197 @@
+#include "CpuProfiler.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include "Utility.h"
+
+struct CpuZoneEvent {
+	const char* name;
+	uint64_t startNs;
+	uint64_t endNs;
+	uint32_t depth;				// Nesting level on its thread, 0 = outermost
+};
+
+// Written by one thread only, read on export
+struct CpuThreadRing {
+	uint32_t threadIndex;
+	std::atomic<uint64_t> written;							// Events ever written, the ring keeps the last CPU_PROFILER_RING_SIZE
+	std::unique_ptr<CpuZoneEvent[]> events;
+};
+
+static const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+static std::mutex ringRegistryMutex;							// Only taken the first time a thread records
+static std::vector<std::unique_ptr<CpuThreadRing>> ringRegistry;	// Rings outlive their threads so the import workers show up in the export
+static thread_local CpuThreadRing* threadRing = nullptr;
+static thread_local uint32_t threadDepth = 0;
+
+static CpuThreadRing* getThreadRing()
+{
+	if (threadRing == nullptr)
+	{
+		std::unique_ptr<CpuThreadRing> ring(new CpuThreadRing());
+		ring->written.store(0);
+		ring->events.reset(new CpuZoneEvent[CPU_PROFILER_RING_SIZE]);
+
+		std::lock_guard<std::mutex> lock(ringRegistryMutex);
+		ring->threadIndex = static_cast<uint32_t>(ringRegistry.size());
+		threadRing = ring.get();
+		ringRegistry.push_back(std::move(ring));
+	}
+	return threadRing;
+}
+
+// Copy of the events still in every ring, ordered by start time per thread
+static std::vector<std::vector<CpuZoneEvent>> snapshotRings()
+{
+	std::lock_guard<std::mutex> lock(ringRegistryMutex);
+
+	std::vector<std::vector<CpuZoneEvent>> threads(ringRegistry.size());
+	for (size_t t = 0; t < ringRegistry.size(); t++)
+	{
+		const CpuThreadRing& ring = *ringRegistry[t];
+		uint64_t written = ring.written.load(std::memory_order_acquire);
+		uint64_t count = std::min<uint64_t>(written, CPU_PROFILER_RING_SIZE);
+
+		threads[t].reserve(static_cast<size_t>(count));
+		for (uint64_t i = written - count; i < written; i++)
+		{
+			threads[t].push_back(ring.events[i % CPU_PROFILER_RING_SIZE]);
+		}
+
+		// Zones are recorded when they end, so children come before their parent
+		std::sort(threads[t].begin(), threads[t].end(), [](const CpuZoneEvent& a, const CpuZoneEvent& b) {
+			return a.startNs != b.startNs ? a.startNs < b.startNs : a.depth < b.depth;
+		});
+	}
+	return threads;
+}
+
+uint64_t cpuProfilerNow()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - profilerEpoch).count());
+}
+
+void CpuProfiler::record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth)
+{
+	CpuThreadRing* ring = getThreadRing();
+	uint64_t written = ring->written.load(std::memory_order_relaxed);
+	CpuZoneEvent& event = ring->events[written % CPU_PROFILER_RING_SIZE];
+	event.name = name;
+	event.startNs = startNs;
+	event.endNs = endNs;
+	event.depth = depth;
+	ring->written.store(written + 1, std::memory_order_release);		// Publish the event to the exporter
+}
+
+void CpuProfiler::exportChromeTrace(const std::string& fileName)
+{
+	std::vector<std::vector<CpuZoneEvent>> threads = snapshotRings();
+
+	size_t eventCount = 0;
+	for (const auto& events : threads) eventCount += events.size();
+	if (eventCount == 0) return;
+
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("CPU profiler: failed to open %s for writing\n", fileName.c_str());
+		return;
+	}
+
+	// Complete events ("ph":"X"), tid = order in which the threads first recorded (0 is the main thread)
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		for (const CpuZoneEvent& event : threads[t])
+		{
+			char line[160];
+			snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}",
+				t, event.startNs * 1e-3, (event.endNs - event.startNs) * 1e-3);
+			file << (first ? "" : ",\n") << "{\"name\":\"" << escapeJson(event.name) << line;
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+	file.close();
+
+	printf("CPU profiler: %zu zones written to %s\n", eventCount, fileName.c_str());
+}
+
+void CpuProfiler::exportFoldedStacks(const std::string& fileName)
+{
+	std::vector<std::vector<CpuZoneEvent>> threads = snapshotRings();
+
+	// Self time of every distinct stack, summed over all threads
+	std::map<std::string, uint64_t> stackSelfNs;
+	for (const auto& events : threads)
+	{
+		std::vector<std::string> paths(events.size());
+		std::vector<int64_t> selfNs(events.size());
+		std::vector<size_t> openZones;				// Index of the enclosing zone at each depth
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			const CpuZoneEvent& event = events[i];
+			int64_t duration = static_cast<int64_t>(event.endNs - event.startNs);
+			selfNs[i] = duration;
+
+			// Close the zones that ended before this one, parents lost to the ring wrapping around are simply missing from the stack
+			while (!openZones.empty() && (openZones.size() > event.depth || events[openZones.back()].endNs < event.endNs))
+			{
+				openZones.pop_back();
+			}
+			if (!openZones.empty() && openZones.size() == event.depth)
+			{
+				size_t parent = openZones.back();
+				selfNs[parent] -= duration;
+				paths[i] = paths[parent] + ";" + event.name;
+			}
+			else
+			{
+				paths[i] = event.name;
+			}
+			openZones.push_back(i);
+		}
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			stackSelfNs[paths[i]] += static_cast<uint64_t>(std::max<int64_t>(selfNs[i], 0));
+		}
+	}
+	if (stackSelfNs.empty()) return;
+
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("CPU profiler: failed to open %s for writing\n", fileName.c_str());
+		return;
+	}
+	for (const auto& stack : stackSelfNs)
+	{
+		file << stack.first << " " << (stack.second / 1000) << "\n";
+	}
+	file.close();
+
+	printf("CPU profiler: %zu stacks written to %s\n", stackSelfNs.size(), fileName.c_str());
+}
+
+CpuProfileScope::CpuProfileScope(const char* newName)
+{
+	name = newName;
+	depth = threadDepth++;
+	startNs = cpuProfilerNow();
+}
+
+CpuProfileScope::~CpuProfileScope()
+{
+	uint64_t endNs = cpuProfilerNow();
+	threadDepth--;
+	CpuProfiler::record(name, startNs, endNs, depth);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Scoped CPU zones: CPU_PROFILE_ZONE("name") times the enclosing scope. The name has to be a string literal (only the pointer is kept).
+// Compiled out entirely when ENABLE_CPU_PROFILER is not defined (Release configurations), the exports then write nothing
+#ifdef ENABLE_CPU_PROFILER
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_ZONE(name) CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#else
+#define CPU_PROFILE_ZONE(name)
+#endif
+
+// Nanoseconds on the steady (monotonic) clock since the profiler epoch
+uint64_t cpuProfilerNow();
+
+// Records zones into a ring per thread: only the owning thread writes its ring, so recording takes no lock.
+// Exporting reads every ring, call it once the worker threads are done (e.g. on shutdown)
+class CpuProfiler
+{
+public:
+	// Called by CpuProfileScope
+	static void record(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth);
+
+	// Chrome trace (chrome://tracing, Perfetto), 1 track per thread
+	static void exportChromeTrace(const std::string& fileName);
+	// Folded stacks ("Frame;draw;recordCommands 1234", self time in microseconds) for flamegraph.pl / speedscope
+	static void exportFoldedStacks(const std::string& fileName);
+};
+
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char* newName);
+	~CpuProfileScope();
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	const char* name;
+	uint64_t startNs;
+	uint32_t depth;
+};
@@ -0,0 +1,67 @@
+#include "DebugUtils.h"
+
+static PFN_vkSetDebugUtilsObjectNameEXT setObjectNameFunc = nullptr;
+static PFN_vkCmdBeginDebugUtilsLabelEXT beginLabelFunc = nullptr;
+static PFN_vkCmdEndDebugUtilsLabelEXT endLabelFunc = nullptr;
+
+void DebugUtils::load(VkInstance instance, bool extensionEnabled)
+{
+	unload();
+	if (!extensionEnabled) return;
+
+	// Instance level extension, looked up through the instance even for device commands
+	setObjectNameFunc = (PFN_vkSetDebugUtilsObjectNameEXT)vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT");
+	beginLabelFunc = (PFN_vkCmdBeginDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT");
+	endLabelFunc = (PFN_vkCmdEndDebugUtilsLabelEXT)vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT");
+
+	// All or nothing, so begin / end labels can't get out of step
+	if (setObjectNameFunc == nullptr || beginLabelFunc == nullptr || endLabelFunc == nullptr)
+	{
+		unload();
+	}
+}
+
+void DebugUtils::unload()
+{
+	setObjectNameFunc = nullptr;
+	beginLabelFunc = nullptr;
+	endLabelFunc = nullptr;
+}
+
+bool DebugUtils::isEnabled()
+{
+	return setObjectNameFunc != nullptr;
+}
+
+void DebugUtils::setObjectName(VkDevice device, VkObjectType objectType, uint64_t handle, const char* name)
+{
+	if (setObjectNameFunc == nullptr || handle == 0) return;
+
+	VkDebugUtilsObjectNameInfoEXT nameInfo = {};
+	nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+	nameInfo.objectType = objectType;
+	nameInfo.objectHandle = handle;
+	nameInfo.pObjectName = name;
+	setObjectNameFunc(device, &nameInfo);
+}
+
+void DebugUtils::beginLabel(VkCommandBuffer commandBuffer, const char* name, float red, float green, float blue)
+{
+	if (beginLabelFunc == nullptr) return;
+
+	VkDebugUtilsLabelEXT label = {};
+	label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+	label.pLabelName = name;
+	label.color[0] = red;
+	label.color[1] = green;
+	label.color[2] = blue;
+	label.color[3] = 1.0f;
+	beginLabelFunc(commandBuffer, &label);
+}
+
+void DebugUtils::endLabel(VkCommandBuffer commandBuffer)
+{
+	if (endLabelFunc == nullptr) return;
+
+	endLabelFunc(commandBuffer);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <string>
+
+// VK_EXT_debug_utils object names and command buffer labels, read by capture tools (gfxreconstruct, RenderDoc) and the validation layers.
+// The entry points stay null when the extension isn't enabled on the instance, every call is then an early return.
+// Only requested when ENABLE_DEBUG_UTILS is defined (Debug configurations), Release builds never enable it
+class DebugUtils
+{
+public:
+	// extensionEnabled: VK_EXT_debug_utils is in the instance's enabled extensions
+	static void load(VkInstance instance, bool extensionEnabled);
+	static void unload();
+	// Check this before building a name string, so nothing is allocated when the extension is absent
+	static bool isEnabled();
+
+	// Handle is any Vulkan handle (pointer on 64 bit, uint64_t on 32 bit)
+	template <typename Handle>
+	static void setObjectName(VkDevice device, VkObjectType objectType, Handle handle, const std::string& name)
+	{
+		if (!isEnabled()) return;
+		setObjectName(device, objectType, (uint64_t)handle, name.c_str());
+	}
+	template <typename Handle>
+	static void setObjectName(VkDevice device, VkObjectType objectType, Handle handle, const char* name)
+	{
+		if (!isEnabled()) return;
+		setObjectName(device, objectType, (uint64_t)handle, name);
+	}
+	static void setObjectName(VkDevice device, VkObjectType objectType, uint64_t handle, const char* name);
+
+	// Regions in the command buffer, begin / end pairs have to match within the command buffer
+	static void beginLabel(VkCommandBuffer commandBuffer, const char* name, float red, float green, float blue);
+	static void endLabel(VkCommandBuffer commandBuffer);
+};
@@ -0,0 +1,351 @@
+#include "GpuProfiler.h"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+GpuProfiler::GpuProfiler()
+{
+}
+
+GpuProfiler::GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t newFrameCount,
+	bool enablePipelineStatistics)
+{
+	device = newDevice;
+
+	// Timestamps are only usable when the queue reports valid bits
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+	uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+	if (validBits == 0)
+	{
+		printf("GPU profiler: queue family %u can't write timestamps, disabled\n", queueFamilyIndex);
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+	// 1 range of GPU_PROFILER_MAX_QUERIES per frame in flight
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = GPU_PROFILER_MAX_QUERIES * newFrameCount;
+
+	VkResult result = vkCreateQueryPool(device, &queryPoolCreateInfo, nullptr, &queryPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Timestamp Query Pool!");
+	}
+
+	// Pipeline statistics: a handful of scopes per frame (one per subpass), read back with the timestamps
+	if (enablePipelineStatistics)
+	{
+		VkQueryPoolCreateInfo statisticsPoolCreateInfo = {};
+		statisticsPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		statisticsPoolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		statisticsPoolCreateInfo.queryCount = GPU_PROFILER_MAX_STATISTICS * newFrameCount;
+		statisticsPoolCreateInfo.pipelineStatistics = GPU_PROFILER_STATISTICS_FLAGS;
+
+		result = vkCreateQueryPool(device, &statisticsPoolCreateInfo, nullptr, &statisticsQueryPool);
+		if (result != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Pipeline Statistics Query Pool!");
+		}
+	}
+
+	frames.resize(newFrameCount);
+	results.resize(std::max<size_t>(GPU_PROFILER_MAX_QUERIES, GPU_PROFILER_MAX_STATISTICS * GPU_PROFILER_STATISTICS_COUNT));
+	enabled = true;
+}
+
+bool GpuProfiler::isEnabled()
+{
+	return enabled;
+}
+
+void GpuProfiler::setProfileDrawGroups(bool enabled)
+{
+	profileDrawGroups = enabled;
+}
+
+bool GpuProfiler::getProfileDrawGroups()
+{
+	return enabled && profileDrawGroups;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t pixelCount)
+{
+	if (!enabled) return;
+
+	collect(frameIndex);
+	collectStatistics(frameIndex);
+
+	currentFrame = frameIndex;
+	FrameQueries& frame = frames[frameIndex];
+	frame.zones.clear();
+	frame.statistics.clear();
+	frame.queryCount = 0;
+	frame.pixelCount = pixelCount;
+	frame.pending = true;
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex * GPU_PROFILER_MAX_QUERIES, GPU_PROFILER_MAX_QUERIES);
+	if (statisticsQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, frameIndex * GPU_PROFILER_MAX_STATISTICS, GPU_PROFILER_MAX_STATISTICS);
+	}
+}
+
+uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const std::string& name)
+{
+	if (!enabled) return UINT32_MAX;
+
+	// Out of queries for this frame: the zone is dropped
+	FrameQueries& frame = frames[currentFrame];
+	if (frame.queryCount + 2 > GPU_PROFILER_MAX_QUERIES) return UINT32_MAX;
+
+	Zone zone;
+	zone.name = name;
+	zone.beginQuery = frame.queryCount++;
+	zone.endQuery = UINT32_MAX;
+	frame.zones.push_back(zone);
+
+	// Top of pipe: the timestamp is written once every earlier command has started
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool,
+		currentFrame * GPU_PROFILER_MAX_QUERIES + zone.beginQuery);
+	return static_cast<uint32_t>(frame.zones.size() - 1);
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zoneId)
+{
+	if (!enabled || zoneId == UINT32_MAX) return;
+
+	// Bottom of pipe: written once every earlier command has finished
+	FrameQueries& frame = frames[currentFrame];
+	Zone& zone = frame.zones[zoneId];
+	zone.endQuery = frame.queryCount++;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool,
+		currentFrame * GPU_PROFILER_MAX_QUERIES + zone.endQuery);
+}
+
+uint32_t GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer, const std::string& name)
+{
+	if (!enabled || statisticsQueryPool == VK_NULL_HANDLE) return UINT32_MAX;
+
+	FrameQueries& frame = frames[currentFrame];
+	if (frame.statistics.size() >= GPU_PROFILER_MAX_STATISTICS) return UINT32_MAX;
+
+	uint32_t statisticsId = static_cast<uint32_t>(frame.statistics.size());
+	frame.statistics.push_back(name);
+	vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame * GPU_PROFILER_MAX_STATISTICS + statisticsId, 0);
+	return statisticsId;
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer, uint32_t statisticsId)
+{
+	if (!enabled || statisticsId == UINT32_MAX) return;
+
+	vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame * GPU_PROFILER_MAX_STATISTICS + statisticsId);
+}
+
+void GpuProfiler::addSample(const std::string& name, double value, const char* unit)
+{
+	StatHistory& stat = history[name];
+	stat.unit = unit;
+	if (stat.samples.size() < historySize)
+	{
+		stat.samples.push_back(value);
+	}
+	else
+	{
+		stat.samples[stat.next] = value;
+		stat.next = (stat.next + 1) % historySize;
+	}
+}
+
+void GpuProfiler::collect(uint32_t frameIndex)
+{
+	FrameQueries& frame = frames[frameIndex];
+	if (!frame.pending || frame.queryCount == 0) return;
+	frame.pending = false;
+
+	// The frame's fence signalled before its slot is reused, no WAIT flag needed. NOT_READY only if it never got submitted
+	VkResult result = vkGetQueryPoolResults(device, queryPool, frameIndex * GPU_PROFILER_MAX_QUERIES, frame.queryCount,
+		sizeof(uint64_t) * frame.queryCount, results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) return;
+
+	for (const Zone& zone : frame.zones)
+	{
+		if (zone.endQuery == UINT32_MAX) continue;
+
+		uint64_t begin = results[zone.beginQuery] & timestampMask;
+		uint64_t end = results[zone.endQuery] & timestampMask;
+		double durationMs = static_cast<double>((end - begin) & timestampMask) * timestampPeriod * 1e-6;
+
+		addSample(zone.name, durationMs, "ms");
+
+		// Trace, relative to the first timestamp ever read
+		if (!traceOriginSet)
+		{
+			traceOrigin = begin;
+			traceOriginSet = true;
+		}
+		TraceEvent event;
+		event.name = zone.name;
+		event.startUs = static_cast<double>((begin - traceOrigin) & timestampMask) * timestampPeriod * 1e-3;
+		event.durationUs = durationMs * 1e3;
+		traceEvents.push_back(event);
+		if (traceEvents.size() > GPU_PROFILER_TRACE_EVENTS) traceEvents.pop_front();
+	}
+}
+
+void GpuProfiler::collectStatistics(uint32_t frameIndex)
+{
+	// Names are cleared once read, so a slot's statistics are only collected once
+	FrameQueries& frame = frames[frameIndex];
+	if (statisticsQueryPool == VK_NULL_HANDLE || frame.statistics.empty()) return;
+
+	uint32_t queryCount = static_cast<uint32_t>(frame.statistics.size());
+	VkDeviceSize stride = sizeof(uint64_t) * GPU_PROFILER_STATISTICS_COUNT;
+	VkResult result = vkGetQueryPoolResults(device, statisticsQueryPool, frameIndex * GPU_PROFILER_MAX_STATISTICS, queryCount,
+		stride * queryCount, results.data(), stride, VK_QUERY_RESULT_64_BIT);
+	std::vector<std::string> names;
+	names.swap(frame.statistics);
+	if (result != VK_SUCCESS) return;
+
+	for (uint32_t i = 0; i < queryCount; i++)
+	{
+		// Counters come in the bit order of GPU_PROFILER_STATISTICS_FLAGS
+		const uint64_t* counters = results.data() + i * GPU_PROFILER_STATISTICS_COUNT;
+		double inputVertices = static_cast<double>(counters[0]);
+		double inputPrimitives = static_cast<double>(counters[1]);
+		double vertexInvocations = static_cast<double>(counters[2]);
+		double clippedPrimitives = static_cast<double>(counters[3]);
+		double fragmentInvocations = static_cast<double>(counters[4]);
+
+		const std::string& name = names[i];
+		addSample(name + " IA vertices", inputVertices, "");
+		addSample(name + " IA primitives", inputPrimitives, "");
+		addSample(name + " VS invocations", vertexInvocations, "");
+		addSample(name + " clipped primitives", clippedPrimitives, "");
+		addSample(name + " FS invocations", fragmentInvocations, "");
+		// Overdraw: fragments shaded per pixel of the render area, 1.0 = every pixel shaded exactly once
+		if (frame.pixelCount > 0)
+		{
+			addSample(name + " overdraw", fragmentInvocations / frame.pixelCount, "x");
+		}
+		// Vertex reuse: indices fetched per vertex shader invocation, > 1 when the post transform cache hits
+		if (vertexInvocations > 0.0)
+		{
+			addSample(name + " vertex reuse", inputVertices / vertexInvocations, "x");
+		}
+	}
+}
+
+bool GpuProfiler::getStats(const std::string& name, GpuStatSummary& outSummary)
+{
+	auto entry = history.find(name);
+	if (entry == history.end() || entry->second.samples.empty()) return false;
+
+	std::vector<double> sorted = entry->second.samples;
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (double sample : sorted) sum += sample;
+
+	outSummary.min = sorted.front();
+	outSummary.avg = sum / sorted.size();
+	outSummary.p50 = percentileOfSorted(sorted, 50.0);
+	outSummary.p95 = percentileOfSorted(sorted, 95.0);
+	outSummary.p99 = percentileOfSorted(sorted, 99.0);
+	outSummary.sampleCount = sorted.size();
+	return true;
+}
+
+void GpuProfiler::printStats()
+{
+	if (!enabled || history.empty()) return;
+
+	for (const auto& entry : history)
+	{
+		GpuStatSummary summary;
+		if (!getStats(entry.first, summary)) continue;
+		const char* unit = entry.second.unit;
+		printf("GPU %-32s min %.3f %s, avg %.3f %s, p99 %.3f %s (%zu frames)\n", entry.first.c_str(),
+			summary.min, unit, summary.avg, unit, summary.p99, unit, summary.sampleCount);
+	}
+}
+
+void GpuProfiler::resetHistory(size_t newHistorySize)
+{
+	history.clear();
+	historySize = std::max<size_t>(newHistorySize, 1);
+
+	// Frames in flight were recorded before the reset, their results are never collected
+	for (FrameQueries& frame : frames)
+	{
+		frame.pending = false;
+		frame.statistics.clear();
+	}
+}
+
+void GpuProfiler::collectAll()
+{
+	if (!enabled) return;
+
+	for (uint32_t i = 0; i < frames.size(); i++)
+	{
+		collect(i);
+		collectStatistics(i);
+	}
+}
+
+void GpuProfiler::exportChromeTrace(const std::string& fileName)
+{
+	if (!enabled || traceEvents.empty()) return;
+
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("GPU profiler: failed to open %s for writing\n", fileName.c_str());
+		return;
+	}
+
+	// Complete events ("ph":"X") on their own GPU track
+	file << "{\"traceEvents\":[\n";
+	for (size_t i = 0; i < traceEvents.size(); i++)
+	{
+		const TraceEvent& event = traceEvents[i];
+		char line[128];
+		snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":\"GPU\",\"ts\":%.3f,\"dur\":%.3f}",
+			event.startUs, event.durationUs);
+		file << "{\"name\":\"" << escapeJson(event.name) << line << (i + 1 < traceEvents.size() ? ",\n" : "\n");
+	}
+	file << "]}\n";
+	file.close();
+
+	printf("GPU profiler: %zu zones written to %s\n", traceEvents.size(), fileName.c_str());
+}
+
+void GpuProfiler::destroyProfiler()
+{
+	if (queryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	if (statisticsQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+		statisticsQueryPool = VK_NULL_HANDLE;
+	}
+	enabled = false;
+}
+
+GpuProfiler::~GpuProfiler()
+{
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <deque>
+#include "Utility.h"
+
+// Rolling summary of one timing or statistic
+struct GpuStatSummary {
+	double min;
+	double avg;
+	double p50;
+	double p95;
+	double p99;
+	size_t sampleCount;
+};
+
+// GPU timings from vkCmdWriteTimestamp pairs, and optionally pipeline statistics queries (overdraw, vertex reuse).
+// One query pool range per frame in flight: a frame's results are read back when the frame slot is reused (its fence already signalled), so reading never stalls
+class GpuProfiler
+{
+public:
+	GpuProfiler();
+	// enablePipelineStatistics requires the pipelineStatisticsQuery device feature to be enabled
+	GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice newDevice, uint32_t queueFamilyIndex, uint32_t newFrameCount,
+		bool enablePipelineStatistics);
+
+	// False when the queue can't write timestamps, every other call is then a no-op
+	bool isEnabled();
+	// Also bracket each ImportMesh draw group, not only the passes
+	void setProfileDrawGroups(bool enabled);
+	bool getProfileDrawGroups();
+
+	// Collect the results of the frame slot's previous use and reset its queries, outside of a render pass.
+	// pixelCount is the render area, the overdraw ratio is fragment shader invocations / pixelCount
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t pixelCount);
+	// Returns the zone id to pass to endZone()
+	uint32_t beginZone(VkCommandBuffer commandBuffer, const std::string& name);
+	void endZone(VkCommandBuffer commandBuffer, uint32_t zoneId);
+	// Pipeline statistics of the commands in between, both calls inside the same subpass. No-op without pipeline statistics
+	uint32_t beginStatistics(VkCommandBuffer commandBuffer, const std::string& name);
+	void endStatistics(VkCommandBuffer commandBuffer, uint32_t statisticsId);
+
+	// Rolling min / avg / p99 over the last GPU_PROFILER_HISTORY frames (or the size given to resetHistory()). Timings are named after the zone (ms),
+	// statistics "<name> overdraw", "<name> vertex reuse", "<name> VS invocations", "<name> FS invocations", "<name> clipped primitives", ...
+	bool getStats(const std::string& name, GpuStatSummary& outSummary);
+	void printStats();
+	// Drop every sample, including frames submitted but not read yet, and keep up to newHistorySize per name from now on.
+	// Call between frames, e.g. after a benchmark's warm-up so the stats cover exactly the measured frames
+	void resetHistory(size_t newHistorySize);
+	// Read back every submitted frame now instead of when its slot is reused, the device has to be idle
+	void collectAll();
+	// Chrome trace (chrome://tracing, Perfetto) of the last GPU_PROFILER_TRACE_EVENTS zones
+	void exportChromeTrace(const std::string& fileName);
+	void destroyProfiler();
+
+	~GpuProfiler();
+
+private:
+	struct Zone {
+		std::string name;
+		uint32_t beginQuery;
+		uint32_t endQuery;			// UINT32_MAX until endZone()
+	};
+
+	struct FrameQueries {
+		std::vector<Zone> zones;
+		std::vector<std::string> statistics;		// Name of each pipeline statistics query, in query order
+		uint32_t queryCount = 0;
+		uint64_t pixelCount = 0;
+		bool pending = false;		// Submitted, results not read yet
+	};
+
+	struct StatHistory {
+		std::vector<double> samples;	// Ring of historySize
+		size_t next = 0;
+		const char* unit;				// Printed after the values
+	};
+
+	struct TraceEvent {
+		std::string name;
+		double startUs;
+		double durationUs;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;		// VK_NULL_HANDLE when pipeline statistics are off
+	bool enabled = false;
+	bool profileDrawGroups = false;
+	double timestampPeriod = 1.0;			// Nanoseconds per tick
+	uint64_t timestampMask = ~0ull;			// Only timestampValidBits are meaningful
+	uint64_t traceOrigin = 0;				// First timestamp seen, start of the trace
+	bool traceOriginSet = false;
+
+	uint32_t currentFrame = 0;
+	std::vector<FrameQueries> frames;
+	std::vector<uint64_t> results;
+	std::map<std::string, StatHistory> history;
+	size_t historySize = GPU_PROFILER_HISTORY;
+	std::deque<TraceEvent> traceEvents;
+
+	void collect(uint32_t frameIndex);
+	void collectStatistics(uint32_t frameIndex);
+	void addSample(const std::string& name, double value, const char* unit);
+};
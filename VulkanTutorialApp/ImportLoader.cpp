@@ -0,0 +1,316 @@
+#include "ImportLoader.h"
+#include "ImportMesh.h"
+#include "VulkanRenderer.h"
+#include "CpuProfiler.h"
+
+#include <algorithm>
+
+ImportLoader::ImportLoader()
+{
+}
+
+void ImportLoader::start(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue newTransferQueue,
+	VkCommandPool newTransferCommandPool)
+{
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	transferQueue = newTransferQueue;
+	transferCommandPool = newTransferCommandPool;
+
+	stopping = false;
+}
+
+// Jobs that didn't start yet see stopping and return straight away
+void ImportLoader::stop()
+{
+	stopping = true;
+	JobSystem::wait(importsInFlight);
+}
+
+// std::function has to be copyable, the job takes the import back from a raw pointer
+void ImportLoader::request(std::unique_ptr<AsyncImport> import)
+{
+	AsyncImport* requested = import.release();
+	JobSystem::run([this, requested]() { runImport(std::unique_ptr<AsyncImport>(requested)); }, &importsInFlight);
+}
+
+std::vector<std::unique_ptr<AsyncImport>> ImportLoader::takeLoaded()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::unique_ptr<AsyncImport>> result = std::move(loaded);
+	loaded.clear();
+	return result;
+}
+
+void ImportLoader::requestTextureReload(std::unique_ptr<TextureReload> reload)
+{
+	TextureReload* requested = reload.release();
+	JobSystem::run([this, requested]() { runTextureReload(std::unique_ptr<TextureReload>(requested)); }, &importsInFlight);
+}
+
+std::vector<std::unique_ptr<TextureReload>> ImportLoader::takeReloadedTextures()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<std::unique_ptr<TextureReload>> result = std::move(reloadedTextures);
+	reloadedTextures.clear();
+	return result;
+}
+
+void ImportLoader::markTextureLoaded(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	loadedTextures.insert(fileName);
+}
+
+bool ImportLoader::isTextureLoaded(const std::string& fileName)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return loadedTextures.count(fileName) > 0;
+}
+
+void ImportLoader::runImport(std::unique_ptr<AsyncImport> import)
+{
+	if (stopping) return;
+
+	try
+	{
+		load(*import);
+	}
+	catch (const std::exception& e)
+	{
+		// Nothing of a failed import reaches the renderer, free what was created so far
+		import->error = e.what();
+		for (Mesh& mesh : import->meshes)
+		{
+			mesh.destroyBuffers();
+		}
+		import->meshes.clear();
+		import->textures.clear();
+		import->uploader.reset();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded.push_back(std::move(import));
+}
+
+void ImportLoader::load(AsyncImport& import)
+{
+	CPU_PROFILE_ZONE("ImportLoader::load");
+
+	// Import model "scene", same flags as VulkanRenderer::addNCreateImportMesh()
+	Assimp::Importer importer;
+	const aiScene* scene;
+	{
+		CPU_PROFILE_ZONE("Assimp ReadFile");
+		scene = importer.ReadFile(getMeshFilePath(import.meshFileName), aiProcess_Triangulate | aiProcess_FlipUVs |
+			aiProcess_JoinIdenticalVertices);
+	}
+	if (!scene)
+	{
+		throw std::runtime_error("Failed to load model! (" + import.meshFileName + ")");
+	}
+
+	import.uploader.reset(new StagingUploader(physicalDevice, device, transferQueue, transferCommandPool));
+
+	// TEXTURE
+	// - 1 per file name the renderer doesn't have yet, each job decodes into its own slot. Packed: 1 texture array for the whole model
+	import.materialTextures = ImportMesh::LoadMaterials(scene);
+	std::vector<std::string> packedFileNames;
+	std::vector<TexturePlacement> materialPlacements;
+	TexturePackLayout packLayout;
+	if (import.options.packTextures)
+	{
+		packLayout = planTexturePack(import.materialTextures, packedFileNames, materialPlacements);
+		if (!packedFileNames.empty())
+		{
+			import.packedTextureName = TexturePacker::getPackedName(import.meshFileName);
+			if (!isTextureLoaded(import.packedTextureName))
+			{
+				DecodedTexture texture = {};
+				texture.fileName = import.packedTextureName;
+				import.textures.push_back(texture);
+			}
+		}
+	}
+	for (const std::string& fileName : import.materialTextures)
+	{
+		if (fileName.empty() || isTextureLoaded(fileName) || !import.packedTextureName.empty()) continue;
+
+		bool listed = false;
+		for (const DecodedTexture& texture : import.textures)
+		{
+			listed |= texture.fileName == fileName;
+		}
+		if (listed) continue;
+
+		DecodedTexture texture = {};
+		texture.fileName = fileName;
+		import.textures.push_back(texture);
+	}
+
+	JobCounter decodeAndConvert;
+	for (DecodedTexture& texture : import.textures)
+	{
+		if (!import.packedTextureName.empty())
+		{
+			JobSystem::run([&import, &texture, &packedFileNames, &packLayout]() {
+				decodePackedTexture(*import.uploader, packedFileNames, packLayout, texture); }, &decodeAndConvert);
+			continue;
+		}
+		JobSystem::run([&import, &texture]() { decodeTexture(*import.uploader, texture); }, &decodeAndConvert);
+	}
+
+	// MESH
+	// - Converted alongside the texture decoding. Texture index = index of the first material with the same texture for now
+	//   (materials sharing a texture can be batched), the render thread swaps in the sampler descriptor set index.
+	//   Packed: every material shares the texture array (untextured ones its default texture rect), the layer tells them apart
+	std::vector<int> materialIndices(import.materialTextures.size());
+	for (size_t i = 0; i < materialIndices.size(); i++)
+	{
+		auto sameTexture = [&](const std::string& fileName) {
+			return import.packedTextureName.empty() ? fileName == import.materialTextures[i] : !fileName.empty();
+		};
+		materialIndices[i] = static_cast<int>(std::find_if(import.materialTextures.begin(), import.materialTextures.end(),
+			sameTexture) - import.materialTextures.begin());
+	}
+	JobSystem::run([this, &import, scene, &materialIndices, &materialPlacements]() {
+		import.meshes = ImportMesh::CreateMeshes(physicalDevice, device, *import.uploader,
+			scene->mRootNode, scene, materialIndices, import.options, materialPlacements);
+	}, &decodeAndConvert);
+
+	JobSystem::wait(decodeAndConvert);
+
+	if (import.options.batchByTexture)
+	{
+		printf("%s: %u meshes batched by texture into %zu draws\n", import.meshFileName.c_str(), scene->mNumMeshes, import.meshes.size());
+	}
+	if (!import.packedTextureName.empty())
+	{
+		printf("%s: %zu textures packed into %u layers of %ux%u\n", import.meshFileName.c_str(), packedFileNames.size(),
+			packLayout.layerCount, packLayout.layerWidth, packLayout.layerHeight);
+	}
+}
+
+void ImportLoader::runTextureReload(std::unique_ptr<TextureReload> reload)
+{
+	if (stopping) return;
+
+	try
+	{
+		reload->uploader.reset(new StagingUploader(physicalDevice, device, transferQueue, transferCommandPool));
+		decodeTexture(*reload->uploader, reload->texture);
+	}
+	catch (const std::exception& e)
+	{
+		reload->error = e.what();
+		reload->uploader.reset();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	reloadedTextures.push_back(std::move(reload));
+}
+
+// The render thread creates the image and queues its copy
+void ImportLoader::decodeTexture(StagingUploader& uploader, DecodedTexture& texture)
+{
+	CPU_PROFILE_ZONE("Decode texture");
+
+	int width, height;
+	VkDeviceSize imageSize;
+	stbi_uc* imageData = VulkanRenderer::loadTextureFile(texture.fileName, &width, &height, &imageSize);
+
+	texture.width = static_cast<uint32_t>(width);
+	texture.height = static_cast<uint32_t>(height);
+	texture.region = uploader.allocate(imageSize);
+	memcpy(texture.region.data, imageData, static_cast<size_t>(imageSize));
+	stbi_image_free(imageData);
+}
+
+TexturePackLayout ImportLoader::planTexturePack(const std::vector<std::string>& materialTextures, std::vector<std::string>& outFileNames,
+	std::vector<TexturePlacement>& outMaterialPlacements)
+{
+	CPU_PROFILE_ZONE("Plan texture pack");
+
+	std::vector<glm::uvec2> sizes;
+	auto addFile = [&](const std::string& fileName) {
+		auto file = std::find(outFileNames.begin(), outFileNames.end(), fileName);
+		if (file == outFileNames.end())
+		{
+			int width, height;
+			VulkanRenderer::getTextureFileSize(fileName, &width, &height);
+			sizes.push_back(glm::uvec2(width, height));
+			outFileNames.push_back(fileName);
+			file = outFileNames.end() - 1;
+		}
+		return static_cast<size_t>(file - outFileNames.begin());
+	};
+
+	std::vector<size_t> materialToFile(materialTextures.size(), 0);
+	bool untexturedMaterials = false;
+	for (size_t i = 0; i < materialTextures.size(); i++)
+	{
+		if (materialTextures[i].empty())
+		{
+			untexturedMaterials = true;
+			continue;
+		}
+		materialToFile[i] = addFile(materialTextures[i]);
+	}
+	// Materials without texture sample the default texture from the array too, the model stays at 1 texture binding
+	if (untexturedMaterials && !outFileNames.empty())
+	{
+		size_t defaultFile = addFile(DEFAULT_TEXTURE_FILE);
+		for (size_t i = 0; i < materialTextures.size(); i++)
+		{
+			if (materialTextures[i].empty()) materialToFile[i] = defaultFile;
+		}
+	}
+
+	TexturePackLayout layout = TexturePacker::plan(sizes);
+
+	outMaterialPlacements.clear();
+	for (size_t i = 0; i < materialTextures.size() && !outFileNames.empty(); i++)
+	{
+		outMaterialPlacements.push_back(layout.placements[materialToFile[i]]);
+	}
+
+	return layout;
+}
+
+void ImportLoader::decodePackedTexture(StagingUploader& uploader, const std::vector<std::string>& fileNames,
+	const TexturePackLayout& layout, DecodedTexture& texture)
+{
+	CPU_PROFILE_ZONE("Decode packed texture");
+
+	VkDeviceSize layerSize = static_cast<VkDeviceSize>(layout.layerWidth) * layout.layerHeight * 4;
+	texture.region = uploader.allocate(layerSize * layout.layerCount);
+	uint8_t* layers = static_cast<uint8_t*>(texture.region.data);
+	memset(layers, 0, static_cast<size_t>(layerSize * layout.layerCount));		// Atlas space nothing was packed into
+
+	// Every texture only writes its own placement + gutter
+	JobSystem::parallelFor(fileNames.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			int width, height;
+			VkDeviceSize imageSize;
+			stbi_uc* imageData = VulkanRenderer::loadTextureFile(fileNames[i], &width, &height, &imageSize);
+			if (static_cast<uint32_t>(width) != layout.placements[i].width || static_cast<uint32_t>(height) != layout.placements[i].height)
+			{
+				stbi_image_free(imageData);
+				throw std::runtime_error("Texture changed size while being packed! (" + fileNames[i] + ")");
+			}
+			TexturePacker::write(layout, i, imageData, layers);
+			stbi_image_free(imageData);
+		}
+	});
+
+	texture.width = layout.layerWidth;
+	texture.height = layout.layerHeight;
+	texture.layerCount = layout.layerCount;
+	texture.packed = true;
+}
+
+ImportLoader::~ImportLoader()
+{
+	stop();
+}
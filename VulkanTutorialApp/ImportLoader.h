@@ -0,0 +1,113 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include "Mesh.h"
+#include "StagingUploader.h"
+#include "JobSystem.h"
+#include "TexturePacker.h"
+#include "Utility.h"
+
+// A texture decoded to RGBA8 straight into staging memory
+struct DecodedTexture {
+	std::string fileName;
+	StagingRegion region;
+	uint32_t width;
+	uint32_t height;
+	uint32_t layerCount = 1;
+	bool packed = false;							// Texture array of ImportOptions::packTextures, fileName is TexturePacker::getPackedName()
+};
+
+// One VulkanRenderer::addNCreateImportMeshAsync() request. A loader job fills it up to the GPU copies, the render thread does the rest
+struct AsyncImport {
+	ImportHandle handle;
+	std::string meshFileName;
+	glm::mat4 modelMat;
+	int reloadModelId = -1;							// Hot reload: replaces the meshes of this import mesh instead of adding one
+	ImportOptions options;
+
+	// Written by the loader job
+	std::unique_ptr<StagingUploader> uploader;		// Mesh copies queued, the texture copies are added by the render thread
+	std::vector<std::string> materialTextures;		// Diffuse texture file name per material, "" for none
+	std::string packedTextureName;					// ImportOptions::packTextures: texture array every textured material samples, "" otherwise
+	std::vector<DecodedTexture> textures;			// 1 per file name the renderer didn't have yet
+	std::vector<Mesh> meshes;						// Device buffers created, texture index is still the material index
+	std::string error;								// Not empty when the import failed
+
+	// Render thread
+	size_t nextTexture = 0;							// Textures get their image one at a time, within the frame budget
+	std::map<std::string, int> createdTextures;		// fileName -> sampler descriptor set index, published once the copies are done
+	bool submitted = false;
+};
+
+// Hot reload of a texture the renderer already has. A loader job decodes it, the render thread swaps the new image in once its copy is done
+struct TextureReload {
+	DecodedTexture texture;							// fileName set by the request
+	std::unique_ptr<StagingUploader> uploader;
+	std::string error;								// Not empty when the decode failed, the old image stays
+
+	// Render thread
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+};
+
+// Runs the CPU side of asynchronous imports on the job system, 1 job per import: Assimp parsing, then texture decoding (1 job per texture)
+// alongside mesh conversion (parallel over the meshes) and device buffer creation. It never touches a queue or a command pool
+class ImportLoader
+{
+public:
+	ImportLoader();
+
+	void start(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue newTransferQueue, VkCommandPool newTransferCommandPool);
+	// Finishes the imports in progress, requests not started yet are dropped
+	void stop();
+
+	void request(std::unique_ptr<AsyncImport> import);
+	// Imports the loader is done with since the last call, failed ones included
+	std::vector<std::unique_ptr<AsyncImport>> takeLoaded();
+	// Texture already has a sampler descriptor set, later imports don't decode it again
+	void markTextureLoaded(const std::string& fileName);
+
+	void requestTextureReload(std::unique_ptr<TextureReload> reload);
+	std::vector<std::unique_ptr<TextureReload>> takeReloadedTextures();
+
+	// Decoded to RGBA8 straight into staging memory, texture.fileName has to be set
+	static void decodeTexture(StagingUploader& uploader, DecodedTexture& texture);
+	// ImportOptions::packTextures: layout of the material textures (sizes read from the file headers). outFileNames gets the distinct
+	// file names in layout order (+ DEFAULT_TEXTURE_FILE when some materials have no texture), outMaterialPlacements 1 placement per
+	// material, untextured ones get the default texture's. Both empty when no material has a texture
+	static TexturePackLayout planTexturePack(const std::vector<std::string>& materialTextures, std::vector<std::string>& outFileNames,
+		std::vector<TexturePlacement>& outMaterialPlacements);
+	// Decodes fileNames in parallel straight into the layers of 1 texture array, texture.fileName has to be set
+	static void decodePackedTexture(StagingUploader& uploader, const std::vector<std::string>& fileNames, const TexturePackLayout& layout,
+		DecodedTexture& texture);
+
+	~ImportLoader();
+
+private:
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	VkQueue transferQueue;
+	VkCommandPool transferCommandPool;
+
+	JobCounter importsInFlight;						// Import and texture reload jobs queued or running
+	std::atomic<bool> stopping{ false };
+
+	std::mutex mutex;								// Guards everything below
+	std::vector<std::unique_ptr<AsyncImport>> loaded;
+	std::vector<std::unique_ptr<TextureReload>> reloadedTextures;
+	std::set<std::string> loadedTextures;
+
+	void runImport(std::unique_ptr<AsyncImport> import);
+	void load(AsyncImport& import);
+	void runTextureReload(std::unique_ptr<TextureReload> reload);
+	bool isTextureLoaded(const std::string& fileName);
+};
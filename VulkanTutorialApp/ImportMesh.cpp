@@ -1,4 +1,10 @@
 #include "ImportMesh.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+
+#include <algorithm>
 
 
 
@@ -9,7 +15,7 @@ ImportMesh::ImportMesh()
 
 ImportMesh::ImportMesh(std::vector<Mesh> newMeshList, glm::mat4 inModelMat)
 {
-	meshList = newMeshList;
+	meshList = std::move(newMeshList);
 	model.model = inModelMat;
 }
 
@@ -38,6 +44,13 @@ void ImportMesh::setModel(glm::mat4 newModel)
 	model.model = newModel;
 }
 
+std::vector<Mesh> ImportMesh::replaceMeshes(std::vector<Mesh> newMeshList)
+{
+	std::vector<Mesh> oldMeshList = std::move(meshList);
+	meshList = std::move(newMeshList);
+	return oldMeshList;
+}
+
 void ImportMesh::destroyImportMesh()
 {
 	for (auto& mesh : meshList)
@@ -86,84 +99,279 @@ std::vector<std::string> ImportMesh::LoadMaterials(const aiScene* scene)
 }
 
 // In Assimp, Scene has the root nodes and meshList, Nodes has all the meshes index in aiScene and other nodes, and meshes has all the vertex/index data
-// 1) recursively go into each node and load all the vertex data; 2) extract all the vertex data from different node, put them on the same level and push into a vector
+// Converts every mesh (see CreateMeshes()) and uploads them in one go at the end
 std::vector<Mesh> ImportMesh::LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, 
 	VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode* node, const aiScene* scene, 
-	std::vector<int> materialToSamplerDescriptorSetId)
+	const std::vector<int>& materialToSamplerDescriptorSetId, const ImportOptions& options,
+	const std::vector<TexturePlacement>& materialPlacements)
+{
+	CPU_PROFILE_ZONE("LoadNode");
+
+	StagingUploader uploader(newPhysicalDevice, newDevice, transferQueue, transferCommandPool);
+	std::vector<Mesh> meshList = CreateMeshes(newPhysicalDevice, newDevice, uploader, node, scene,
+		materialToSamplerDescriptorSetId, options, materialPlacements);
+
+	CPU_PROFILE_ZONE("Upload meshes");
+	uploader.flush();
+
+	return meshList;
+}
+
+// 1) flatten the node tree into a list of (aiMesh, transform) jobs; 2) group them into batches (1 job each unless batching by texture);
+// 3) convert every batch in parallel; 4) create the device buffers, copies queued on the uploader
+std::vector<Mesh> ImportMesh::CreateMeshes(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, StagingUploader& uploader,
+	aiNode* node, const aiScene* scene, const std::vector<int>& materialToSamplerDescriptorSetId, const ImportOptions& options,
+	const std::vector<TexturePlacement>& materialPlacements)
 {
+	CPU_PROFILE_ZONE("CreateMeshes");
+
+	// FLATTEN ============================================================================
+	std::vector<MeshImportJob> jobs;
+	jobs.reserve(scene->mNumMeshes);
+	FlattenNode(node, scene, glm::mat4(1.0f), jobs);
+	if (!materialPlacements.empty())
+	{
+		for (MeshImportJob& job : jobs)
+		{
+			job.textureLayer = materialPlacements[job.mesh->mMaterialIndex].layer;
+			job.uvTransform = materialPlacements[job.mesh->mMaterialIndex].uvTransform;
+		}
+	}
+
+	// BATCH ==============================================================================
+	// Jobs of batch i are [batchFirstJob[i], batchFirstJob[i + 1]). Batching sorts the jobs by texture (+ layer), node order is kept within
+	// a texture, and splits a texture's batch once it reaches MESH_BATCH_MAX_VERTICES
+	auto textureOf = [&](const MeshImportJob& job) {
+		return std::make_pair(materialToSamplerDescriptorSetId[job.mesh->mMaterialIndex], job.textureLayer); };
+	std::vector<size_t> batchFirstJob;
+	if (options.batchByTexture)
+	{
+		std::stable_sort(jobs.begin(), jobs.end(), [&](const MeshImportJob& a, const MeshImportJob& b) {
+			return textureOf(a) < textureOf(b); });
+	}
+	size_t batchVertexCount = 0;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		size_t vertexCount = jobs[i].mesh->mNumVertices;
+		if (!options.batchByTexture || i == 0 || textureOf(jobs[i]) != textureOf(jobs[i - 1]) ||
+			batchVertexCount + vertexCount > MESH_BATCH_MAX_VERTICES)
+		{
+			batchFirstJob.push_back(i);
+			batchVertexCount = 0;
+		}
+		batchVertexCount += vertexCount;
+	}
+	size_t batchCount = batchFirstJob.size();
+	batchFirstJob.push_back(jobs.size());
+
+	// CONVERT (parallel) =================================================================
+	// Each batch writes only its own pre-sized slot, the batches share nothing but the staging allocator.
+	// 1 batch per chunk, batches vary a lot in size and stealing evens them out
+	std::vector<MeshImportData> meshData(batchCount);
+	JobSystem::parallelFor(batchCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			LoadMeshBatch(&jobs[batchFirstJob[i]], batchFirstJob[i + 1] - batchFirstJob[i], materialToSamplerDescriptorSetId,
+				uploader, meshData[i]);
+		}
+	});
+
+	// DEVICE BUFFERS =====================================================================
+	// Created on the calling thread once all the CPU work is done, the copies go out with the uploader's next flush() / submit()
+	CPU_PROFILE_ZONE("Create mesh buffers");
 	std::vector<Mesh> meshList;
+	meshList.reserve(meshData.size());
+	try
+	{
+		for (auto& data : meshData)
+		{
+			meshList.push_back(Mesh(newPhysicalDevice, newDevice, &uploader, data.vertexRegion, data.vertexCount,
+				data.indexRegion, data.indexCount, data.texId, data.bounds, &data.lods, &data.meshlets));
+			meshList.back().setTextureLayer(data.textureLayer);
+		}
+	}
+	catch (...)
+	{
+		// The caller never gets the list, free the buffers of the meshes created so far
+		for (Mesh& mesh : meshList)
+		{
+			mesh.destroyBuffers();
+		}
+		throw;
+	}
+
+	return meshList;
+}
+
+// Depth first walk over the node tree, one job per mesh reference (node doesn't hold aiMesh, it only holds the index of the aiMesh in the aiMesh list in aiScene)
+void ImportMesh::FlattenNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform,
+	std::vector<MeshImportJob>& outJobs)
+{
+	// aiMatrix4x4 is row major, glm is column major
+	const aiMatrix4x4& m = node->mTransformation;
+	glm::mat4 localTransform = glm::mat4(
+		m.a1, m.b1, m.c1, m.d1,
+		m.a2, m.b2, m.c2, m.d2,
+		m.a3, m.b3, m.c3, m.d3,
+		m.a4, m.b4, m.c4, m.d4);
+	glm::mat4 transform = parentTransform * localTransform;
 
-	// Go through each mesh at this node and create it, then add it to our meshList
 	for (size_t i = 0; i < node->mNumMeshes; i++)
 	{
-		meshList.push_back(
-			LoadMesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, 
-				scene->mMeshes[node->mMeshes[i]], scene, materialToSamplerDescriptorSetId) // Access the actual aiMesh data in this way makes sence, since node doen't hold aiMesh, it only holds the index of the aiMesh in the aiMesh list in aiScene. 
-		);	
+		MeshImportJob job = {};
+		job.mesh = scene->mMeshes[node->mMeshes[i]];
+		job.transform = transform;
+		outJobs.push_back(job);
 	}
 
-	// Go through each node attached to this node and load it, then append their meshes to this node's mesh list
 	for (size_t i = 0; i < node->mNumChildren; i++)
 	{
-		std::vector<Mesh> newList = LoadNode(newPhysicalDevice, newDevice, transferQueue, 
-			transferCommandPool, node->mChildren[i], scene, materialToSamplerDescriptorSetId);
-		meshList.insert(meshList.end(), newList.begin(), newList.end());
+		FlattenNode(node->mChildren[i], scene, transform, outJobs);
 	}
+}
 
-	return meshList;
+void ImportMesh::LoadMesh(const MeshImportJob& job, const std::vector<int>& materialToSamplerDescriptorSetId,
+	StagingUploader& uploader, MeshImportData& outData)
+{
+	LoadMeshBatch(&job, 1, materialToSamplerDescriptorSetId, uploader, outData);
 }
 
 // aiMesh has all the vertex/index data
-// 1) Joint the data held by aiMesh to our own vertex struct; 2) Use the vertices data to create mesh defined in Mesh.h
-Mesh ImportMesh::LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, 
-	VkCommandPool transferCommandPool, aiMesh* mesh, const aiScene* scene, std::vector<int> materialToSamplerDescriptorSetId)
+// Joint the data held by every aiMesh of the batch to our own vertex struct, one after the other in the same vertex / index list.
+// Meshlets are built per aiMesh, the LOD chain over the whole batch. Pure CPU work, safe to run on any thread
+void ImportMesh::LoadMeshBatch(const MeshImportJob* jobs, size_t jobCount, const std::vector<int>& materialToSamplerDescriptorSetId,
+	StagingUploader& uploader, MeshImportData& outData)
 {
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
+	CPU_PROFILE_ZONE("LoadMesh");
 
-	// Resize vertex list to hold all vertices for mesh
-	vertices.resize(mesh->mNumVertices);
+	// Vertices are converted straight into the staging memory they are uploaded from, the final size is known up front.
+	// Faces are triangles after aiProcess_Triangulate but count the indices anyway
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t j = 0; j < jobCount; j++)
+	{
+		vertexCount += jobs[j].mesh->mNumVertices;
+		for (size_t i = 0; i < jobs[j].mesh->mNumFaces; i++)
+		{
+			indexCount += jobs[j].mesh->mFaces[i].mNumIndices;
+		}
+	}
+	outData.vertexCount = static_cast<uint32_t>(vertexCount);
+	outData.vertexRegion = uploader.allocate(sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCount));
+	Vertex* vertices = static_cast<Vertex*>(outData.vertexRegion.data);
 
-	// Go through each vertex and copy it across to our vertices struct
-	for (size_t i = 0; i < mesh->mNumVertices; i++)
+	// Indices still go through a scratch list, the meshlet builder reorders them and the LOD chain appends to them, so the final size is only known at the end
+	std::vector<uint32_t> indices;
+	size_t vertexBase = 0;
+	for (size_t j = 0; j < jobCount; j++)
 	{
-		// Set position
-		vertices[i].pos = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+		const aiMesh* mesh = jobs[j].mesh;
+		Vertex* meshVertices = vertices + vertexBase;
+
+		// Atlas rect of a packed texture, UVs outside [0, 1] would sample the neighbours so they are clamped
+		const glm::vec4& uvTransform = jobs[j].uvTransform;
+		bool remapUvs = uvTransform != glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
 
-		// Set tex coords (if they exist)
-		if (mesh->mTextureCoords[0])
+		// Go through each vertex and copy it across to our vertices struct
+		for (size_t i = 0; i < mesh->mNumVertices; i++)
 		{
-			vertices[i].uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+			// Set position, baked with the node transform
+			glm::vec4 pos = jobs[j].transform * glm::vec4(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z, 1.0f);
+			meshVertices[i].pos = glm::vec3(pos);
+
+			// Set tex coords (if they exist)
+			if (mesh->mTextureCoords[0])
+			{
+				meshVertices[i].uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+			}
+			else
+			{
+				meshVertices[i].uv = { 0.0f, 0.0f };
+			}
+			if (remapUvs)
+			{
+				meshVertices[i].uv = glm::clamp(meshVertices[i].uv, 0.0f, 1.0f) * glm::vec2(uvTransform) +
+					glm::vec2(uvTransform.z, uvTransform.w);
+			}
+
+			// Set default color for imported mesh (just use white for now)
+			meshVertices[i].col = { 0.8f, 0.8f, 0.8f };
 		}
-		else
+
+		// Iterate over indices through faces and copy across, local to this aiMesh's vertices for now
+		size_t meshIndexCount = 0;
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
 		{
-			vertices[i].uv = { 0.0f, 0.0f };
+			meshIndexCount += mesh->mFaces[i].mNumIndices;
+		}
+		std::vector<uint32_t> meshIndices(meshIndexCount);
+		size_t writeIndex = 0;
+		for (size_t i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+			std::copy(face.mIndices, face.mIndices + face.mNumIndices, meshIndices.begin() + writeIndex);
+			writeIndex += face.mNumIndices;
 		}
 
-		// Set default color for imported mesh (just use white for now)
-		vertices[i].col = { 0.8f, 0.8f, 0.8f };
-	}
-
-	// Iterate over indices through faces and copy across
-	for (size_t i = 0; i < mesh->mNumFaces; i++)
-	{
-		// Get a face
-		aiFace face = mesh->mFaces[i];
+		// Split into meshlets for GPU culling, this reorders the triangles so each meshlet is a contiguous range
+		std::vector<Meshlet> meshlets;
+		{
+			CPU_PROFILE_ZONE("MeshletBuilder::build");
+			MeshletBuilder::build(meshVertices, mesh->mNumVertices, meshIndices, meshlets);
+		}
 
-		// Go through face's indices and add to list
-		for (size_t j = 0; j < face.mNumIndices; j++)
+		// Appended to the batch: indices move past the vertices of the aiMeshes before, meshlets past their indices
+		if (j == 0)
 		{
-			indices.push_back(face.mIndices[j]);
+			outData.meshlets = std::move(meshlets);
+			indices = std::move(meshIndices);
+			indices.reserve(indexCount);
+		}
+		else
+		{
+			uint32_t firstIndex = static_cast<uint32_t>(indices.size());
+			for (Meshlet& meshlet : meshlets)
+			{
+				meshlet.firstIndex += firstIndex;
+				outData.meshlets.push_back(meshlet);
+			}
+			for (uint32_t index : meshIndices)
+			{
+				indices.push_back(index + static_cast<uint32_t>(vertexBase));
+			}
 		}
+		vertexBase += mesh->mNumVertices;
+	}
+
+	// Bounds of the whole batch, the meshlet bounds below it still cull each aiMesh on its own
+	outData.bounds = Mesh::computeBounds(vertices, vertexCount);
+
+	// Generate the LOD chain, coarser levels are appended after the full resolution indices
+	{
+		CPU_PROFILE_ZONE("MeshSimplifier::buildLodChain");
+		MeshSimplifier::buildLodChain(vertices, vertexCount, indices, outData.lods);
 	}
 
-	// Create new mesh with details and return it
-	Mesh newMesh = Mesh(newPhysicalDevice, newDevice, transferQueue, transferCommandPool, 
-		&vertices, &indices, materialToSamplerDescriptorSetId[mesh->mMaterialIndex]);
+	// Final index list to staging memory
+	outData.indexCount = static_cast<uint32_t>(indices.size());
+	outData.indexRegion = uploader.allocate(sizeof(uint32_t) * static_cast<VkDeviceSize>(indices.size()));
+	memcpy(outData.indexRegion.data, indices.data(), sizeof(uint32_t) * indices.size());
 
-	return newMesh;
+	// Every aiMesh of a batch has the same texture
+	outData.texId = materialToSamplerDescriptorSetId[jobs[0].mesh->mMaterialIndex];
+	outData.textureLayer = jobs[0].textureLayer;
 }
 
+void ImportMesh::PackModels(std::vector<ImportMesh>& importMeshes, void* outData, VkDeviceSize stride)
+{
+	JobSystem::parallelFor(importMeshes.size(), PACK_MODELS_GRAIN_SIZE, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			Model* model = (Model*)((uint64_t)outData + (i * stride));
+			*model = importMeshes[i].getModel();
+		}
+	});
+}
 
 ImportMesh::~ImportMesh()
 {
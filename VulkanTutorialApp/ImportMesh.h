@@ -4,6 +4,28 @@
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include "Mesh.h"
+#include "TexturePacker.h"
+
+// One aiMesh to convert, with the transform accumulated from the root node down to the node referencing it
+struct MeshImportJob {
+	aiMesh* mesh;
+	glm::mat4 transform;
+	uint32_t textureLayer = 0;							// Packed textures: layer and atlas rect of the material's texture
+	glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+// Result of converting one aiMesh: vertices and indices already sit in staging memory, uploaded once every mesh of the scene is converted
+struct MeshImportData {
+	StagingRegion vertexRegion;
+	StagingRegion indexRegion;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	BoundingSphere bounds;
+	int texId;
+	uint32_t textureLayer;
+};
 
 class ImportMesh
 {
@@ -16,16 +38,34 @@ public:
 
 	Model getModel();
 	void setModel(glm::mat4 newModel);
+	// Hot reload: swaps in a new mesh list and returns the old one, still used by the frames in flight
+	std::vector<Mesh> replaceMeshes(std::vector<Mesh> newMeshList);
 
 	void destroyImportMesh();
 
 	static std::vector<std::string> LoadMaterials(const aiScene* scene);
+	// Every mesh under node, converted and uploaded. Unlike before the node tree was flattened, node transforms (root down to the node
+	// referencing the mesh) are baked into the vertex positions, the model matrix of the ImportMesh is applied on top of them.
+	// Needed by ImportOptions::batchByTexture, merged meshes of different nodes share 1 model matrix
 	static std::vector<Mesh> LoadNode(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, 
 		VkQueue transferQueue, VkCommandPool transferCommandPool,
-		aiNode* node, const aiScene* scene, std::vector<int> materialToSamplerDescriptorSetId);
-	static Mesh LoadMesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, 
-		VkCommandPool transferCommandPool,
-		aiMesh* mesh, const aiScene* scene, std::vector<int> materialToSamplerDescriptorSetId);
+		aiNode* node, const aiScene* scene, const std::vector<int>& materialToSamplerDescriptorSetId,
+		const ImportOptions& options = ImportOptions(), const std::vector<TexturePlacement>& materialPlacements = {});
+	// Conversion of LoadNode() without the upload: device buffers are created and their copies queued on uploader.
+	// Meshes are converted on the job system (the calling thread included), safe to call off the render thread.
+	// materialPlacements (1 per material) when the model's textures are packed: UVs are remapped to the atlas rect, meshes get the layer
+	static std::vector<Mesh> CreateMeshes(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, StagingUploader& uploader,
+		aiNode* node, const aiScene* scene, const std::vector<int>& materialToSamplerDescriptorSetId,
+		const ImportOptions& options = ImportOptions(), const std::vector<TexturePlacement>& materialPlacements = {});
+	static void FlattenNode(aiNode* node, const aiScene* scene, const glm::mat4& parentTransform,
+		std::vector<MeshImportJob>& outJobs);
+	static void LoadMesh(const MeshImportJob& job, const std::vector<int>& materialToSamplerDescriptorSetId,
+		StagingUploader& uploader, MeshImportData& outData);
+	// jobCount aiMeshes with the same texture merged into 1 mesh. Meshlets are built per aiMesh, so none of them spans 2 sub-meshes
+	static void LoadMeshBatch(const MeshImportJob* jobs, size_t jobCount, const std::vector<int>& materialToSamplerDescriptorSetId,
+		StagingUploader& uploader, MeshImportData& outData);
+	// Model matrix of every import mesh into consecutive dynamic uniform buffer slots, stride bytes apart
+	static void PackModels(std::vector<ImportMesh>& importMeshes, void* outData, VkDeviceSize stride);
 
 	~ImportMesh();
 
@@ -0,0 +1,378 @@
+#include "JobSystem.h"
+#include "Utility.h"
+
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+struct Job {
+	std::function<void()> function;
+	JobCounter* counter;
+};
+
+// Owner pushes / pops at the back, thieves take from the front
+struct JobQueue {
+	std::mutex mutex;
+	std::deque<Job> jobs;
+};
+
+}
+
+static std::vector<std::thread> workers;
+static std::vector<std::unique_ptr<JobQueue>> queues;	// 1 per worker, the last one is shared by the threads outside the pool
+static std::atomic<bool> running(false);
+static std::atomic<bool> stopping(false);
+static std::atomic<uint32_t> queuedJobs(0);				// Jobs in any queue, checked before going to sleep
+static std::atomic<uint64_t> pushCount(0);				// Jobs ever queued, a waiter sleeps until it changes
+static std::atomic<uint32_t> sleepingWorkers(0);
+static std::atomic<uint32_t> sleepingWaiters(0);
+static std::mutex sleepMutex;
+static std::condition_variable workAvailable;			// Idle workers
+static std::condition_variable waitersWakeUp;			// Threads in wait(): a job was queued or a counter reached 0
+static thread_local int workerIndex = -1;				// Queue owned by this thread, -1 outside the pool
+
+// Sleepers check their condition under sleepMutex, taking it before notifying means a thread about to sleep can't miss the wake up
+static void wakeSleepers(bool worker, bool waiters)
+{
+	worker = worker && sleepingWorkers.load() > 0;
+	waiters = waiters && sleepingWaiters.load() > 0;
+	if (!worker && !waiters) return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	if (worker)
+	{
+		workAvailable.notify_one();
+	}
+	if (waiters)
+	{
+		waitersWakeUp.notify_all();
+	}
+}
+
+static void executeJob(Job& job)
+{
+	try
+	{
+		job.function();
+	}
+	catch (...)
+	{
+		if (!job.counter)
+		{
+			printf("JobSystem: uncaught exception in a job without counter\n");
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(job.counter->errorMutex);
+			if (!job.counter->error) job.counter->error = std::current_exception();
+		}
+	}
+
+	// Last job of the counter, wake whoever waits on it
+	if (job.counter && job.counter->pending.fetch_sub(1) == 1)
+	{
+		wakeSleepers(false, true);
+	}
+}
+
+// Takes the newest job of the queue (own queue) or the oldest (queue of another thread). With onlyCounter only the jobs
+// of that counter are taken
+static bool takeFromQueue(JobQueue& queue, bool newest, const JobCounter* onlyCounter, Job& outJob)
+{
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.jobs.empty()) return false;
+
+	size_t count = queue.jobs.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t index = newest ? count - 1 - i : i;
+		if (onlyCounter && queue.jobs[index].counter != onlyCounter) continue;
+
+		outJob = std::move(queue.jobs[index]);
+		queue.jobs.erase(queue.jobs.begin() + index);
+		queuedJobs--;
+		return true;
+	}
+	return false;
+}
+
+// Own queue first, then the shared queue, then steal from the other workers
+static bool popJob(const JobCounter* onlyCounter, Job& outJob)
+{
+	if (queuedJobs.load() == 0) return false;
+
+	if (workerIndex >= 0 && takeFromQueue(*queues[workerIndex], true, onlyCounter, outJob)) return true;
+
+	size_t queueCount = queues.size();
+	size_t first = workerIndex >= 0 ? static_cast<size_t>(workerIndex) + 1 : queueCount - 1;
+	for (size_t i = 0; i < queueCount; i++)
+	{
+		size_t index = (first + i) % queueCount;
+		if (static_cast<int>(index) == workerIndex) continue;
+
+		if (takeFromQueue(*queues[index], false, onlyCounter, outJob)) return true;
+	}
+	return false;
+}
+
+static void workerLoop(int index)
+{
+	workerIndex = index;
+	while (true)
+	{
+		Job job;
+		if (popJob(nullptr, job))
+		{
+			executeJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers++;
+		workAvailable.wait(lock, []() { return stopping.load() || queuedJobs.load() > 0; });
+		sleepingWorkers--;
+		if (stopping.load() && queuedJobs.load() == 0) return;
+	}
+}
+
+static void pinThread(std::thread& thread, uint32_t core)
+{
+	uint32_t coreCount = std::max(1u, std::thread::hardware_concurrency());
+	core %= coreCount;
+#ifdef _WIN32
+	if (core < 64)
+	{
+		SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+	}
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(core, &cpuSet);
+	pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet);
+#else
+	(void)thread;
+#endif
+}
+
+void JobSystem::init(uint32_t workerCount, bool pinThreads)
+{
+	if (!workers.empty())
+	{
+		throw std::runtime_error("JobSystem already initialised!");
+	}
+
+	if (workerCount == 0)
+	{
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	queues.clear();
+	for (uint32_t i = 0; i < workerCount + 1; i++)
+	{
+		queues.push_back(std::make_unique<JobQueue>());
+	}
+
+	stopping = false;
+	queuedJobs = 0;
+	for (uint32_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(workerLoop, static_cast<int>(i));
+		if (pinThreads)
+		{
+			pinThread(workers.back(), i + 1);
+		}
+	}
+	running = workerCount > 0;
+
+	printf("JobSystem: %u worker threads%s\n", workerCount, pinThreads ? " (pinned)" : "");
+}
+
+void JobSystem::shutdown()
+{
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	workAvailable.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+	running = false;
+
+	// Nothing is left behind if there were no workers to drain the queues
+	Job job;
+	while (!queues.empty() && popJob(nullptr, job))
+	{
+		executeJob(job);
+	}
+	queues.clear();
+}
+
+uint32_t JobSystem::getWorkerCount()
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+void JobSystem::run(std::function<void()> job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->pending++;
+	}
+
+	Job newJob = { std::move(job), counter };
+	if (!running.load())
+	{
+		executeJob(newJob);
+		return;
+	}
+
+	JobQueue& queue = *queues[workerIndex >= 0 ? static_cast<size_t>(workerIndex) : queues.size() - 1];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(newJob));
+	}
+	queuedJobs++;
+	pushCount++;
+	wakeSleepers(true, true);
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	// Only the counter's own jobs are taken: a frame waiting on a short parallelFor() never picks up a long job queued by someone else
+	while (counter.pending.load() > 0)
+	{
+		uint64_t seenPushCount = pushCount.load();
+		Job job;
+		if (running.load() && popJob(&counter, job))
+		{
+			executeJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWaiters++;
+		waitersWakeUp.wait(lock, [&counter, seenPushCount]() {
+			return counter.pending.load() == 0 || pushCount.load() != seenPushCount; });
+		sleepingWaiters--;
+	}
+
+	std::lock_guard<std::mutex> lock(counter.errorMutex);
+	if (counter.error)
+	{
+		std::exception_ptr error = counter.error;
+		counter.error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+// count when the work can't be split (no worker), the whole range then runs on the calling thread
+size_t JobSystem::getChunkSize(size_t count, size_t grainSize)
+{
+	if (!running.load()) return count;
+
+	size_t maxChunks = (workers.size() + 1) * JOB_CHUNKS_PER_THREAD;
+	return std::max(std::max<size_t>(1, grainSize), (count + maxChunks - 1) / maxChunks);
+}
+
+void JobSystem::runChunks(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body)
+{
+	JobCounter counter;
+	for (size_t begin = 0; begin < count; begin += chunkSize)
+	{
+		size_t end = std::min(count, begin + chunkSize);
+		run([&body, begin, end]() { body(begin, end); }, &counter);
+	}
+	wait(counter);
+}
+
+// exit() without shutdown() (init failure, ...) would destroy joinable threads, destroyed before the statics above
+static struct JobSystemExitGuard {
+	~JobSystemExitGuard()
+	{
+		if (!workers.empty()) JobSystem::shutdown();
+	}
+} exitGuard;
+
+TaskGraph::TaskGraph()
+{
+}
+
+TaskId TaskGraph::add(std::function<void()> function, const std::vector<TaskId>& dependencies)
+{
+	TaskId id = static_cast<TaskId>(tasks.size());
+	for (TaskId dependency : dependencies)
+	{
+		if (dependency >= id)
+		{
+			throw std::runtime_error("TaskGraph: dependency added after its dependent!");
+		}
+		tasks[dependency].dependents.push_back(id);
+	}
+
+	tasks.emplace_back();
+	tasks.back().function = std::move(function);
+	tasks.back().dependencyCount = static_cast<uint32_t>(dependencies.size());
+	return id;
+}
+
+void TaskGraph::execute()
+{
+	for (Task& task : tasks)
+	{
+		task.remainingDependencies = task.dependencyCount;
+	}
+
+	JobCounter counter;
+	for (TaskId id = 0; id < tasks.size(); id++)
+	{
+		if (tasks[id].dependencyCount == 0)
+		{
+			schedule(id, counter);
+		}
+	}
+	JobSystem::wait(counter);
+}
+
+size_t TaskGraph::getTaskCount()
+{
+	return tasks.size();
+}
+
+// Dependents are queued before this job's counter decrement, so the counter can't reach 0 while the graph still has work
+void TaskGraph::schedule(TaskId id, JobCounter& counter)
+{
+	JobSystem::run([this, id, &counter]() {
+		Task& task = tasks[id];
+		task.function();
+		for (TaskId dependent : task.dependents)
+		{
+			if (tasks[dependent].remainingDependencies.fetch_sub(1) == 1)
+			{
+				schedule(dependent, counter);
+			}
+		}
+	}, &counter);
+}
+
+TaskGraph::~TaskGraph()
+{
+}
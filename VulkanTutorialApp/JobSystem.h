@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <functional>
+#include <deque>
+#include <vector>
+
+// Jobs queued with this counter that haven't returned yet, JobSystem::wait() blocks until it is back to 0.
+// The first exception thrown by one of them is kept and rethrown by wait()
+struct JobCounter {
+	std::atomic<uint32_t> pending{ 0 };
+	std::mutex errorMutex;
+	std::exception_ptr error;
+};
+
+// One thread pool for the whole process (hardware threads - 1 workers), process wide like the CPU profiler.
+// Every worker owns a deque: it pushes and pops at the back (last queued job first, its data is still in cache) and steals
+// from the front of the others when its own runs dry. Threads outside the pool (main / render thread, ...) queue to a shared deque.
+// wait() runs the queued jobs it waits for on the calling thread instead of blocking it. Before init(), after shutdown() or without any worker
+// (single core machine) run() executes the job straight away on the calling thread
+class JobSystem
+{
+public:
+	// workerCount 0 = hardware threads - 1. pinThreads: worker i stays on core i + 1, core 0 is left to the main thread
+	static void init(uint32_t workerCount = 0, bool pinThreads = false);
+	// Runs what is still queued then joins the workers
+	static void shutdown();
+	static uint32_t getWorkerCount();
+
+	// Queues job, counter (optional) counts it until it returns
+	static void run(std::function<void()> job, JobCounter* counter = nullptr);
+	// Runs counter's queued jobs on the calling thread until counter is back to 0, rethrows the first exception of its jobs
+	static void wait(JobCounter& counter);
+	// body(begin, end) over [0, count) in chunks of at least grainSize items, the calling thread takes chunks too.
+	// Returns once every chunk is done. Work that fits in 1 chunk runs straight away, without building a std::function
+	template <typename Body>
+	static void parallelFor(size_t count, size_t grainSize, const Body& body)
+	{
+		size_t chunkSize = getChunkSize(count, grainSize);
+		if (chunkSize >= count)
+		{
+			if (count > 0) body(size_t(0), count);
+			return;
+		}
+		runChunks(count, chunkSize, body);
+	}
+
+private:
+	static size_t getChunkSize(size_t count, size_t grainSize);
+	static void runChunks(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body);
+};
+
+typedef uint32_t TaskId;
+
+// Tasks with dependencies, built up front then executed on the job system: a task is queued as soon as every task
+// it depends on returned, so independent branches run in parallel
+class TaskGraph
+{
+public:
+	TaskGraph();
+
+	// Dependencies have to be added first, so the graph can't have cycles
+	TaskId add(std::function<void()> function, const std::vector<TaskId>& dependencies = {});
+	// Runs every task and returns once they are all done, the calling thread takes tasks too. Can be executed again
+	void execute();
+	size_t getTaskCount();
+
+	~TaskGraph();
+
+private:
+	struct Task {
+		std::function<void()> function;
+		std::vector<TaskId> dependents;					// Tasks waiting on this one
+		uint32_t dependencyCount = 0;
+		std::atomic<uint32_t> remainingDependencies{ 0 };	// Not done yet in the current execute()
+	};
+	std::deque<Task> tasks;								// deque: Task can't move (atomic), nothing is relocated when adding
+
+	void schedule(TaskId id, JobCounter& counter);
+};
@@ -0,0 +1,202 @@
+#include "MemoryTracker.h"
+
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+#include "Utility.h"
+
+struct TrackedAllocation {
+	VkDeviceSize size;
+	uint32_t memoryTypeIndex;
+	MemoryCategory category;
+};
+
+static std::mutex trackerMutex;						// Import workers allocate staging memory too
+static VkPhysicalDevice trackedPhysicalDevice = VK_NULL_HANDLE;
+static VkPhysicalDeviceMemoryProperties memoryProperties = {};
+static PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;		// Null without VK_EXT_memory_budget
+static std::unordered_map<VkDeviceMemory, TrackedAllocation> allocations;
+static std::vector<MemoryUsage> heapUsage;
+static std::vector<MemoryUsage> typeUsage;
+static MemoryUsage categoryUsage[MEMORY_CATEGORY_COUNT];
+static std::vector<bool> heapOverBudget;			// Warned already, until the heap drops back under the threshold
+
+static void addUsage(MemoryUsage& usage, VkDeviceSize size)
+{
+	usage.currentBytes += size;
+	usage.peakBytes = std::max(usage.peakBytes, usage.currentBytes);
+	usage.allocationCount++;
+}
+
+static void removeUsage(MemoryUsage& usage, VkDeviceSize size)
+{
+	usage.currentBytes -= size;
+	usage.allocationCount--;
+}
+
+// Budget and usage of every heap, from the extension or estimated from the tracked bytes. Call with trackerMutex held
+static bool queryHeapBudgets(std::vector<VkDeviceSize>& outBudget, std::vector<VkDeviceSize>& outUsage)
+{
+	outBudget.resize(memoryProperties.memoryHeapCount);
+	outUsage.resize(memoryProperties.memoryHeapCount);
+
+	if (getMemoryProperties2 != nullptr)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties2.pNext = &budgetProperties;
+		getMemoryProperties2(trackedPhysicalDevice, &properties2);
+
+		for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+		{
+			outBudget[i] = budgetProperties.heapBudget[i];
+			outUsage[i] = budgetProperties.heapUsage[i];
+		}
+		return true;
+	}
+
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		outBudget[i] = memoryProperties.memoryHeaps[i].size;
+		outUsage[i] = heapUsage[i].currentBytes;
+	}
+	return false;
+}
+
+static double toMiB(VkDeviceSize bytes)
+{
+	return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void MemoryTracker::init(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled)
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+
+	trackedPhysicalDevice = physicalDevice;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	heapUsage.assign(memoryProperties.memoryHeapCount, MemoryUsage());
+	typeUsage.assign(memoryProperties.memoryTypeCount, MemoryUsage());
+	heapOverBudget.assign(memoryProperties.memoryHeapCount, false);
+
+	getMemoryProperties2 = budgetExtensionEnabled ?
+		(PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR") : nullptr;
+	if (getMemoryProperties2 == nullptr)
+	{
+		printf("Memory tracker: VK_EXT_memory_budget not available, budgets are the heap sizes\n");
+	}
+}
+
+VkResult MemoryTracker::allocateMemory(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category,
+	VkDeviceMemory* outMemory)
+{
+	uint32_t typeIndex = allocateInfo.memoryTypeIndex;
+	uint32_t heapIndex = typeIndex < memoryProperties.memoryTypeCount ? memoryProperties.memoryTypes[typeIndex].heapIndex : UINT32_MAX;
+
+	// Warn before the heap goes over budget, the driver may start paging or fail with VK_ERROR_OUT_OF_DEVICE_MEMORY past it
+	if (heapIndex != UINT32_MAX)
+	{
+		std::lock_guard<std::mutex> lock(trackerMutex);
+		std::vector<VkDeviceSize> budget, usage;
+		queryHeapBudgets(budget, usage);
+
+		VkDeviceSize projected = usage[heapIndex] + allocateInfo.allocationSize;
+		bool overThreshold = projected > static_cast<VkDeviceSize>(budget[heapIndex] * MEMORY_BUDGET_WARNING_RATIO);
+		if (overThreshold && !heapOverBudget[heapIndex])
+		{
+			printf("Memory tracker: WARNING heap %u at %.1f / %.1f MiB after a %.1f MiB %s allocation\n", heapIndex,
+				toMiB(projected), toMiB(budget[heapIndex]), toMiB(allocateInfo.allocationSize), getCategoryName(category));
+		}
+		heapOverBudget[heapIndex] = overThreshold;
+	}
+
+	VkResult result = vkAllocateMemory(device, &allocateInfo, nullptr, outMemory);
+	if (result != VK_SUCCESS)
+	{
+		printf("Memory tracker: %.1f MiB %s allocation from memory type %u failed (%d)\n",
+			toMiB(allocateInfo.allocationSize), getCategoryName(category), typeIndex, result);
+		return result;
+	}
+	if (heapIndex == UINT32_MAX) return result;
+
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	allocations[*outMemory] = { allocateInfo.allocationSize, typeIndex, category };
+	addUsage(heapUsage[heapIndex], allocateInfo.allocationSize);
+	addUsage(typeUsage[typeIndex], allocateInfo.allocationSize);
+	addUsage(categoryUsage[category], allocateInfo.allocationSize);
+	return result;
+}
+
+void MemoryTracker::freeMemory(VkDevice device, VkDeviceMemory memory)
+{
+	if (memory == VK_NULL_HANDLE) return;
+
+	vkFreeMemory(device, memory, nullptr);
+
+	std::lock_guard<std::mutex> lock(trackerMutex);
+	auto allocation = allocations.find(memory);
+	if (allocation == allocations.end()) return;
+
+	const TrackedAllocation& tracked = allocation->second;
+	removeUsage(heapUsage[memoryProperties.memoryTypes[tracked.memoryTypeIndex].heapIndex], tracked.size);
+	removeUsage(typeUsage[tracked.memoryTypeIndex], tracked.size);
+	removeUsage(categoryUsage[tracked.category], tracked.size);
+	allocations.erase(allocation);
+}
+
+MemorySnapshot MemoryTracker::getSnapshot()
+{
+	std::lock_guard<std::mutex> lock(trackerMutex);
+
+	MemorySnapshot snapshot;
+	std::vector<VkDeviceSize> budget, usage;
+	snapshot.budgetAvailable = queryHeapBudgets(budget, usage);
+
+	snapshot.heaps.resize(memoryProperties.memoryHeapCount);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+	{
+		snapshot.heaps[i].size = memoryProperties.memoryHeaps[i].size;
+		snapshot.heaps[i].flags = memoryProperties.memoryHeaps[i].flags;
+		snapshot.heaps[i].budget = budget[i];
+		snapshot.heaps[i].usage = usage[i];
+		snapshot.heaps[i].tracked = heapUsage[i];
+	}
+	snapshot.types = typeUsage;
+	for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+	{
+		snapshot.categories[c] = categoryUsage[c];
+	}
+	return snapshot;
+}
+
+void MemoryTracker::printSnapshot()
+{
+	MemorySnapshot snapshot = getSnapshot();
+
+	for (size_t i = 0; i < snapshot.heaps.size(); i++)
+	{
+		const MemoryHeapSnapshot& heap = snapshot.heaps[i];
+		if (heap.tracked.peakBytes == 0) continue;
+
+		printf("Memory heap %zu (%s): %.1f / %.1f MiB%s, tracked %.1f MiB (peak %.1f MiB, %u allocations)\n", i,
+			(heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? "device local" : "host",
+			toMiB(heap.usage), toMiB(heap.budget), snapshot.budgetAvailable ? " budget" : " heap size",
+			toMiB(heap.tracked.currentBytes), toMiB(heap.tracked.peakBytes), heap.tracked.allocationCount);
+	}
+
+	printf("Memory categories:");
+	for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+	{
+		printf(" %s %.1f MiB (peak %.1f)%s", getCategoryName(static_cast<MemoryCategory>(c)),
+			toMiB(snapshot.categories[c].currentBytes), toMiB(snapshot.categories[c].peakBytes),
+			c + 1 < MEMORY_CATEGORY_COUNT ? "," : "\n");
+	}
+}
+
+const char* MemoryTracker::getCategoryName(MemoryCategory category)
+{
+	static const char* const categoryNames[MEMORY_CATEGORY_COUNT] = { "geometry", "textures", "attachments", "uniforms", "staging" };
+	return category < MEMORY_CATEGORY_COUNT ? categoryNames[category] : "unknown";
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+
+// What a device memory allocation is used for
+enum MemoryCategory {
+	MEMORY_CATEGORY_GEOMETRY,			// Vertex, index, meshlet and cull output buffers
+	MEMORY_CATEGORY_TEXTURES,
+	MEMORY_CATEGORY_ATTACHMENTS,		// Depth and colour attachments
+	MEMORY_CATEGORY_UNIFORMS,
+	MEMORY_CATEGORY_STAGING,
+	MEMORY_CATEGORY_COUNT
+};
+
+struct MemoryUsage {
+	VkDeviceSize currentBytes = 0;
+	VkDeviceSize peakBytes = 0;
+	uint32_t allocationCount = 0;		// Live allocations
+};
+
+struct MemoryHeapSnapshot {
+	VkDeviceSize size;
+	VkMemoryHeapFlags flags;
+	VkDeviceSize budget;				// From VK_EXT_memory_budget, the heap size without it
+	VkDeviceSize usage;					// Whole process usage from VK_EXT_memory_budget, the tracked bytes without it
+	MemoryUsage tracked;				// Allocations made through the MemoryTracker
+};
+
+struct MemorySnapshot {
+	bool budgetAvailable;				// VK_EXT_memory_budget values, not estimates
+	std::vector<MemoryHeapSnapshot> heaps;
+	std::vector<MemoryUsage> types;		// Per memory type index
+	MemoryUsage categories[MEMORY_CATEGORY_COUNT];
+};
+
+// Bookkeeping of every vkAllocateMemory / vkFreeMemory, per heap, memory type and category.
+// Process wide (like the CPU profiler) so the static buffer helpers can use it without a renderer
+class MemoryTracker
+{
+public:
+	// Call once the device exists. budgetExtensionEnabled: VK_EXT_memory_budget is enabled on the device
+	// (and VK_KHR_get_physical_device_properties2 on the instance)
+	static void init(VkInstance instance, VkPhysicalDevice physicalDevice, bool budgetExtensionEnabled);
+
+	// vkAllocateMemory with bookkeeping, warns first when the allocation takes its heap past MEMORY_BUDGET_WARNING_RATIO of the budget
+	static VkResult allocateMemory(VkDevice device, const VkMemoryAllocateInfo& allocateInfo, MemoryCategory category,
+		VkDeviceMemory* outMemory);
+	// vkFreeMemory with bookkeeping, null handles are ignored
+	static void freeMemory(VkDevice device, VkDeviceMemory memory);
+
+	static MemorySnapshot getSnapshot();
+	// 1 line per heap in use and 1 line for the categories
+	static void printSnapshot();
+	static const char* getCategoryName(MemoryCategory category);
+};
@@ -1,12 +1,16 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
 Mesh::Mesh()
 {
 }
 
 Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue,
 	VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
-	int inTextureIndex)
+	int inTextureIndex, std::vector<MeshLod>* lods, std::vector<Meshlet>* meshlets)
 {
 	vertexCount = vertices->size();
 	indexCount = indices->size();
@@ -18,6 +22,55 @@ Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue trans
 	this->model.model = glm::mat4(1.0f);
 
 	textureIndex = inTextureIndex;
+
+	setLods(lods);
+	bounds = computeBounds(vertices->data(), vertices->size());
+
+	// Meshlets of LOD 0 for GPU culling
+	if (meshlets != nullptr && !meshlets->empty())
+	{
+		meshletCount = static_cast<uint32_t>(meshlets->size());
+		createMeshletBuffer(transferQueue, transferCommandPool, meshlets);
+	}
+}
+
+Mesh::Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, StagingUploader* uploader,
+	const StagingRegion& vertexRegion, uint32_t inVertexCount, const StagingRegion& indexRegion, uint32_t inIndexCount,
+	int inTextureIndex, const BoundingSphere& inBounds, std::vector<MeshLod>* lods, std::vector<Meshlet>* meshlets)
+{
+	vertexCount = inVertexCount;
+	indexCount = inIndexCount;
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+
+	// Device buffers only, the data is already in staging memory and gets copied over when the uploader flushes
+	createBuffer(physicalDevice, device, vertexRegion.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &vertexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	uploader->copyToBuffer(vertexRegion, vertexBuffer);
+
+	createBuffer(physicalDevice, device, indexRegion.size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	uploader->copyToBuffer(indexRegion, indexBuffer);
+
+	this->model.model = glm::mat4(1.0f);
+
+	textureIndex = inTextureIndex;
+
+	setLods(lods);
+	bounds = inBounds;
+
+	if (meshlets != nullptr && !meshlets->empty())
+	{
+		meshletCount = static_cast<uint32_t>(meshlets->size());
+		VkDeviceSize meshletSize = sizeof(Meshlet) * static_cast<VkDeviceSize>(meshlets->size());
+
+		StagingRegion meshletRegion = uploader->allocate(meshletSize);
+		memcpy(meshletRegion.data, meshlets->data(), (size_t)meshletSize);
+
+		createBuffer(physicalDevice, device, meshletSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshletBuffer, &meshletBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+		uploader->copyToBuffer(meshletRegion, meshletBuffer);
+	}
 }
 
 int Mesh::getVertexCount()
@@ -45,19 +98,19 @@ void Mesh::setModel(glm::mat4 inModel)
 	this->model.model = inModel;
 }
 
-void Mesh::setPushConstData(glm::vec3 inPushConst)
+void Mesh::setTextureIndex(int inTextureIndex)
 {
-	this->pushConstData.pushConstData = inPushConst;
+	this->textureIndex = inTextureIndex;
 }
 
-Model Mesh::getModel()
+void Mesh::setTextureLayer(uint32_t layer)
 {
-	return this->model;
+	this->textureLayer = layer;
 }
 
-PushConstBlock Mesh::getPushConstData()
+Model Mesh::getModel()
 {
-	return this->pushConstData;
+	return this->model;
 }
 
 int Mesh::getTextureIndex()
@@ -65,12 +118,149 @@ int Mesh::getTextureIndex()
 	return this->textureIndex;
 }
 
+uint32_t Mesh::getTextureLayer()
+{
+	return this->textureLayer;
+}
+
+int Mesh::getLodCount()
+{
+	return static_cast<int>(lodList.size());
+}
+
+const MeshLod& Mesh::getLod(int level)
+{
+	return lodList[level];
+}
+
+int Mesh::getCurrentLod()
+{
+	return currentLod;
+}
+
+BoundingSphere Mesh::getBounds()
+{
+	return bounds;
+}
+
+uint32_t Mesh::getMeshletCount()
+{
+	return meshletCount;
+}
+
+VkBuffer Mesh::getMeshletBuffer()
+{
+	return meshletBuffer;
+}
+
+VkBuffer Mesh::getCullOutputBuffer()
+{
+	return cullOutputBuffer;
+}
+
+VkDeviceSize Mesh::getCullOutputSlotSize()
+{
+	return cullOutputSlotSize;
+}
+
+VkDescriptorSet Mesh::getCullDescriptorSet()
+{
+	return cullDescriptorSet;
+}
+
+bool Mesh::usesMeshletCulling()
+{
+	// Meshlets only cover LOD 0, coarser levels are drawn directly
+	return cullDescriptorSet != VK_NULL_HANDLE && currentLod == 0;
+}
+
+void Mesh::setCurrentLod(int level)
+{
+	currentLod = level;
+}
+
+void Mesh::setCullDescriptorSet(VkDescriptorSet descriptorSet)
+{
+	cullDescriptorSet = descriptorSet;
+}
+
+void Mesh::setDebugName(const std::string& name)
+{
+	if (!DebugUtils::isEnabled()) return;
+
+	debugName = name;
+	DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, vertexBuffer, debugName + " vertices");
+	DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, indexBuffer, debugName + " indices");
+	DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, meshletBuffer, debugName + " meshlets");
+	DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, cullOutputBuffer, debugName + " cull output");
+}
+
+const std::string& Mesh::getDebugName()
+{
+	return debugName;
+}
+
+void Mesh::createCullOutputBuffer(size_t slotCount, VkDeviceSize slotAlignment)
+{
+	// Each slot holds the indirect draw header followed by room for every LOD 0 index, aligned so it can be bound with a dynamic offset
+	VkDeviceSize slotSize = CULL_OUTPUT_HEADER_SIZE + sizeof(uint32_t) * static_cast<VkDeviceSize>(lodList[0].indexCount);
+	cullOutputSlotSize = (slotSize + slotAlignment - 1) & ~(slotAlignment - 1);
+
+	createBuffer(physicalDevice, device, cullOutputSlotSize * slotCount,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &cullOutputBuffer, &cullOutputBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+	if (!debugName.empty())
+	{
+		DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, cullOutputBuffer, debugName + " cull output");
+	}
+}
+
+void Mesh::setLods(std::vector<MeshLod>* lods)
+{
+	// Level of detail ranges, without a LOD chain the whole index buffer is LOD 0
+	if (lods != nullptr && !lods->empty())
+	{
+		lodList = *lods;
+	}
+	else
+	{
+		lodList = { { 0, static_cast<uint32_t>(indexCount), 0.0f } };
+	}
+}
+
+BoundingSphere Mesh::computeBounds(const Vertex* vertices, size_t vertexCount)
+{
+	// Center of the axis aligned box, radius to the farthest vertex from it
+	BoundingSphere sphere = {};
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		minPos = glm::min(minPos, vertices[i].pos);
+		maxPos = glm::max(maxPos, vertices[i].pos);
+	}
+	sphere.center = (vertexCount == 0) ? glm::vec3(0.0f) : (minPos + maxPos) * 0.5f;
+
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 offset = vertices[i].pos - sphere.center;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	sphere.radius = std::sqrt(radiusSquared);
+	return sphere;
+}
+
 void Mesh::destroyBuffers()
 {
 	vkDestroyBuffer(device, vertexBuffer, nullptr);
-	vkFreeMemory(device, vertexBufferMemory, nullptr);
+	MemoryTracker::freeMemory(device, vertexBufferMemory);
 	vkDestroyBuffer(device, indexBuffer, nullptr);
-	vkFreeMemory(device, indexBufferMemory, nullptr);
+	MemoryTracker::freeMemory(device, indexBufferMemory);
+	vkDestroyBuffer(device, meshletBuffer, nullptr);				// Null handles are ignored for meshes without meshlets
+	MemoryTracker::freeMemory(device, meshletBufferMemory);
+	vkDestroyBuffer(device, cullOutputBuffer, nullptr);
+	MemoryTracker::freeMemory(device, cullOutputBufferMemory);
 }
 
 
@@ -88,7 +278,7 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 	VkDeviceMemory stagingBufferMemory;
 	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, // VK_BUFFER_USAGE_TRANSFER_SRC_BIT indicate that this buffer is ready to be transferred
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&stagingBuffer, &stagingBufferMemory);
+		&stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
 
 	// Copy date to staging buffer memory
 	void* data;																	// 1. Create pointer to a point in normal memory
@@ -98,14 +288,14 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 
 	// Create buffer with TRANSFER DESTINATION BIT as the recipient of data copied
 	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,	// the bit or '|' specifies this usage is defined by both of these types
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &vertexBufferMemory);											// VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT specifies this buffer is only accessible by GPU
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &vertexBuffer, &vertexBufferMemory, MEMORY_CATEGORY_GEOMETRY);											// VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT specifies this buffer is only accessible by GPU
 
 	// Copy staging buffer to vertex buffer on GPU
 	copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, vertexBuffer, bufferSize);
 
 	// Clean up staging buffer parts
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	MemoryTracker::freeMemory(device, stagingBufferMemory);
 }
 
 void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool,
@@ -118,7 +308,7 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 	VkBuffer stagingIndexBuffer;
 	VkDeviceMemory stagingIndexBufferMemory;
 	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingIndexBuffer, &stagingIndexBufferMemory);
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingIndexBuffer, &stagingIndexBufferMemory, MEMORY_CATEGORY_STAGING);
 
 	// Copy index data to staging memory
 	void* data;
@@ -126,17 +316,40 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 	memcpy(data, indices->data(), (size_t)bufferSize);
 	vkUnmapMemory(device, stagingIndexBufferMemory);
 
-	// Create buffer for INDEX data on GPU access only area
-	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,	// Note the usage here is INDEX BUFFER
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexBufferMemory);
+	// Create buffer for INDEX data on GPU access only area, also readable as storage buffer by the meshlet culling pass
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,	// Note the usage here is INDEX BUFFER
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &indexBuffer, &indexBufferMemory, MEMORY_CATEGORY_GEOMETRY);
 
 	// Copy from staging buffer to GPU access buffer
 	copyBuffer(device, transferQueue, transferCommandPool, stagingIndexBuffer, indexBuffer, bufferSize);
 
 	// Destroy + Release Staging Buffer resources
 	vkDestroyBuffer(device, stagingIndexBuffer, nullptr);
-	vkFreeMemory(device, stagingIndexBufferMemory, nullptr);
+	MemoryTracker::freeMemory(device, stagingIndexBufferMemory);
 }
 
+void Mesh::createMeshletBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool,
+	std::vector<Meshlet>* meshlets)
+{
+	VkDeviceSize bufferSize = sizeof(Meshlet) * static_cast<uint64_t>(meshlets->size());
 
+	// Stage the meshlet bounds
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
 
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	memcpy(data, meshlets->data(), (size_t)bufferSize);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	// Storage buffer read by the meshlet culling compute shader
+	createBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &meshletBuffer, &meshletBufferMemory, MEMORY_CATEGORY_GEOMETRY);
+
+	copyBuffer(device, transferQueue, transferCommandPool, stagingBuffer, meshletBuffer, bufferSize);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	MemoryTracker::freeMemory(device, stagingBufferMemory);
+}
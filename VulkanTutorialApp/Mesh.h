@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include "Utility.h"
+#include "StagingUploader.h"
+#include "DebugUtils.h"
 
 class Mesh
 {
@@ -11,19 +13,44 @@ public:
 	Mesh();
 	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue, 
 		VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
-		int inTextureIndex); // constructor to create buffer
+		int inTextureIndex, std::vector<MeshLod>* lods = nullptr, std::vector<Meshlet>* meshlets = nullptr); // constructor to create buffer, lods = nullptr means the whole index list is LOD 0
+	Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, StagingUploader* uploader,
+		const StagingRegion& vertexRegion, uint32_t inVertexCount, const StagingRegion& indexRegion, uint32_t inIndexCount,
+		int inTextureIndex, const BoundingSphere& inBounds, std::vector<MeshLod>* lods, std::vector<Meshlet>* meshlets); // constructor for data already written to staging memory, the copies run on uploader->flush()
 	void destroyBuffers();
 
+	// Object space bounding sphere of a vertex list
+	static BoundingSphere computeBounds(const Vertex* vertices, size_t vertexCount);
+
 	int getVertexCount(); //get the number of vertex and pass to vkCmdDraw()
 	VkBuffer getVertexBuffer();
 	int getIndexCount();
 	VkBuffer getIndexBuffer();
 	Model getModel();
-	PushConstBlock getPushConstData();
 	int getTextureIndex();
+	uint32_t getTextureLayer();
+	int getLodCount();
+	const MeshLod& getLod(int level);
+	int getCurrentLod();
+	BoundingSphere getBounds();
+	uint32_t getMeshletCount();
+	VkBuffer getMeshletBuffer();
+	VkBuffer getCullOutputBuffer();
+	VkDeviceSize getCullOutputSlotSize();
+	VkDescriptorSet getCullDescriptorSet();
+	bool usesMeshletCulling();
 
 	void setModel(glm::mat4 inModel);
-	void setPushConstData(glm::vec3 inPushConst);
+	void setTextureIndex(int inTextureIndex);
+	void setTextureLayer(uint32_t layer);
+	void setCurrentLod(int level);
+	void setCullDescriptorSet(VkDescriptorSet descriptorSet);
+	// Debug utils name of every buffer of the mesh, e.g. the source asset file name
+	void setDebugName(const std::string& name);
+	const std::string& getDebugName();
+
+	// - Meshlet culling output, 1 slot (draw command + culled indices) per frame
+	void createCullOutputBuffer(size_t slotCount, VkDeviceSize slotAlignment);
 
 	~Mesh();
 
@@ -40,12 +67,31 @@ private:
 	VkDevice device;
 
 	Model model;
-	PushConstBlock pushConstData;
 	int textureIndex;
+	uint32_t textureLayer = 0;			// Layer of the texture array, only packed textures have more than 1
+
+	// Level of detail
+	std::vector<MeshLod> lodList;		// Ranges of every level inside the index buffer, LOD 0 is full resolution
+	int currentLod = 0;					// Level picked last frame, used for hysteresis
+	BoundingSphere bounds;				// Object space bounds, used to project the LOD error to the screen
+
+	// Meshlets (clusters of LOD 0), culled on the GPU before drawing
+	uint32_t meshletCount = 0;
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletBufferMemory = VK_NULL_HANDLE;
+	VkBuffer cullOutputBuffer = VK_NULL_HANDLE;				// Written by the culling pass, read as indirect draw + index buffer
+	VkDeviceMemory cullOutputBufferMemory = VK_NULL_HANDLE;
+	VkDeviceSize cullOutputSlotSize = 0;
+	VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;		// Allocated from the renderer's pool, freed with the pool
+
+	std::string debugName;				// Empty unless debug utils are enabled
 
+	void setLods(std::vector<MeshLod>* lods);
 	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, 
 		std::vector<Vertex>* vertices);
 	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool,
 		std::vector<uint32_t>* indices);
+	void createMeshletBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool,
+		std::vector<Meshlet>* meshlets);
 };
 
@@ -0,0 +1,283 @@
+#include "MeshSimplifier.h"
+
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	// A candidate collapse: move vertex "from" onto vertex "to"
+	struct Collapse {
+		double cost;
+		uint32_t from;
+		uint32_t to;
+		uint32_t version;		// version of "from" when the candidate was pushed, stale candidates are skipped
+
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		if (a > b) std::swap(a, b);
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+}
+
+MeshSimplifier::Quadric MeshSimplifier::planeQuadric(const glm::dvec3& n, double d)
+{
+	// Q = p * p^T with the plane p = (n, d), this measures the squared distance of a point to the plane
+	Quadric q;
+	q.a00 = n.x * n.x;	q.a01 = n.x * n.y;	q.a02 = n.x * n.z;	q.a03 = n.x * d;
+	q.a11 = n.y * n.y;	q.a12 = n.y * n.z;	q.a13 = n.y * d;
+	q.a22 = n.z * n.z;	q.a23 = n.z * d;
+	q.a33 = d * d;
+	return q;
+}
+
+void MeshSimplifier::addQuadric(Quadric& dst, const Quadric& src)
+{
+	dst.a00 += src.a00;	dst.a01 += src.a01;	dst.a02 += src.a02;	dst.a03 += src.a03;
+	dst.a11 += src.a11;	dst.a12 += src.a12;	dst.a13 += src.a13;
+	dst.a22 += src.a22;	dst.a23 += src.a23;
+	dst.a33 += src.a33;
+}
+
+double MeshSimplifier::evaluateQuadric(const Quadric& q, const glm::vec3& p)
+{
+	// v^T * Q * v with v = (p, 1)
+	double x = p.x, y = p.y, z = p.z;
+	double error = q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z + 2.0 * q.a03 * x
+		+ q.a11 * y * y + 2.0 * q.a12 * y * z + 2.0 * q.a13 * y
+		+ q.a22 * z * z + 2.0 * q.a23 * z
+		+ q.a33;
+	return std::max(error, 0.0);		// Rounding can push the error slightly below 0
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const Vertex* vertices, size_t vertexCount, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float* outError)
+{
+	size_t triangleCount = indices.size() / 3;
+
+	// Working copy of the triangles, collapses rewrite the corners in place
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+	std::vector<bool> triangleAlive(triangleCount, true);
+	size_t aliveTriangleCount = triangleCount;
+
+	// VERTEX QUADRICS + ADJACENCY ========================================================
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);		// Triangles using each vertex
+	std::unordered_map<uint64_t, int> edgeUseCount;							// How many triangles use each edge
+	edgeUseCount.reserve(triangleCount * 3);
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		uint32_t i0 = triangles[t * 3 + 0], i1 = triangles[t * 3 + 1], i2 = triangles[t * 3 + 2];
+		glm::dvec3 p0 = vertices[i0].pos, p1 = vertices[i1].pos, p2 = vertices[i2].pos;
+
+		glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+		double length = glm::length(normal);
+		if (length > 0.0)
+		{
+			normal /= length;
+			Quadric q = planeQuadric(normal, -glm::dot(normal, p0));
+			addQuadric(quadrics[i0], q);
+			addQuadric(quadrics[i1], q);
+			addQuadric(quadrics[i2], q);
+		}
+
+		vertexTriangles[i0].push_back(static_cast<uint32_t>(t));
+		vertexTriangles[i1].push_back(static_cast<uint32_t>(t));
+		vertexTriangles[i2].push_back(static_cast<uint32_t>(t));
+
+		edgeUseCount[edgeKey(i0, i1)]++;
+		edgeUseCount[edgeKey(i1, i2)]++;
+		edgeUseCount[edgeKey(i2, i0)]++;
+	}
+
+	// LOCKED VERTICES ====================================================================
+	// Every edge that is not shared by exactly 2 triangles is a border. aiProcess_JoinIdenticalVertices only merges vertices whose
+	// attributes all match, so a UV seam splits the topology and shows up as a border too. Locking border vertices keeps both the
+	// silhouette of open meshes and the UV seams intact
+	std::vector<bool> locked(vertexCount, false);
+	for (const auto& edge : edgeUseCount)
+	{
+		if (edge.second != 2)
+		{
+			locked[static_cast<uint32_t>(edge.first >> 32)] = true;
+			locked[static_cast<uint32_t>(edge.first & 0xffffffff)] = true;
+		}
+	}
+
+	// CANDIDATE COLLAPSES ================================================================
+	std::vector<uint32_t> remap(vertexCount);				// Vertex a vertex has been collapsed onto (itself if still alive)
+	std::vector<uint32_t> version(vertexCount, 0);
+	for (size_t i = 0; i < vertexCount; i++) remap[i] = static_cast<uint32_t>(i);
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+	auto pushCandidates = [&](uint32_t from) {
+		if (locked[from] || remap[from] != from) return;
+
+		// Pick the cheapest neighbour to collapse onto
+		Collapse best = { std::numeric_limits<double>::max(), from, from, version[from] };
+		for (uint32_t t : vertexTriangles[from])
+		{
+			if (!triangleAlive[t]) continue;
+			for (int c = 0; c < 3; c++)
+			{
+				uint32_t to = triangles[t * 3 + c];
+				if (to == from) continue;
+
+				Quadric q = quadrics[from];
+				addQuadric(q, quadrics[to]);
+				double cost = evaluateQuadric(q, vertices[to].pos);
+				if (cost < best.cost)
+				{
+					best.cost = cost;
+					best.to = to;
+				}
+			}
+		}
+		if (best.to != from) heap.push(best);
+	};
+
+	for (uint32_t i = 0; i < vertexCount; i++) pushCandidates(i);
+
+	// COLLAPSE LOOP ======================================================================
+	double maxError = 0.0;
+	std::vector<uint32_t> touched;
+	while (aliveTriangleCount * 3 > targetIndexCount && !heap.empty())
+	{
+		Collapse collapse = heap.top();
+		heap.pop();
+
+		if (remap[collapse.from] != collapse.from || remap[collapse.to] != collapse.to ||
+			collapse.version != version[collapse.from])
+		{
+			continue;		// Stale candidate, one of the vertices has changed since it was pushed
+		}
+
+		// Reject the collapse if it flips any triangle that survives it
+		bool flips = false;
+		glm::vec3 newPos = vertices[collapse.to].pos;
+		for (uint32_t t : vertexTriangles[collapse.from])
+		{
+			if (!triangleAlive[t]) continue;
+			uint32_t* tri = &triangles[t * 3];
+			if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) continue;	// Will be removed
+
+			glm::vec3 p[3], q[3];
+			for (int c = 0; c < 3; c++)
+			{
+				p[c] = vertices[tri[c]].pos;
+				q[c] = (tri[c] == collapse.from) ? newPos : p[c];
+			}
+			glm::vec3 oldNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+			glm::vec3 newNormal = glm::cross(q[1] - q[0], q[2] - q[0]);
+			if (glm::dot(oldNormal, newNormal) <= 0.0f)
+			{
+				flips = true;
+				break;
+			}
+		}
+		if (flips)
+		{
+			// Block this vertex for now, it gets re-evaluated if a neighbour collapses onto it later
+			version[collapse.from]++;
+			continue;
+		}
+
+		// Apply the collapse
+		remap[collapse.from] = collapse.to;
+		addQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+		maxError = std::max(maxError, collapse.cost);
+
+		touched.clear();
+		for (uint32_t t : vertexTriangles[collapse.from])
+		{
+			if (!triangleAlive[t]) continue;
+			uint32_t* tri = &triangles[t * 3];
+			for (int c = 0; c < 3; c++)
+			{
+				if (tri[c] == collapse.from) tri[c] = collapse.to;
+			}
+			if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+			{
+				triangleAlive[t] = false;		// Degenerated by the collapse
+				aliveTriangleCount--;
+			}
+			else
+			{
+				vertexTriangles[collapse.to].push_back(t);
+			}
+			for (int c = 0; c < 3; c++) touched.push_back(tri[c]);
+		}
+
+		// Neighbourhood changed, refresh the candidates around it
+		for (uint32_t v : touched)
+		{
+			if (remap[v] != v) continue;
+			version[v]++;
+			pushCandidates(v);
+		}
+	}
+
+	// Gather surviving triangles
+	std::vector<uint32_t> result;
+	result.reserve(aliveTriangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!triangleAlive[t]) continue;
+		result.push_back(triangles[t * 3 + 0]);
+		result.push_back(triangles[t * 3 + 1]);
+		result.push_back(triangles[t * 3 + 2]);
+	}
+
+	*outError = static_cast<float>(std::sqrt(maxError));		// Quadric error is a squared distance
+	return result;
+}
+
+void MeshSimplifier::buildLodChain(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& indices,
+	std::vector<MeshLod>& outLods)
+{
+	outLods.clear();
+
+	// LOD 0 is the full resolution mesh
+	MeshLod baseLod = {};
+	baseLod.firstIndex = 0;
+	baseLod.indexCount = static_cast<uint32_t>(indices.size());
+	baseLod.error = 0.0f;
+	outLods.push_back(baseLod);
+
+	size_t baseIndexCount = indices.size();
+	if (baseIndexCount < LOD_MIN_INDEX_COUNT) return;		// Too small to be worth simplifying
+
+	// Each level targets half the triangles of the previous one, always simplifying from the original so the error is measured against it
+	std::vector<uint32_t> baseIndices = indices;
+	size_t targetIndexCount = baseIndexCount;
+	float lastError = 0.0f;
+	while (outLods.size() < MAX_LOD_LEVELS)
+	{
+		targetIndexCount /= 2;
+
+		float error = 0.0f;
+		std::vector<uint32_t> lodIndices = simplify(vertices, vertexCount, baseIndices, targetIndexCount, &error);
+
+		// Stop when the simplifier can't make meaningful progress anymore (locked borders, tiny meshes)
+		uint32_t previousCount = outLods.back().indexCount;
+		if (lodIndices.empty() || lodIndices.size() > previousCount * 0.85f) break;
+
+		MeshLod lod = {};
+		lod.firstIndex = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+		lod.error = std::max(error, lastError);						// Keep the error monotonic along the chain
+		lastError = lod.error;
+		outLods.push_back(lod);
+
+		// Levels are stored contiguously after LOD 0 in the same index data
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+
+		targetIndexCount = lodIndices.size();
+	}
+}
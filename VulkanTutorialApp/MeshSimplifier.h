@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Utility.h"
+
+// Quadric error edge-collapse simplifier used to build the LOD chain of imported meshes.
+// Collapses only move a vertex onto one of its neighbours, so every level reuses the original vertex buffer and only the index data changes
+class MeshSimplifier
+{
+public:
+	// Simplify the triangle list down to (about) targetIndexCount indices, returns the new index list and the geometric error (object space distance) in outError
+	static std::vector<uint32_t> simplify(const Vertex* vertices, size_t vertexCount, const std::vector<uint32_t>& indices,
+		size_t targetIndexCount, float* outError);
+
+	// Append up to MAX_LOD_LEVELS - 1 coarser levels after the full resolution indices, the ranges of every level (LOD 0 included) are written to outLods
+	static void buildLodChain(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& indices,
+		std::vector<MeshLod>& outLods);
+
+private:
+	// Symmetric 4x4 error quadric, only the upper triangle is stored
+	struct Quadric {
+		double a00, a01, a02, a03;
+		double a11, a12, a13;
+		double a22, a23;
+		double a33;
+	};
+
+	static Quadric planeQuadric(const glm::dvec3& normal, double d);
+	static void addQuadric(Quadric& dst, const Quadric& src);
+	static double evaluateQuadric(const Quadric& q, const glm::vec3& p);
+};
@@ -0,0 +1,168 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+void MeshletBuilder::build(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& indices,
+	std::vector<Meshlet>& outMeshlets)
+{
+	outMeshlets.clear();
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) return;
+
+	// VERTEX -> TRIANGLE ADJACENCY (compressed, offsets + list) ===========================
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) adjacencyOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	// GREEDY GROWTH ======================================================================
+	// Start a meshlet from the first free triangle, then keep adding the free neighbour that brings in the fewest new vertices
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> vertexStamp(vertexCount, std::numeric_limits<uint32_t>::max());	// == meshlet id when the vertex is already in the current meshlet
+	std::vector<uint32_t> reordered;
+	reordered.reserve(triangleCount * 3);
+
+	std::vector<uint32_t> meshletVertices;
+	size_t scanTriangle = 0;
+	uint32_t meshletId = 0;
+	size_t emittedCount = 0;
+
+	while (emittedCount < triangleCount)
+	{
+		uint32_t firstIndex = static_cast<uint32_t>(reordered.size());
+		uint32_t meshletTriangles = 0;
+		meshletVertices.clear();
+
+		auto newVertexCount = [&](size_t t) {
+			uint32_t count = 0;
+			for (int c = 0; c < 3; c++)
+			{
+				if (vertexStamp[indices[t * 3 + c]] != meshletId) count++;
+			}
+			return count;
+		};
+
+		auto addTriangle = [&](size_t t) {
+			for (int c = 0; c < 3; c++)
+			{
+				uint32_t v = indices[t * 3 + c];
+				if (vertexStamp[v] != meshletId)
+				{
+					vertexStamp[v] = meshletId;
+					meshletVertices.push_back(v);
+				}
+				reordered.push_back(v);
+			}
+			emitted[t] = true;
+			emittedCount++;
+			meshletTriangles++;
+		};
+
+		while (meshletTriangles < MESHLET_MAX_TRIANGLES)
+		{
+			// Best free triangle touching the meshlet
+			size_t best = triangleCount;
+			uint32_t bestNew = 4;
+			for (uint32_t v : meshletVertices)
+			{
+				for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++)
+				{
+					uint32_t t = adjacency[a];
+					if (emitted[t]) continue;
+					uint32_t count = newVertexCount(t);
+					if (count < bestNew)
+					{
+						bestNew = count;
+						best = t;
+					}
+				}
+				if (bestNew == 0) break;
+			}
+
+			// Nothing connected left, continue with the next free triangle in the original order
+			if (best == triangleCount)
+			{
+				while (scanTriangle < triangleCount && emitted[scanTriangle]) scanTriangle++;
+				if (scanTriangle == triangleCount) break;
+				best = scanTriangle;
+				bestNew = newVertexCount(best);
+			}
+
+			if (meshletVertices.size() + bestNew > MESHLET_MAX_VERTICES) break;		// Meshlet is full
+			addTriangle(best);
+		}
+
+		uint32_t indexCount = static_cast<uint32_t>(reordered.size()) - firstIndex;
+		outMeshlets.push_back(computeMeshletBounds(vertices, reordered.data() + firstIndex, firstIndex, indexCount));
+		meshletId++;
+	}
+
+	indices.swap(reordered);
+}
+
+Meshlet MeshletBuilder::computeMeshletBounds(const Vertex* vertices, const uint32_t* meshletIndices,
+	uint32_t firstIndex, uint32_t indexCount)
+{
+	Meshlet meshlet = {};
+	meshlet.firstIndex = firstIndex;
+	meshlet.indexCount = indexCount;
+
+	// BOUNDING SPHERE (center of the box, radius to the farthest vertex) =================
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		minPos = glm::min(minPos, vertices[meshletIndices[i]].pos);
+		maxPos = glm::max(maxPos, vertices[meshletIndices[i]].pos);
+	}
+	glm::vec3 center = (minPos + maxPos) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < indexCount; i++)
+	{
+		radius = std::max(radius, glm::length(vertices[meshletIndices[i]].pos - center));
+	}
+	meshlet.sphere = glm::vec4(center, radius);
+
+	// NORMAL CONE ========================================================================
+	// Axis is the average triangle normal, the cutoff is the sine of the widest angle between any triangle normal and the axis.
+	// The meshlet is back facing when dot(center - camera, axis) >= cutoff * |center - camera| + radius
+	std::vector<glm::vec3> normals;
+	normals.reserve(indexCount / 3);
+	glm::vec3 axis(0.0f);
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		glm::vec3 p0 = vertices[meshletIndices[i]].pos;
+		glm::vec3 p1 = vertices[meshletIndices[i + 1]].pos;
+		glm::vec3 p2 = vertices[meshletIndices[i + 2]].pos;
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);		// Counter clockwise front faces, same as the rasterizer setup
+		float length = glm::length(normal);
+		if (length <= 0.0f) continue;
+		normals.push_back(normal / length);
+		axis += normal / length;
+	}
+
+	float axisLength = glm::length(axis);
+	float minDot = 1.0f;
+	if (axisLength > 0.0f)
+	{
+		axis /= axisLength;
+		for (const glm::vec3& normal : normals) minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	if (axisLength <= 0.0f || minDot <= 0.0f)
+	{
+		meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);		// Normals spread over more than a hemisphere, never cull by cone
+	}
+	else
+	{
+		meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+	}
+
+	return meshlet;
+}
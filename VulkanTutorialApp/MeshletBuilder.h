@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "Utility.h"
+
+// Splits a triangle list into small clusters (meshlets) that can be culled on their own by the meshlet culling compute pass
+class MeshletBuilder
+{
+public:
+	// Reorders the triangles of indices so every meshlet is a contiguous index range, and fills the bounding sphere + normal cone of each meshlet
+	static void build(const Vertex* vertices, size_t vertexCount, std::vector<uint32_t>& indices,
+		std::vector<Meshlet>& outMeshlets);
+
+private:
+	static Meshlet computeMeshletBounds(const Vertex* vertices, const uint32_t* meshletIndices,
+		uint32_t firstIndex, uint32_t indexCount);
+};
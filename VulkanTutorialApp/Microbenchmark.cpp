@@ -0,0 +1,616 @@
+#define STB_IMAGE_IMPLEMENTATION	// Need this define to activate stb library
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // opengl the depth value (-1.0, 1.0), in vulkan it's (0.0, 1.0)
+
+// Microbenchmarks of the CPU hot paths: mesh import, model matrix packing, job scheduling, frame recording, texture decoding / packing and file reading.
+// Linked against MockVulkan instead of the Vulkan loader, so nothing here touches a GPU and the numbers only depend on the CPU.
+// Each benchmark reports ns/op, bytes/s (bytes produced or read per op) and heap allocations/op (operator new, this process only)
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include "VulkanRenderer.h"
+#include "StagingUploader.h"
+#include "MockVulkan.h"
+
+const char* const MICROBENCHMARK_SCENE_FILE = "microbenchmark_grid.obj";	// Written to the temp directory for the draw benchmark, removed afterwards
+const uint32_t MICROBENCHMARK_SCENE_PARTS = 8;						// Meshes per imported grid scene
+const uint32_t MICROBENCHMARK_SCENE_GRID = 32;						// Vertices per side of each of those meshes
+
+struct MicrobenchmarkConfig {
+	std::string filter;								// Only run the benchmarks whose name contains this
+	double minSeconds = 0.5;						// Measured time per benchmark, on top of 1 warm up op
+	uint64_t minIterations = 1;						// The big imports take seconds per op
+	std::string outputFile;							// JSON results, none when empty
+	uint32_t workerCount = 0;						// Job system workers, 0 = hardware threads - 1
+};
+
+struct MicrobenchmarkResult {
+	std::string name;
+	uint64_t iterations;
+	double nsPerOp;
+	double bytesPerSecond;							// 0 when the benchmark doesn't process a byte stream
+	double allocationsPerOp;
+};
+
+// -- ALLOCATION COUNTING ------------------------------------------------------------------
+// Every operator new of this binary goes through here. Allocations made inside DLLs (assimp, shaderc) and by malloc (stb_image) aren't seen
+
+static std::atomic<uint64_t> allocationCount(0);
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t /*size*/) noexcept
+{
+	free(memory);
+}
+
+// -- HARNESS ------------------------------------------------------------------------------
+
+MicrobenchmarkConfig config;
+std::vector<MicrobenchmarkResult> results;
+
+// --name=value arguments, anything unknown is ignored
+MicrobenchmarkConfig parseArguments(int argc, char** argv) {
+	MicrobenchmarkConfig parsed;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		size_t equals = arg.find('=');
+		std::string name = arg.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+		if (name == "--filter") parsed.filter = value;
+		else if (name == "--min-time") parsed.minSeconds = std::stod(value);
+		else if (name == "--min-iterations") parsed.minIterations = std::stoull(value);
+		else if (name == "--output") parsed.outputFile = value;
+		else if (name == "--workers") parsed.workerCount = static_cast<uint32_t>(std::stoul(value));
+	}
+	return parsed;
+}
+
+bool isSelected(const std::string& name) {
+	return config.filter.empty() || name.find(config.filter) != std::string::npos;
+}
+
+// Runs op once to warm up, then until both the minimum time and the minimum iteration count are reached.
+// op returns the number of bytes it produced or read, 0 if that doesn't apply
+template <typename Op>
+void runBenchmark(const std::string& name, Op op) {
+	if (!isSelected(name)) return;
+
+	op();
+
+	uint64_t iterations = 0;
+	uint64_t bytes = 0;
+	uint64_t allocationsBefore = allocationCount.load();
+	auto start = std::chrono::steady_clock::now();
+	double elapsedSeconds = 0.0;
+	do {
+		bytes += op();
+		iterations++;
+		elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsedSeconds < config.minSeconds || iterations < config.minIterations);
+	uint64_t allocations = allocationCount.load() - allocationsBefore;
+
+	MicrobenchmarkResult result;
+	result.name = name;
+	result.iterations = iterations;
+	result.nsPerOp = elapsedSeconds * 1e9 / iterations;
+	result.bytesPerSecond = bytes / elapsedSeconds;
+	result.allocationsPerOp = static_cast<double>(allocations) / iterations;
+	results.push_back(result);
+
+	char rate[32] = "-";
+	if (result.bytesPerSecond > 0.0) {
+		snprintf(rate, sizeof(rate), "%.1f MiB/s", result.bytesPerSecond / (1024.0 * 1024.0));
+	}
+	printf("%-56s %10llu %14.1f %16s %12.1f\n", name.c_str(), static_cast<unsigned long long>(iterations),
+		result.nsPerOp, rate, result.allocationsPerOp);
+}
+
+void writeResults() {
+	std::ofstream file(config.outputFile, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + config.outputFile + " for writing!");
+	}
+
+	file << "{\n";
+#ifdef NDEBUG
+	file << "  \"build\": \"release\",\n";
+#else
+	file << "  \"build\": \"debug\",\n";
+#endif
+	file << "  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		char line[384];
+		snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.1f, \"bytes_per_second\": %.0f, \"allocations_per_op\": %.2f }%s\n",
+			escapeJson(results[i].name).c_str(), static_cast<unsigned long long>(results[i].iterations), results[i].nsPerOp,
+			results[i].bytesPerSecond, results[i].allocationsPerOp, i + 1 < results.size() ? "," : "");
+		file << line;
+	}
+	file << "  ]\n}\n";
+	file.close();
+
+	printf("Microbenchmark: %zu results written to %s\n", results.size(), config.outputFile.c_str());
+}
+
+// -- SYNTHETIC SCENES ---------------------------------------------------------------------
+
+// gridSize x gridSize vertices in the XZ plane, 2 triangles per cell
+aiMesh* createGridMesh(uint32_t gridSize) {
+	aiMesh* mesh = new aiMesh();
+	mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+	mesh->mMaterialIndex = 0;
+
+	mesh->mNumVertices = gridSize * gridSize;
+	mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+	mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+	mesh->mNumUVComponents[0] = 2;
+	for (uint32_t z = 0; z < gridSize; z++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			float u = static_cast<float>(x) / (gridSize - 1);
+			float v = static_cast<float>(z) / (gridSize - 1);
+			mesh->mVertices[z * gridSize + x] = aiVector3D(u * 10.0f, 0.5f * std::sin(u * 12.0f) * std::cos(v * 12.0f), v * 10.0f);
+			mesh->mTextureCoords[0][z * gridSize + x] = aiVector3D(u, v, 0.0f);
+		}
+	}
+
+	mesh->mNumFaces = (gridSize - 1) * (gridSize - 1) * 2;
+	mesh->mFaces = new aiFace[mesh->mNumFaces];
+	uint32_t face = 0;
+	for (uint32_t z = 0; z + 1 < gridSize; z++) {
+		for (uint32_t x = 0; x + 1 < gridSize; x++) {
+			unsigned int corner = z * gridSize + x;
+			unsigned int quad[2][3] = { { corner, corner + gridSize, corner + 1 }, { corner + 1, corner + gridSize, corner + gridSize + 1 } };
+			for (auto& triangle : quad) {
+				mesh->mFaces[face].mNumIndices = 3;
+				mesh->mFaces[face].mIndices = new unsigned int[3] { triangle[0], triangle[1], triangle[2] };
+				face++;
+			}
+		}
+	}
+	return mesh;
+}
+
+// Root node with one child node (and mesh) per part, side by side
+aiScene* createGridScene(uint32_t partCount, uint32_t gridSize) {
+	aiScene* scene = new aiScene();
+	scene->mNumMeshes = partCount;
+	scene->mMeshes = new aiMesh*[partCount];
+
+	aiNode* root = new aiNode();
+	root->mNumChildren = partCount;
+	root->mChildren = new aiNode*[partCount];
+	for (uint32_t i = 0; i < partCount; i++) {
+		scene->mMeshes[i] = createGridMesh(gridSize);
+
+		aiNode* child = new aiNode();
+		child->mParent = root;
+		child->mTransformation = aiMatrix4x4();
+		child->mTransformation.a4 = i * 12.0f;
+		child->mNumMeshes = 1;
+		child->mMeshes = new unsigned int[1] { i };
+		root->mChildren[i] = child;
+	}
+	scene->mRootNode = root;
+	return scene;
+}
+
+// The aiScene / aiNode destructors live in the assimp DLL and would free our arrays with its own heap, so detach them first
+void destroyGridScene(aiScene* scene) {
+	aiNode* root = scene->mRootNode;
+	for (uint32_t i = 0; i < root->mNumChildren; i++) {
+		aiNode* child = root->mChildren[i];
+		delete[] child->mMeshes;
+		child->mMeshes = nullptr;
+		child->mNumMeshes = 0;
+		delete child;
+	}
+	delete[] root->mChildren;
+	root->mChildren = nullptr;
+	root->mNumChildren = 0;
+	delete root;
+
+	for (uint32_t i = 0; i < scene->mNumMeshes; i++) {
+		delete scene->mMeshes[i];
+	}
+	delete[] scene->mMeshes;
+	scene->mMeshes = nullptr;
+	scene->mNumMeshes = 0;
+	scene->mRootNode = nullptr;
+	delete scene;
+}
+
+// Removes a generated file when it goes out of scope, also when a benchmark throws
+struct ScopedFileRemover {
+	std::string fileName;
+	~ScopedFileRemover() {
+		std::error_code error;
+		std::filesystem::remove(fileName, error);
+	}
+};
+
+// Same grid scene as an OBJ file, so it can go through VulkanRenderer::addNCreateImportMesh()
+void writeGridObj(const std::string& fileName, uint32_t partCount, uint32_t gridSize) {
+	std::ofstream file(fileName, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + fileName + " for writing!");
+	}
+
+	uint32_t vertexBase = 1;								// OBJ indices start at 1 and run across objects
+	for (uint32_t part = 0; part < partCount; part++) {
+		file << "o part" << part << "\n";
+		for (uint32_t z = 0; z < gridSize; z++) {
+			for (uint32_t x = 0; x < gridSize; x++) {
+				float u = static_cast<float>(x) / (gridSize - 1);
+				float v = static_cast<float>(z) / (gridSize - 1);
+				file << "v " << (part * 12.0f + u * 10.0f) << " " << (0.5f * std::sin(u * 12.0f) * std::cos(v * 12.0f)) << " " << (v * 10.0f) << "\n";
+				file << "vt " << u << " " << v << "\n";
+			}
+		}
+		for (uint32_t z = 0; z + 1 < gridSize; z++) {
+			for (uint32_t x = 0; x + 1 < gridSize; x++) {
+				uint32_t corner = vertexBase + z * gridSize + x;
+				uint32_t quad[2][3] = { { corner, corner + gridSize, corner + 1 }, { corner + 1, corner + gridSize, corner + gridSize + 1 } };
+				for (auto& triangle : quad) {
+					file << "f " << triangle[0] << "/" << triangle[0] << " " << triangle[1] << "/" << triangle[1] << " "
+						<< triangle[2] << "/" << triangle[2] << "\n";
+				}
+			}
+		}
+		vertexBase += gridSize * gridSize;
+	}
+	file.close();
+}
+
+// -- BENCHMARKS ---------------------------------------------------------------------------
+
+// Handles of the mock device, for the benchmarks that don't need a whole renderer
+struct MockDevice {
+	VkInstance instance;
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	VkQueue queue;
+	VkCommandPool commandPool;
+};
+
+MockDevice createMockDevice() {
+	MockDevice mock = {};
+	VkInstanceCreateInfo instanceCreateInfo = {};
+	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	vkCreateInstance(&instanceCreateInfo, nullptr, &mock.instance);
+
+	uint32_t deviceCount = 1;
+	vkEnumeratePhysicalDevices(mock.instance, &deviceCount, &mock.physicalDevice);
+
+	VkDeviceCreateInfo deviceCreateInfo = {};
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	vkCreateDevice(mock.physicalDevice, &deviceCreateInfo, nullptr, &mock.device);
+	vkGetDeviceQueue(mock.device, 0, 0, &mock.queue);
+
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	vkCreateCommandPool(mock.device, &poolCreateInfo, nullptr, &mock.commandPool);
+
+	MemoryTracker::init(mock.instance, mock.physicalDevice, false);
+	return mock;
+}
+
+// Vertex conversion, meshlets and LOD chain of a single aiMesh, written to (mock) staging memory
+void benchmarkLoadMesh(const MockDevice& mock) {
+	const std::vector<int> materialToSamplerDescriptorSetId = { 0 };
+	for (uint32_t gridSize : { 32u, 128u, 256u }) {
+		aiScene* scene = createGridScene(1, gridSize);
+		MeshImportJob job = { scene->mMeshes[0], glm::mat4(1.0f) };
+		StagingUploader uploader(mock.physicalDevice, mock.device, mock.queue, mock.commandPool);
+
+		runBenchmark("ImportMesh::LoadMesh/" + std::to_string(gridSize * gridSize) + " vertices", [&]() -> uint64_t {
+			MeshImportData data;
+			ImportMesh::LoadMesh(job, materialToSamplerDescriptorSetId, uploader, data);
+			uploader.flush();				// Releases the staging memory, nothing was queued to copy
+			return sizeof(Vertex) * static_cast<uint64_t>(data.vertexCount) + sizeof(uint32_t) * static_cast<uint64_t>(data.indexCount);
+		});
+
+		destroyGridScene(scene);
+	}
+}
+
+// Whole scene import: flatten, parallel conversion, buffer creation and the upload submission
+void benchmarkLoadNode(const MockDevice& mock) {
+	const std::vector<int> materialToSamplerDescriptorSetId = { 0 };
+	const uint32_t gridSize = 64;
+	const std::vector<std::pair<uint32_t, bool>> runs = { { 1, false }, { 8, false }, { 8, true }, { 32, false }, { 32, true } };
+	for (const auto& run : runs) {
+		uint32_t partCount = run.first;
+		bool batched = run.second;
+		aiScene* scene = createGridScene(partCount, gridSize);
+		ImportOptions options;
+		options.batchByTexture = batched;			// Every part shares material 0, batched into 1 mesh
+
+		runBenchmark("ImportMesh::LoadNode/" + std::to_string(partCount) + " meshes x " + std::to_string(gridSize * gridSize) + " vertices" +
+			(batched ? ", batched" : ""), [&]() -> uint64_t {
+			std::vector<Mesh> meshes = ImportMesh::LoadNode(mock.physicalDevice, mock.device, mock.queue, mock.commandPool,
+				scene->mRootNode, scene, materialToSamplerDescriptorSetId, options);
+			uint64_t bytes = 0;
+			for (Mesh& mesh : meshes) {
+				bytes += sizeof(Vertex) * static_cast<uint64_t>(mesh.getVertexCount()) + sizeof(uint32_t) * static_cast<uint64_t>(mesh.getIndexCount());
+				mesh.destroyBuffers();
+			}
+			return bytes;
+		});
+
+		destroyGridScene(scene);
+	}
+}
+
+// The model matrix loop of VulkanRenderer::updateUniformBuffers(), into dynamic uniform buffer slots aligned like on the mock device
+void benchmarkPackModels(const MockDevice& mock) {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(mock.physicalDevice, &properties);
+	VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+	VkDeviceSize stride = (sizeof(Model) + alignment - 1) & ~(alignment - 1);
+	void* transferSpace = _aligned_malloc(stride * MAX_OBJECTS, stride);
+
+	for (uint32_t meshCount : { 16u, static_cast<uint32_t>(MAX_OBJECTS) }) {
+		std::vector<ImportMesh> importMeshes;
+		for (uint32_t i = 0; i < meshCount; i++) {
+			importMeshes.push_back(ImportMesh(std::vector<Mesh>(), glm::translate(glm::mat4(1.0f), glm::vec3(i * 1.0f, 0.0f, 0.0f))));
+		}
+
+		runBenchmark("ImportMesh::PackModels/" + std::to_string(meshCount) + " models", [&]() -> uint64_t {
+			ImportMesh::PackModels(importMeshes, transferSpace, stride);
+			return sizeof(Model) * static_cast<uint64_t>(meshCount);
+		});
+	}
+
+	_aligned_free(transferSpace);
+}
+
+// Scheduler overhead: jobs that do nothing, so the numbers are queueing, stealing, waking up and waiting. An ad-hoc
+// std::thread per core (what the importer and the shader compiler did before) is measured the same way for comparison
+void benchmarkJobSystem() {
+	const uint32_t jobCount = 1024;
+	runBenchmark("JobSystem::run+wait/" + std::to_string(jobCount) + " empty jobs", [&]() -> uint64_t {
+		JobCounter counter;
+		for (uint32_t i = 0; i < jobCount; i++) {
+			JobSystem::run([]() {}, &counter);
+		}
+		JobSystem::wait(counter);
+		return 0;
+	});
+
+	for (size_t grainSize : { size_t(1), size_t(256) }) {
+		const size_t count = 65536;
+		std::vector<float> values(count, 1.0f);
+		runBenchmark("JobSystem::parallelFor/64K floats, grain " + std::to_string(grainSize), [&]() -> uint64_t {
+			JobSystem::parallelFor(count, grainSize, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					values[i] = values[i] * 0.5f + 1.0f;
+				}
+			});
+			return sizeof(float) * static_cast<uint64_t>(count);
+		});
+	}
+
+	// Chain: every task waits on the previous one, nothing runs in parallel. Fan out: 1 root, taskCount independent tasks, 1 join
+	const uint32_t taskCount = 256;
+	TaskGraph chain;
+	TaskGraph fanOut;
+	TaskId root = fanOut.add([]() {});
+	std::vector<TaskId> branches;
+	for (uint32_t i = 0; i < taskCount; i++) {
+		chain.add([]() {}, i == 0 ? std::vector<TaskId>() : std::vector<TaskId>{ i - 1 });
+		branches.push_back(fanOut.add([]() {}, { root }));
+	}
+	fanOut.add([]() {}, branches);
+	runBenchmark("TaskGraph::execute/chain of " + std::to_string(taskCount) + " tasks", [&]() -> uint64_t {
+		chain.execute();
+		return 0;
+	});
+	runBenchmark("TaskGraph::execute/fan out of " + std::to_string(taskCount) + " tasks", [&]() -> uint64_t {
+		fanOut.execute();
+		return 0;
+	});
+
+	runBenchmark("std::thread/spawn + join per core", [&]() -> uint64_t {
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < JobSystem::getWorkerCount(); i++) {
+			threads.emplace_back([]() {});
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		return 0;
+	});
+}
+
+// readFile() of files of a few sizes, the OS cache is warm after the warm up op
+void benchmarkReadFile() {
+	for (size_t size : { size_t(4) * 1024, size_t(1024) * 1024, size_t(32) * 1024 * 1024 }) {
+		std::string name = "readFile/" + (size >= 1024 * 1024 ? std::to_string(size / (1024 * 1024)) + " MiB" : std::to_string(size / 1024) + " KiB");
+		if (!isSelected(name)) continue;
+
+		ScopedFileRemover file = { (std::filesystem::temp_directory_path() / ("microbenchmark_read_" + std::to_string(size) + ".bin")).string() };
+		{
+			std::vector<char> data(size);
+			for (size_t i = 0; i < size; i++) data[i] = static_cast<char>(i * 31);
+			std::ofstream stream(file.fileName, std::ios::binary | std::ios::trunc);
+			stream.write(data.data(), size);
+		}
+
+		runBenchmark(name, [&]() -> uint64_t {
+			return readFile(file.fileName).size();
+		});
+	}
+}
+
+// loadTextureFile() of every image in ../Textures, smallest first. Bytes are the decoded RGBA8 bytes
+void benchmarkLoadTextureFile() {
+	struct TextureFile {
+		std::string fileName;
+		int width;
+		int height;
+	};
+	std::vector<TextureFile> textures;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator("../Textures", error)) {
+		if (!entry.is_regular_file()) continue;
+		TextureFile texture = { entry.path().filename().string(), 0, 0 };
+		int channels;
+		if (stbi_info(entry.path().string().c_str(), &texture.width, &texture.height, &channels)) {
+			textures.push_back(texture);
+		}
+	}
+	if (textures.empty()) {
+		printf("Microbenchmark: no images in ../Textures, loadTextureFile skipped\n");
+		return;
+	}
+	std::sort(textures.begin(), textures.end(), [](const TextureFile& a, const TextureFile& b) {
+		return (int64_t)a.width * a.height < (int64_t)b.width * b.height;
+	});
+
+	for (const TextureFile& texture : textures) {
+		runBenchmark("loadTextureFile/" + std::to_string(texture.width) + "x" + std::to_string(texture.height) + " " + texture.fileName,
+			[&]() -> uint64_t {
+			int width, height;
+			VkDeviceSize imageSize;
+			stbi_uc* image = VulkanRenderer::loadTextureFile(texture.fileName, &width, &height, &imageSize);
+			stbi_image_free(image);
+			return imageSize;
+		});
+	}
+}
+
+// Every image in ../Textures packed into 1 texture array like an import with ImportOptions::packTextures: header reads, layout,
+// parallel decoding into the layers. Bytes are the texture array bytes
+void benchmarkPackTextures(const MockDevice& mock) {
+	std::vector<std::string> fileNames;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator("../Textures", error)) {
+		int width, height, channels;
+		if (entry.is_regular_file() && stbi_info(entry.path().string().c_str(), &width, &height, &channels)) {
+			fileNames.push_back(entry.path().filename().string());
+		}
+	}
+	if (fileNames.empty()) {
+		printf("Microbenchmark: no images in ../Textures, decodePackedTexture skipped\n");
+		return;
+	}
+	std::sort(fileNames.begin(), fileNames.end());
+
+	std::vector<std::string> packedFileNames;
+	std::vector<TexturePlacement> materialPlacements;
+	TexturePackLayout layout = ImportLoader::planTexturePack(fileNames, packedFileNames, materialPlacements);
+	StagingUploader uploader(mock.physicalDevice, mock.device, mock.queue, mock.commandPool);
+
+	runBenchmark("ImportLoader::decodePackedTexture/" + std::to_string(fileNames.size()) + " textures, " + std::to_string(layout.layerCount) +
+		" layers", [&]() -> uint64_t {
+		std::vector<std::string> opFileNames;
+		TexturePackLayout opLayout = ImportLoader::planTexturePack(fileNames, opFileNames, materialPlacements);
+		DecodedTexture texture = {};
+		texture.fileName = "microbenchmark (packed textures)";
+		ImportLoader::decodePackedTexture(uploader, opFileNames, opLayout, texture);
+		uploader.flush();				// Releases the staging memory, nothing was queued to copy
+		return static_cast<uint64_t>(texture.width) * texture.height * 4 * texture.layerCount;
+	});
+}
+
+// draw() on the mock device: acquire / submit / present are no-ops, what's left is updateUniformBuffers() and recordCommands()
+void benchmarkDraw() {
+	const uint32_t importSteps[] = { 1, 8, 32 };
+	if (!isSelected("VulkanRenderer::draw")) return;
+
+	// Outside of ../ImportObj, the asset directory is checked in and watched for hot reloads
+	ScopedFileRemover sceneFile = { (std::filesystem::temp_directory_path() / MICROBENCHMARK_SCENE_FILE).string() };
+	writeGridObj(sceneFile.fileName, MICROBENCHMARK_SCENE_PARTS, MICROBENCHMARK_SCENE_GRID);
+
+	VulkanRenderer vulkanRenderer;
+	vulkanRenderer.setLatencyProfile(LATENCY_PROFILE_THROUGHPUT);
+	if (vulkanRenderer.init(nullptr) == EXIT_FAILURE) {
+		throw std::runtime_error("Renderer init failed on the mock device!");
+	}
+
+	glm::mat4 projectionMat = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	projectionMat[1][1] *= -1;
+	vulkanRenderer.setViewProjectionMat(glm::lookAt(glm::vec3(0.0f, 40.0f, 80.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)), projectionMat);
+
+	uint32_t importCount = 0;
+	for (uint32_t targetCount : importSteps) {
+		for (; importCount < targetCount; importCount++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, importCount * -12.0f));
+			vulkanRenderer.addNCreateImportMesh(sceneFile.fileName, model);
+		}
+
+		vulkanRenderer.draw();			// Draw count and command count of one frame for the name
+		uint64_t commandsBefore = MockVulkan::getCommandCount();
+		vulkanRenderer.draw();
+		uint64_t commandsPerFrame = MockVulkan::getCommandCount() - commandsBefore;
+
+		runBenchmark("VulkanRenderer::draw/" + std::to_string(importCount * MICROBENCHMARK_SCENE_PARTS) + " meshes (" +
+			std::to_string(vulkanRenderer.getDrawCount()) + " draws, " + std::to_string(commandsPerFrame) + " vkCmd)", [&]() -> uint64_t {
+			vulkanRenderer.draw();
+			return 0;
+		});
+	}
+
+	vulkanRenderer.cleanup();
+}
+
+int main(int argc, char** argv) {
+	config = parseArguments(argc, argv);
+	MockVulkan::setSurfaceExtent(1600, 900);
+	JobSystem::init(config.workerCount);
+
+	try {
+		printf("%-56s %10s %14s %16s %12s\n", "Benchmark", "iterations", "ns/op", "bytes/s", "allocs/op");
+
+		MockDevice mock = createMockDevice();
+		benchmarkLoadMesh(mock);
+		benchmarkLoadNode(mock);
+		benchmarkPackModels(mock);
+		benchmarkJobSystem();
+		benchmarkReadFile();
+		benchmarkLoadTextureFile();
+		benchmarkPackTextures(mock);
+		vkDestroyCommandPool(mock.device, mock.commandPool, nullptr);
+		vkDestroyDevice(mock.device, nullptr);
+		vkDestroyInstance(mock.instance, nullptr);
+
+		benchmarkDraw();
+
+		if (!config.outputFile.empty()) {
+			writeResults();
+		}
+	}
+	catch (const std::runtime_error& e) {
+		printf("Microbenchmark ERROR: %s\n", e.what());
+		JobSystem::shutdown();
+		return EXIT_FAILURE;
+	}
+
+	JobSystem::shutdown();
+	return 0;
+}
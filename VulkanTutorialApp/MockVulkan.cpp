@@ -0,0 +1,620 @@
+#include "MockVulkan.h"
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+// Memory and object bookkeeping goes through malloc, not operator new, so it doesn't show up in the microbenchmarks' allocation counts
+struct MockResource {
+	VkDeviceSize size;				// Buffer size, or an upper bound of the image size
+};
+
+struct MockSwapchain {
+	uint32_t imageCount;
+	uint32_t nextImage;
+};
+
+struct MockMemoryHeader {
+	VkDeviceSize size;
+	uint8_t padding[56];			// Keeps the data behind the header 64 byte aligned as far as malloc allows
+};
+
+static const VkDeviceSize MOCK_MEMORY_ALIGNMENT = 256;
+static const VkDeviceSize MOCK_HEAP_SIZE = 8ull * 1024 * 1024 * 1024;
+
+static uint32_t surfaceWidth = 1280;
+static uint32_t surfaceHeight = 720;
+static std::atomic<uint64_t> commandCount(0);
+static std::atomic<uint64_t> allocatedBytes(0);
+static std::atomic<uintptr_t> nextHandle(0x1000);
+
+// Handles the caller never looks into, unique so maps keyed by handle still work. Non-dispatchable handles are uint64_t on 32 bit builds
+template <typename Handle>
+static Handle newHandle()
+{
+	return (Handle)nextHandle.fetch_add(16);
+}
+
+template <typename Handle>
+static Handle toHandle(void* object)
+{
+	return (Handle)(uintptr_t)object;
+}
+
+template <typename T, typename Handle>
+static T* fromHandle(Handle handle)
+{
+	return (T*)(uintptr_t)handle;
+}
+
+template <typename Handle>
+static void fillHandles(Handle* outHandles, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		outHandles[i] = newHandle<Handle>();
+	}
+}
+
+static void countCommand()
+{
+	commandCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Two call enumeration: count only when the output is null, otherwise copy as many as fit
+template <typename T>
+static VkResult enumerate(const std::vector<T>& items, uint32_t* count, T* outItems)
+{
+	if (outItems == nullptr)
+	{
+		*count = static_cast<uint32_t>(items.size());
+		return VK_SUCCESS;
+	}
+	uint32_t copied = std::min<uint32_t>(*count, static_cast<uint32_t>(items.size()));
+	std::copy(items.begin(), items.begin() + copied, outItems);
+	*count = copied;
+	return copied < items.size() ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+static VkExtensionProperties extensionProperties(const char* name)
+{
+	VkExtensionProperties properties = {};
+	strncpy(properties.extensionName, name, VK_MAX_EXTENSION_NAME_SIZE - 1);
+	properties.specVersion = 1;
+	return properties;
+}
+
+void MockVulkan::setSurfaceExtent(uint32_t width, uint32_t height)
+{
+	surfaceWidth = width;
+	surfaceHeight = height;
+}
+
+uint64_t MockVulkan::getCommandCount()
+{
+	return commandCount.load();
+}
+
+uint64_t MockVulkan::getAllocatedBytes()
+{
+	return allocatedBytes.load();
+}
+
+// -- GLFW ---------------------------------------------------------------------------------
+
+static const char* mockInstanceExtensions[] = { VK_KHR_SURFACE_EXTENSION_NAME, "VK_KHR_win32_surface" };
+static void* windowUserPointer = nullptr;
+
+const char** glfwGetRequiredInstanceExtensions(uint32_t* count)
+{
+	*count = 2;
+	return mockInstanceExtensions;
+}
+
+VkResult glfwCreateWindowSurface(VkInstance /*instance*/, GLFWwindow* /*window*/, const VkAllocationCallbacks* /*allocator*/, VkSurfaceKHR* surface)
+{
+	*surface = newHandle<VkSurfaceKHR>();
+	return VK_SUCCESS;
+}
+
+void glfwGetFramebufferSize(GLFWwindow* /*window*/, int* width, int* height)
+{
+	if (width) *width = static_cast<int>(surfaceWidth);
+	if (height) *height = static_cast<int>(surfaceHeight);
+}
+
+void glfwSetWindowUserPointer(GLFWwindow* /*window*/, void* pointer)
+{
+	windowUserPointer = pointer;
+}
+
+void* glfwGetWindowUserPointer(GLFWwindow* /*window*/)
+{
+	return windowUserPointer;
+}
+
+GLFWframebuffersizefun glfwSetFramebufferSizeCallback(GLFWwindow* /*window*/, GLFWframebuffersizefun /*callback*/)
+{
+	return nullptr;
+}
+
+void glfwWaitEvents()
+{
+}
+
+double glfwGetTime()
+{
+	return 0.0;
+}
+
+// -- INSTANCE AND PHYSICAL DEVICE ---------------------------------------------------------
+
+// Debug utils are resolved through vkGetInstanceProcAddr, no-ops like every other command
+static VKAPI_ATTR VkResult VKAPI_CALL mockCreateDebugUtilsMessenger(VkInstance /*instance*/, const VkDebugUtilsMessengerCreateInfoEXT* /*pCreateInfo*/,
+	const VkAllocationCallbacks* /*pAllocator*/, VkDebugUtilsMessengerEXT* pMessenger)
+{
+	*pMessenger = newHandle<VkDebugUtilsMessengerEXT>();
+	return VK_SUCCESS;
+}
+static VKAPI_ATTR void VKAPI_CALL mockDestroyDebugUtilsMessenger(VkInstance /*instance*/, VkDebugUtilsMessengerEXT /*messenger*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+static VKAPI_ATTR VkResult VKAPI_CALL mockSetDebugUtilsObjectName(VkDevice /*device*/, const VkDebugUtilsObjectNameInfoEXT* /*pNameInfo*/) { return VK_SUCCESS; }
+static VKAPI_ATTR void VKAPI_CALL mockCmdBeginDebugUtilsLabel(VkCommandBuffer /*commandBuffer*/, const VkDebugUtilsLabelEXT* /*pLabelInfo*/) { countCommand(); }
+static VKAPI_ATTR void VKAPI_CALL mockCmdEndDebugUtilsLabel(VkCommandBuffer /*commandBuffer*/) { countCommand(); }
+
+PFN_vkVoidFunction vkGetInstanceProcAddr(VkInstance /*instance*/, const char* pName)
+{
+	if (strcmp(pName, "vkCreateDebugUtilsMessengerEXT") == 0) return (PFN_vkVoidFunction)mockCreateDebugUtilsMessenger;
+	if (strcmp(pName, "vkDestroyDebugUtilsMessengerEXT") == 0) return (PFN_vkVoidFunction)mockDestroyDebugUtilsMessenger;
+	if (strcmp(pName, "vkSetDebugUtilsObjectNameEXT") == 0) return (PFN_vkVoidFunction)mockSetDebugUtilsObjectName;
+	if (strcmp(pName, "vkCmdBeginDebugUtilsLabelEXT") == 0) return (PFN_vkVoidFunction)mockCmdBeginDebugUtilsLabel;
+	if (strcmp(pName, "vkCmdEndDebugUtilsLabelEXT") == 0) return (PFN_vkVoidFunction)mockCmdEndDebugUtilsLabel;
+	return nullptr;
+}
+
+VkResult vkEnumerateInstanceLayerProperties(uint32_t* pPropertyCount, VkLayerProperties* pProperties)
+{
+	VkLayerProperties validation = {};
+	strncpy(validation.layerName, "VK_LAYER_KHRONOS_validation", VK_MAX_EXTENSION_NAME_SIZE - 1);
+	validation.specVersion = VK_API_VERSION_1_0;
+	validation.implementationVersion = 1;
+	return enumerate(std::vector<VkLayerProperties>{ validation }, pPropertyCount, pProperties);
+}
+
+VkResult vkEnumerateInstanceExtensionProperties(const char* /*pLayerName*/, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+{
+	std::vector<VkExtensionProperties> extensions = {
+		extensionProperties(mockInstanceExtensions[0]),
+		extensionProperties(mockInstanceExtensions[1]),
+		extensionProperties(VK_EXT_DEBUG_UTILS_EXTENSION_NAME),
+	};
+	return enumerate(extensions, pPropertyCount, pProperties);
+}
+
+VkResult vkCreateInstance(const VkInstanceCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkInstance* pInstance)
+{
+	*pInstance = newHandle<VkInstance>();
+	return VK_SUCCESS;
+}
+
+void vkDestroyInstance(VkInstance /*instance*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+void vkDestroySurfaceKHR(VkInstance /*instance*/, VkSurfaceKHR /*surface*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkEnumeratePhysicalDevices(VkInstance /*instance*/, uint32_t* pPhysicalDeviceCount, VkPhysicalDevice* pPhysicalDevices)
+{
+	static const VkPhysicalDevice physicalDevice = newHandle<VkPhysicalDevice>();
+	return enumerate(std::vector<VkPhysicalDevice>{ physicalDevice }, pPhysicalDeviceCount, pPhysicalDevices);
+}
+
+void vkGetPhysicalDeviceProperties(VkPhysicalDevice /*physicalDevice*/, VkPhysicalDeviceProperties* pProperties)
+{
+	*pProperties = {};
+	pProperties->apiVersion = VK_API_VERSION_1_0;
+	pProperties->deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU;
+	strncpy(pProperties->deviceName, "Mock Vulkan device (no GPU)", VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+	pProperties->limits.minUniformBufferOffsetAlignment = 256;
+	pProperties->limits.minStorageBufferOffsetAlignment = 64;
+	pProperties->limits.nonCoherentAtomSize = 64;
+	pProperties->limits.maxSamplerAnisotropy = 16.0f;
+	pProperties->limits.maxBoundDescriptorSets = 8;
+	pProperties->limits.maxPushConstantsSize = 128;
+	pProperties->limits.maxImageDimension2D = 16384;
+	pProperties->limits.maxComputeWorkGroupCount[0] = 65535;
+	pProperties->limits.maxComputeWorkGroupCount[1] = 65535;
+	pProperties->limits.maxComputeWorkGroupCount[2] = 65535;
+	pProperties->limits.timestampPeriod = 1.0f;
+}
+
+void vkGetPhysicalDeviceFeatures(VkPhysicalDevice /*physicalDevice*/, VkPhysicalDeviceFeatures* pFeatures)
+{
+	*pFeatures = {};
+	pFeatures->samplerAnisotropy = VK_TRUE;
+}
+
+void vkGetPhysicalDeviceFormatProperties(VkPhysicalDevice /*physicalDevice*/, VkFormat /*format*/, VkFormatProperties* pFormatProperties)
+{
+	// Every format supports everything
+	pFormatProperties->linearTilingFeatures = ~0u;
+	pFormatProperties->optimalTilingFeatures = ~0u;
+	pFormatProperties->bufferFeatures = ~0u;
+}
+
+void vkGetPhysicalDeviceMemoryProperties(VkPhysicalDevice /*physicalDevice*/, VkPhysicalDeviceMemoryProperties* pMemoryProperties)
+{
+	*pMemoryProperties = {};
+	pMemoryProperties->memoryHeapCount = 1;
+	pMemoryProperties->memoryHeaps[0].size = MOCK_HEAP_SIZE;
+	pMemoryProperties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+	// Unified memory, like an integrated GPU: device local and host visible types on the one heap
+	pMemoryProperties->memoryTypeCount = 2;
+	pMemoryProperties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	pMemoryProperties->memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+}
+
+void vkGetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice /*physicalDevice*/, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties* pQueueFamilyProperties)
+{
+	VkQueueFamilyProperties family = {};
+	family.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+	family.queueCount = 1;
+	family.timestampValidBits = 0;			// GPU profiler stays disabled, there is nothing to time
+	family.minImageTransferGranularity = { 1, 1, 1 };
+	enumerate(std::vector<VkQueueFamilyProperties>{ family }, pQueueFamilyPropertyCount, pQueueFamilyProperties);
+}
+
+VkResult vkEnumerateDeviceExtensionProperties(VkPhysicalDevice /*physicalDevice*/, const char* /*pLayerName*/, uint32_t* pPropertyCount, VkExtensionProperties* pProperties)
+{
+	return enumerate(std::vector<VkExtensionProperties>{ extensionProperties(VK_KHR_SWAPCHAIN_EXTENSION_NAME) }, pPropertyCount, pProperties);
+}
+
+VkResult vkGetPhysicalDeviceSurfaceSupportKHR(VkPhysicalDevice /*physicalDevice*/, uint32_t /*queueFamilyIndex*/, VkSurfaceKHR /*surface*/, VkBool32* pSupported)
+{
+	*pSupported = VK_TRUE;
+	return VK_SUCCESS;
+}
+
+VkResult vkGetPhysicalDeviceSurfaceCapabilitiesKHR(VkPhysicalDevice /*physicalDevice*/, VkSurfaceKHR /*surface*/, VkSurfaceCapabilitiesKHR* pSurfaceCapabilities)
+{
+	*pSurfaceCapabilities = {};
+	pSurfaceCapabilities->minImageCount = 2;
+	pSurfaceCapabilities->maxImageCount = 3;
+	pSurfaceCapabilities->currentExtent = { surfaceWidth, surfaceHeight };
+	pSurfaceCapabilities->minImageExtent = { 1, 1 };
+	pSurfaceCapabilities->maxImageExtent = { 16384, 16384 };
+	pSurfaceCapabilities->maxImageArrayLayers = 1;
+	pSurfaceCapabilities->supportedTransforms = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	pSurfaceCapabilities->currentTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+	pSurfaceCapabilities->supportedCompositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	pSurfaceCapabilities->supportedUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	return VK_SUCCESS;
+}
+
+VkResult vkGetPhysicalDeviceSurfaceFormatsKHR(VkPhysicalDevice /*physicalDevice*/, VkSurfaceKHR /*surface*/, uint32_t* pSurfaceFormatCount, VkSurfaceFormatKHR* pSurfaceFormats)
+{
+	VkSurfaceFormatKHR format = { VK_FORMAT_B8G8R8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	return enumerate(std::vector<VkSurfaceFormatKHR>{ format }, pSurfaceFormatCount, pSurfaceFormats);
+}
+
+VkResult vkGetPhysicalDeviceSurfacePresentModesKHR(VkPhysicalDevice /*physicalDevice*/, VkSurfaceKHR /*surface*/, uint32_t* pPresentModeCount, VkPresentModeKHR* pPresentModes)
+{
+	std::vector<VkPresentModeKHR> modes = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+	return enumerate(modes, pPresentModeCount, pPresentModes);
+}
+
+// -- DEVICE AND QUEUES --------------------------------------------------------------------
+
+VkResult vkCreateDevice(VkPhysicalDevice /*physicalDevice*/, const VkDeviceCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkDevice* pDevice)
+{
+	*pDevice = newHandle<VkDevice>();
+	return VK_SUCCESS;
+}
+
+void vkDestroyDevice(VkDevice /*device*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+void vkGetDeviceQueue(VkDevice /*device*/, uint32_t /*queueFamilyIndex*/, uint32_t /*queueIndex*/, VkQueue* pQueue)
+{
+	static const VkQueue queue = newHandle<VkQueue>();
+	*pQueue = queue;
+}
+
+VkResult vkDeviceWaitIdle(VkDevice /*device*/) { return VK_SUCCESS; }
+VkResult vkQueueWaitIdle(VkQueue /*queue*/) { return VK_SUCCESS; }
+VkResult vkQueueSubmit(VkQueue /*queue*/, uint32_t /*submitCount*/, const VkSubmitInfo* /*pSubmits*/, VkFence /*fence*/) { return VK_SUCCESS; }
+VkResult vkQueuePresentKHR(VkQueue /*queue*/, const VkPresentInfoKHR* /*pPresentInfo*/) { return VK_SUCCESS; }
+
+// -- SYNCHRONISATION ----------------------------------------------------------------------
+
+// Work completes the moment it is submitted, so every fence is always signalled
+VkResult vkCreateFence(VkDevice /*device*/, const VkFenceCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkFence* pFence)
+{
+	*pFence = newHandle<VkFence>();
+	return VK_SUCCESS;
+}
+void vkDestroyFence(VkDevice /*device*/, VkFence /*fence*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+VkResult vkWaitForFences(VkDevice /*device*/, uint32_t /*fenceCount*/, const VkFence* /*pFences*/, VkBool32 /*waitAll*/, uint64_t /*timeout*/) { return VK_SUCCESS; }
+VkResult vkGetFenceStatus(VkDevice /*device*/, VkFence /*fence*/) { return VK_SUCCESS; }
+VkResult vkResetFences(VkDevice /*device*/, uint32_t /*fenceCount*/, const VkFence* /*pFences*/) { return VK_SUCCESS; }
+
+VkResult vkCreateSemaphore(VkDevice /*device*/, const VkSemaphoreCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkSemaphore* pSemaphore)
+{
+	*pSemaphore = newHandle<VkSemaphore>();
+	return VK_SUCCESS;
+}
+void vkDestroySemaphore(VkDevice /*device*/, VkSemaphore /*semaphore*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+// -- SWAPCHAIN ----------------------------------------------------------------------------
+
+VkResult vkCreateSwapchainKHR(VkDevice /*device*/, const VkSwapchainCreateInfoKHR* pCreateInfo, const VkAllocationCallbacks* /*pAllocator*/, VkSwapchainKHR* pSwapchain)
+{
+	MockSwapchain* swapchain = static_cast<MockSwapchain*>(malloc(sizeof(MockSwapchain)));
+	swapchain->imageCount = std::max(pCreateInfo->minImageCount, 1u);
+	swapchain->nextImage = 0;
+	*pSwapchain = toHandle<VkSwapchainKHR>(swapchain);
+	return VK_SUCCESS;
+}
+
+void vkDestroySwapchainKHR(VkDevice /*device*/, VkSwapchainKHR swapchain, const VkAllocationCallbacks* /*pAllocator*/)
+{
+	free(fromHandle<MockSwapchain>(swapchain));
+}
+
+VkResult vkGetSwapchainImagesKHR(VkDevice /*device*/, VkSwapchainKHR swapchain, uint32_t* pSwapchainImageCount, VkImage* pSwapchainImages)
+{
+	MockSwapchain* mockSwapchain = fromHandle<MockSwapchain>(swapchain);
+	if (pSwapchainImages == nullptr)
+	{
+		*pSwapchainImageCount = mockSwapchain->imageCount;
+		return VK_SUCCESS;
+	}
+	*pSwapchainImageCount = std::min(*pSwapchainImageCount, mockSwapchain->imageCount);
+	fillHandles(pSwapchainImages, *pSwapchainImageCount);
+	return VK_SUCCESS;
+}
+
+VkResult vkAcquireNextImageKHR(VkDevice /*device*/, VkSwapchainKHR swapchain, uint64_t /*timeout*/, VkSemaphore /*semaphore*/, VkFence /*fence*/, uint32_t* pImageIndex)
+{
+	MockSwapchain* mockSwapchain = fromHandle<MockSwapchain>(swapchain);
+	*pImageIndex = mockSwapchain->nextImage;
+	mockSwapchain->nextImage = (mockSwapchain->nextImage + 1) % mockSwapchain->imageCount;
+	return VK_SUCCESS;
+}
+
+// -- MEMORY -------------------------------------------------------------------------------
+
+VkResult vkAllocateMemory(VkDevice /*device*/, const VkMemoryAllocateInfo* pAllocateInfo, const VkAllocationCallbacks* /*pAllocator*/, VkDeviceMemory* pMemory)
+{
+	MockMemoryHeader* header = static_cast<MockMemoryHeader*>(malloc(sizeof(MockMemoryHeader) + static_cast<size_t>(pAllocateInfo->allocationSize)));
+	if (header == nullptr)
+	{
+		return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+	}
+	header->size = pAllocateInfo->allocationSize;
+	allocatedBytes += pAllocateInfo->allocationSize;
+	*pMemory = toHandle<VkDeviceMemory>(header);
+	return VK_SUCCESS;
+}
+
+void vkFreeMemory(VkDevice /*device*/, VkDeviceMemory memory, const VkAllocationCallbacks* /*pAllocator*/)
+{
+	if (memory == VK_NULL_HANDLE) return;
+	MockMemoryHeader* header = fromHandle<MockMemoryHeader>(memory);
+	allocatedBytes -= header->size;
+	free(header);
+}
+
+VkResult vkMapMemory(VkDevice /*device*/, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize /*size*/, VkMemoryMapFlags /*flags*/, void** ppData)
+{
+	*ppData = reinterpret_cast<uint8_t*>(fromHandle<MockMemoryHeader>(memory) + 1) + offset;
+	return VK_SUCCESS;
+}
+
+void vkUnmapMemory(VkDevice /*device*/, VkDeviceMemory /*memory*/) {}
+
+VkResult vkCreateBuffer(VkDevice /*device*/, const VkBufferCreateInfo* pCreateInfo, const VkAllocationCallbacks* /*pAllocator*/, VkBuffer* pBuffer)
+{
+	MockResource* buffer = static_cast<MockResource*>(malloc(sizeof(MockResource)));
+	buffer->size = pCreateInfo->size;
+	*pBuffer = toHandle<VkBuffer>(buffer);
+	return VK_SUCCESS;
+}
+
+void vkDestroyBuffer(VkDevice /*device*/, VkBuffer buffer, const VkAllocationCallbacks* /*pAllocator*/)
+{
+	free(fromHandle<MockResource>(buffer));
+}
+
+VkResult vkCreateImage(VkDevice /*device*/, const VkImageCreateInfo* pCreateInfo, const VkAllocationCallbacks* /*pAllocator*/, VkImage* pImage)
+{
+	// 16 bytes per texel covers every format the renderer uses, mip chains included
+	MockResource* image = static_cast<MockResource*>(malloc(sizeof(MockResource)));
+	image->size = static_cast<VkDeviceSize>(pCreateInfo->extent.width) * pCreateInfo->extent.height * pCreateInfo->extent.depth *
+		pCreateInfo->arrayLayers * 16 * (pCreateInfo->mipLevels > 1 ? 2 : 1);
+	*pImage = toHandle<VkImage>(image);
+	return VK_SUCCESS;
+}
+
+void vkDestroyImage(VkDevice /*device*/, VkImage image, const VkAllocationCallbacks* /*pAllocator*/)
+{
+	free(fromHandle<MockResource>(image));
+}
+
+static void getResourceMemoryRequirements(const MockResource* resource, VkMemoryRequirements* pMemoryRequirements)
+{
+	pMemoryRequirements->size = (resource->size + MOCK_MEMORY_ALIGNMENT - 1) & ~(MOCK_MEMORY_ALIGNMENT - 1);
+	pMemoryRequirements->alignment = MOCK_MEMORY_ALIGNMENT;
+	pMemoryRequirements->memoryTypeBits = 0x3;
+}
+
+void vkGetBufferMemoryRequirements(VkDevice /*device*/, VkBuffer buffer, VkMemoryRequirements* pMemoryRequirements)
+{
+	getResourceMemoryRequirements(fromHandle<MockResource>(buffer), pMemoryRequirements);
+}
+
+void vkGetImageMemoryRequirements(VkDevice /*device*/, VkImage image, VkMemoryRequirements* pMemoryRequirements)
+{
+	getResourceMemoryRequirements(fromHandle<MockResource>(image), pMemoryRequirements);
+}
+
+VkResult vkBindBufferMemory(VkDevice /*device*/, VkBuffer /*buffer*/, VkDeviceMemory /*memory*/, VkDeviceSize /*memoryOffset*/) { return VK_SUCCESS; }
+VkResult vkBindImageMemory(VkDevice /*device*/, VkImage /*image*/, VkDeviceMemory /*memory*/, VkDeviceSize /*memoryOffset*/) { return VK_SUCCESS; }
+
+// -- OBJECTS ------------------------------------------------------------------------------
+
+VkResult vkCreateImageView(VkDevice /*device*/, const VkImageViewCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkImageView* pView)
+{
+	*pView = newHandle<VkImageView>();
+	return VK_SUCCESS;
+}
+void vkDestroyImageView(VkDevice /*device*/, VkImageView /*imageView*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateSampler(VkDevice /*device*/, const VkSamplerCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkSampler* pSampler)
+{
+	*pSampler = newHandle<VkSampler>();
+	return VK_SUCCESS;
+}
+void vkDestroySampler(VkDevice /*device*/, VkSampler /*sampler*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateRenderPass(VkDevice /*device*/, const VkRenderPassCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkRenderPass* pRenderPass)
+{
+	*pRenderPass = newHandle<VkRenderPass>();
+	return VK_SUCCESS;
+}
+void vkDestroyRenderPass(VkDevice /*device*/, VkRenderPass /*renderPass*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateFramebuffer(VkDevice /*device*/, const VkFramebufferCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkFramebuffer* pFramebuffer)
+{
+	*pFramebuffer = newHandle<VkFramebuffer>();
+	return VK_SUCCESS;
+}
+void vkDestroyFramebuffer(VkDevice /*device*/, VkFramebuffer /*framebuffer*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateShaderModule(VkDevice /*device*/, const VkShaderModuleCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkShaderModule* pShaderModule)
+{
+	*pShaderModule = newHandle<VkShaderModule>();
+	return VK_SUCCESS;
+}
+void vkDestroyShaderModule(VkDevice /*device*/, VkShaderModule /*shaderModule*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreatePipelineCache(VkDevice /*device*/, const VkPipelineCacheCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkPipelineCache* pPipelineCache)
+{
+	*pPipelineCache = newHandle<VkPipelineCache>();
+	return VK_SUCCESS;
+}
+void vkDestroyPipelineCache(VkDevice /*device*/, VkPipelineCache /*pipelineCache*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkGetPipelineCacheData(VkDevice /*device*/, VkPipelineCache /*pipelineCache*/, size_t* pDataSize, void* /*pData*/)
+{
+	*pDataSize = 0;				// Nothing to save, the real cache file is left alone
+	return VK_SUCCESS;
+}
+
+VkResult vkCreatePipelineLayout(VkDevice /*device*/, const VkPipelineLayoutCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkPipelineLayout* pPipelineLayout)
+{
+	*pPipelineLayout = newHandle<VkPipelineLayout>();
+	return VK_SUCCESS;
+}
+void vkDestroyPipelineLayout(VkDevice /*device*/, VkPipelineLayout /*pipelineLayout*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateGraphicsPipelines(VkDevice /*device*/, VkPipelineCache /*pipelineCache*/, uint32_t createInfoCount, const VkGraphicsPipelineCreateInfo* /*pCreateInfos*/,
+	const VkAllocationCallbacks* /*pAllocator*/, VkPipeline* pPipelines)
+{
+	fillHandles(pPipelines, createInfoCount);
+	return VK_SUCCESS;
+}
+
+VkResult vkCreateComputePipelines(VkDevice /*device*/, VkPipelineCache /*pipelineCache*/, uint32_t createInfoCount, const VkComputePipelineCreateInfo* /*pCreateInfos*/,
+	const VkAllocationCallbacks* /*pAllocator*/, VkPipeline* pPipelines)
+{
+	fillHandles(pPipelines, createInfoCount);
+	return VK_SUCCESS;
+}
+void vkDestroyPipeline(VkDevice /*device*/, VkPipeline /*pipeline*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateDescriptorSetLayout(VkDevice /*device*/, const VkDescriptorSetLayoutCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkDescriptorSetLayout* pSetLayout)
+{
+	*pSetLayout = newHandle<VkDescriptorSetLayout>();
+	return VK_SUCCESS;
+}
+void vkDestroyDescriptorSetLayout(VkDevice /*device*/, VkDescriptorSetLayout /*descriptorSetLayout*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkCreateDescriptorPool(VkDevice /*device*/, const VkDescriptorPoolCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkDescriptorPool* pDescriptorPool)
+{
+	*pDescriptorPool = newHandle<VkDescriptorPool>();
+	return VK_SUCCESS;
+}
+void vkDestroyDescriptorPool(VkDevice /*device*/, VkDescriptorPool /*descriptorPool*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkAllocateDescriptorSets(VkDevice /*device*/, const VkDescriptorSetAllocateInfo* pAllocateInfo, VkDescriptorSet* pDescriptorSets)
+{
+	fillHandles(pDescriptorSets, pAllocateInfo->descriptorSetCount);
+	return VK_SUCCESS;
+}
+VkResult vkFreeDescriptorSets(VkDevice /*device*/, VkDescriptorPool /*descriptorPool*/, uint32_t /*descriptorSetCount*/, const VkDescriptorSet* /*pDescriptorSets*/)
+{
+	return VK_SUCCESS;
+}
+
+void vkUpdateDescriptorSets(VkDevice /*device*/, uint32_t /*descriptorWriteCount*/, const VkWriteDescriptorSet* /*pDescriptorWrites*/,
+	uint32_t /*descriptorCopyCount*/, const VkCopyDescriptorSet* /*pDescriptorCopies*/) {}
+
+VkResult vkCreateQueryPool(VkDevice /*device*/, const VkQueryPoolCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkQueryPool* pQueryPool)
+{
+	*pQueryPool = newHandle<VkQueryPool>();
+	return VK_SUCCESS;
+}
+void vkDestroyQueryPool(VkDevice /*device*/, VkQueryPool /*queryPool*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+
+VkResult vkGetQueryPoolResults(VkDevice /*device*/, VkQueryPool /*queryPool*/, uint32_t /*firstQuery*/, uint32_t /*queryCount*/, size_t dataSize, void* pData,
+	VkDeviceSize /*stride*/, VkQueryResultFlags /*flags*/)
+{
+	memset(pData, 0, dataSize);
+	return VK_SUCCESS;
+}
+
+// -- COMMAND BUFFERS ----------------------------------------------------------------------
+
+VkResult vkCreateCommandPool(VkDevice /*device*/, const VkCommandPoolCreateInfo* /*pCreateInfo*/, const VkAllocationCallbacks* /*pAllocator*/, VkCommandPool* pCommandPool)
+{
+	*pCommandPool = newHandle<VkCommandPool>();
+	return VK_SUCCESS;
+}
+void vkDestroyCommandPool(VkDevice /*device*/, VkCommandPool /*commandPool*/, const VkAllocationCallbacks* /*pAllocator*/) {}
+VkResult vkResetCommandPool(VkDevice /*device*/, VkCommandPool /*commandPool*/, VkCommandPoolResetFlags /*flags*/) { return VK_SUCCESS; }
+
+VkResult vkAllocateCommandBuffers(VkDevice /*device*/, const VkCommandBufferAllocateInfo* pAllocateInfo, VkCommandBuffer* pCommandBuffers)
+{
+	fillHandles(pCommandBuffers, pAllocateInfo->commandBufferCount);
+	return VK_SUCCESS;
+}
+void vkFreeCommandBuffers(VkDevice /*device*/, VkCommandPool /*commandPool*/, uint32_t /*commandBufferCount*/, const VkCommandBuffer* /*pCommandBuffers*/) {}
+
+VkResult vkBeginCommandBuffer(VkCommandBuffer /*commandBuffer*/, const VkCommandBufferBeginInfo* /*pBeginInfo*/) { return VK_SUCCESS; }
+VkResult vkEndCommandBuffer(VkCommandBuffer /*commandBuffer*/) { return VK_SUCCESS; }
+
+void vkCmdBeginRenderPass(VkCommandBuffer /*commandBuffer*/, const VkRenderPassBeginInfo* /*pRenderPassBegin*/, VkSubpassContents /*contents*/) { countCommand(); }
+void vkCmdNextSubpass(VkCommandBuffer /*commandBuffer*/, VkSubpassContents /*contents*/) { countCommand(); }
+void vkCmdEndRenderPass(VkCommandBuffer /*commandBuffer*/) { countCommand(); }
+void vkCmdBindPipeline(VkCommandBuffer /*commandBuffer*/, VkPipelineBindPoint /*pipelineBindPoint*/, VkPipeline /*pipeline*/) { countCommand(); }
+void vkCmdBindDescriptorSets(VkCommandBuffer /*commandBuffer*/, VkPipelineBindPoint /*pipelineBindPoint*/, VkPipelineLayout /*layout*/, uint32_t /*firstSet*/,
+	uint32_t /*descriptorSetCount*/, const VkDescriptorSet* /*pDescriptorSets*/, uint32_t /*dynamicOffsetCount*/, const uint32_t* /*pDynamicOffsets*/) { countCommand(); }
+void vkCmdBindVertexBuffers(VkCommandBuffer /*commandBuffer*/, uint32_t /*firstBinding*/, uint32_t /*bindingCount*/, const VkBuffer* /*pBuffers*/, const VkDeviceSize* /*pOffsets*/) { countCommand(); }
+void vkCmdBindIndexBuffer(VkCommandBuffer /*commandBuffer*/, VkBuffer /*buffer*/, VkDeviceSize /*offset*/, VkIndexType /*indexType*/) { countCommand(); }
+void vkCmdPushConstants(VkCommandBuffer /*commandBuffer*/, VkPipelineLayout /*layout*/, VkShaderStageFlags /*stageFlags*/, uint32_t /*offset*/, uint32_t /*size*/, const void* /*pValues*/) { countCommand(); }
+void vkCmdSetViewport(VkCommandBuffer /*commandBuffer*/, uint32_t /*firstViewport*/, uint32_t /*viewportCount*/, const VkViewport* /*pViewports*/) { countCommand(); }
+void vkCmdSetScissor(VkCommandBuffer /*commandBuffer*/, uint32_t /*firstScissor*/, uint32_t /*scissorCount*/, const VkRect2D* /*pScissors*/) { countCommand(); }
+void vkCmdDraw(VkCommandBuffer /*commandBuffer*/, uint32_t /*vertexCount*/, uint32_t /*instanceCount*/, uint32_t /*firstVertex*/, uint32_t /*firstInstance*/) { countCommand(); }
+void vkCmdDrawIndexed(VkCommandBuffer /*commandBuffer*/, uint32_t /*indexCount*/, uint32_t /*instanceCount*/, uint32_t /*firstIndex*/, int32_t /*vertexOffset*/, uint32_t /*firstInstance*/) { countCommand(); }
+void vkCmdDrawIndexedIndirect(VkCommandBuffer /*commandBuffer*/, VkBuffer /*buffer*/, VkDeviceSize /*offset*/, uint32_t /*drawCount*/, uint32_t /*stride*/) { countCommand(); }
+void vkCmdDispatch(VkCommandBuffer /*commandBuffer*/, uint32_t /*groupCountX*/, uint32_t /*groupCountY*/, uint32_t /*groupCountZ*/) { countCommand(); }
+void vkCmdPipelineBarrier(VkCommandBuffer /*commandBuffer*/, VkPipelineStageFlags /*srcStageMask*/, VkPipelineStageFlags /*dstStageMask*/, VkDependencyFlags /*dependencyFlags*/,
+	uint32_t /*memoryBarrierCount*/, const VkMemoryBarrier* /*pMemoryBarriers*/, uint32_t /*bufferMemoryBarrierCount*/, const VkBufferMemoryBarrier* /*pBufferMemoryBarriers*/,
+	uint32_t /*imageMemoryBarrierCount*/, const VkImageMemoryBarrier* /*pImageMemoryBarriers*/) { countCommand(); }
+void vkCmdCopyBuffer(VkCommandBuffer /*commandBuffer*/, VkBuffer /*srcBuffer*/, VkBuffer /*dstBuffer*/, uint32_t /*regionCount*/, const VkBufferCopy* /*pRegions*/) { countCommand(); }
+void vkCmdCopyBufferToImage(VkCommandBuffer /*commandBuffer*/, VkBuffer /*srcBuffer*/, VkImage /*dstImage*/, VkImageLayout /*dstImageLayout*/,
+	uint32_t /*regionCount*/, const VkBufferImageCopy* /*pRegions*/) { countCommand(); }
+void vkCmdUpdateBuffer(VkCommandBuffer /*commandBuffer*/, VkBuffer /*dstBuffer*/, VkDeviceSize /*dstOffset*/, VkDeviceSize /*dataSize*/, const void* /*pData*/) { countCommand(); }
+void vkCmdResetQueryPool(VkCommandBuffer /*commandBuffer*/, VkQueryPool /*queryPool*/, uint32_t /*firstQuery*/, uint32_t /*queryCount*/) { countCommand(); }
+void vkCmdWriteTimestamp(VkCommandBuffer /*commandBuffer*/, VkPipelineStageFlagBits /*pipelineStage*/, VkQueryPool /*queryPool*/, uint32_t /*query*/) { countCommand(); }
+void vkCmdBeginQuery(VkCommandBuffer /*commandBuffer*/, VkQueryPool /*queryPool*/, uint32_t /*query*/, VkQueryControlFlags /*flags*/) { countCommand(); }
+void vkCmdEndQuery(VkCommandBuffer /*commandBuffer*/, VkQueryPool /*queryPool*/, uint32_t /*query*/) { countCommand(); }
@@ -0,0 +1,21 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+
+// Host only stand-in for the Vulkan loader and the GLFW window/surface entry points, linked instead of vulkan-1.lib and glfw3.lib
+// by the microbenchmarks so the renderer's CPU paths run without a GPU.
+// Reports one device with a single graphics + present queue family (no timestamps), all memory types host visible.
+// Every vkCmd* is a no-op that only counts itself, device memory is plain host memory so mapped writes are real writes
+class MockVulkan
+{
+public:
+	// Surface size reported by glfwGetFramebufferSize() and the surface capabilities, call before VulkanRenderer::init()
+	static void setSurfaceExtent(uint32_t width, uint32_t height);
+
+	// vkCmd* calls since the start of the process
+	static uint64_t getCommandCount();
+	// Device memory currently allocated through vkAllocateMemory
+	static uint64_t getAllocatedBytes();
+};
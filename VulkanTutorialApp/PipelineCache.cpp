@@ -0,0 +1,158 @@
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#include "PipelineCache.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+PipelineCache::PipelineCache()
+{
+}
+
+PipelineCache::PipelineCache(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const std::string& newFileName)
+{
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	fileName = newFileName;
+
+	// Seed with the blob from the last run, an empty cache if there is none or it belongs to another driver/device
+	std::vector<char> initialData = loadValidBlob();
+	warmStart = !initialData.empty();
+
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheCreateInfo.initialDataSize = initialData.size();
+	cacheCreateInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+	VkResult result = vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &cache);
+	if (result != VK_SUCCESS && warmStart)
+	{
+		// Driver refused the blob after all, start from an empty cache
+		printf("Pipeline cache: driver rejected %s, starting cold\n", fileName.c_str());
+		warmStart = false;
+		cacheCreateInfo.initialDataSize = 0;
+		cacheCreateInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(device, &cacheCreateInfo, nullptr, &cache);
+	}
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Pipeline Cache!");
+	}
+}
+
+VkPipelineCache PipelineCache::getCache()
+{
+	return cache;
+}
+
+void PipelineCache::logCreation(const char* pipelineName, std::chrono::steady_clock::time_point startTime)
+{
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	pipelineCount++;
+	totalCreationMs += ms;
+	printf("Pipeline cache: %s created in %.2f ms (%s)\n", pipelineName, ms, warmStart ? "warm" : "cold");
+}
+
+std::vector<char> PipelineCache::loadValidBlob()
+{
+	std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+	{
+		printf("Pipeline cache: no %s yet, starting cold\n", fileName.c_str());
+		return {};
+	}
+
+	size_t fileSize = (size_t)file.tellg();
+	std::vector<char> blob(fileSize);
+	file.seekg(0);
+	file.read(blob.data(), fileSize);
+	file.close();
+
+	// Header version one: header size, header version, vendor ID, device ID, pipeline cache UUID
+	const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+	if (blob.size() < headerSize)
+	{
+		printf("Pipeline cache: %s is truncated, starting cold\n", fileName.c_str());
+		return {};
+	}
+
+	uint32_t header[4];
+	memcpy(header, blob.data(), sizeof(header));
+	uint8_t cacheUUID[VK_UUID_SIZE];
+	memcpy(cacheUUID, blob.data() + sizeof(header), VK_UUID_SIZE);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	if (header[0] < headerSize || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		header[2] != deviceProperties.vendorID || header[3] != deviceProperties.deviceID ||
+		memcmp(cacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		printf("Pipeline cache: %s was written by another driver or device, starting cold\n", fileName.c_str());
+		return {};
+	}
+
+	printf("Pipeline cache: loaded %zu bytes from %s\n", blob.size(), fileName.c_str());
+	return blob;
+}
+
+void PipelineCache::save()
+{
+	if (cache == VK_NULL_HANDLE) return;
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(device, cache, &dataSize, nullptr);
+	std::vector<char> data(dataSize);
+	if (dataSize == 0 || vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	// Write next to the real file, then swap it in
+	std::string tempFileName = fileName + ".tmp";
+	std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		printf("Pipeline cache: failed to open %s for writing\n", tempFileName.c_str());
+		return;
+	}
+	file.write(data.data(), dataSize);
+	file.close();
+	if (file.fail())
+	{
+		printf("Pipeline cache: failed to write %s\n", tempFileName.c_str());
+		std::remove(tempFileName.c_str());
+		return;
+	}
+
+#ifdef _WIN32
+	bool replaced = MoveFileExA(tempFileName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool replaced = std::rename(tempFileName.c_str(), fileName.c_str()) == 0;
+#endif
+	if (!replaced)
+	{
+		printf("Pipeline cache: failed to replace %s\n", fileName.c_str());
+		std::remove(tempFileName.c_str());
+		return;
+	}
+
+	printf("Pipeline cache: %u pipelines created in %.2f ms this run (%s), saved %zu bytes to %s\n",
+		pipelineCount, totalCreationMs, warmStart ? "warm" : "cold", dataSize, fileName.c_str());
+}
+
+void PipelineCache::destroyCache()
+{
+	vkDestroyPipelineCache(device, cache, nullptr);
+	cache = VK_NULL_HANDLE;
+}
+
+PipelineCache::~PipelineCache()
+{
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <string>
+#include <chrono>
+
+// VkPipelineCache persisted on disk between runs, the blob is only reused if it was written by the same driver + device
+class PipelineCache
+{
+public:
+	PipelineCache();
+	PipelineCache(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, const std::string& newFileName);
+
+	VkPipelineCache getCache();
+
+	// Log how long a pipeline took to create, tagged warm when the cache was seeded from disk
+	void logCreation(const char* pipelineName, std::chrono::steady_clock::time_point startTime);
+
+	// Write the cache back to disk, through a temporary file so a crash never leaves a truncated blob behind
+	void save();
+	void destroyCache();
+
+	~PipelineCache();
+
+private:
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache cache = VK_NULL_HANDLE;
+	std::string fileName;
+
+	bool warmStart = false;				// Cache seeded from a valid blob on disk
+	uint32_t pipelineCount = 0;
+	double totalCreationMs = 0.0;
+
+	std::vector<char> loadValidBlob();
+};
@@ -0,0 +1,195 @@
+#include "ShaderCompiler.h"
+#include "JobSystem.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+
+// Everything that changes the generated SPIR-V besides the source, bump the version when the compile setup changes
+static const std::string SHADER_COMPILE_OPTIONS = "v2;vulkan1.0;shaderc-performance";
+
+ShaderCompiler::ShaderCompiler()
+{
+}
+
+ShaderCompiler::ShaderCompiler(const std::string& newSourceDirectory, const std::string& newCacheDirectory)
+{
+	sourceDirectory = newSourceDirectory;
+	cacheDirectory = newCacheDirectory;
+
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+}
+
+void ShaderCompiler::compileAll(const std::vector<std::string>& fileNames)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	// Each shader writes only its own slot, shaderc::Compiler is created per shader so nothing is shared
+	std::vector<std::vector<uint32_t>> results(fileNames.size());
+	std::vector<std::string> errors(fileNames.size());
+	JobSystem::parallelFor(fileNames.size(), 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+		{
+			results[i] = compile(fileNames[i], &errors[i]);
+		}
+	});
+
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		if (!errors[i].empty())
+		{
+			printf("Shader compile ERROR (%s): %s\n", fileNames[i].c_str(), errors[i].c_str());
+		}
+		spirvList[fileNames[i]] = std::move(results[i]);
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Shaders: %zu ready in %.2f ms\n", fileNames.size(), ms);
+}
+
+const std::vector<uint32_t>& ShaderCompiler::getSpirv(const std::string& fileName)
+{
+	auto spirv = spirvList.find(fileName);
+	if (spirv == spirvList.end() || spirv->second.empty())
+	{
+		throw std::runtime_error("Shader not compiled: " + fileName);
+	}
+	return spirv->second;
+}
+
+bool ShaderCompiler::recompile(const std::string& fileName)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::string error;
+	std::vector<uint32_t> spirv = compile(fileName, &error);
+	if (!error.empty() || spirv.empty())
+	{
+		printf("Shader compile ERROR (%s): %s\n", fileName.c_str(), error.c_str());
+		return false;
+	}
+	spirvList[fileName] = std::move(spirv);
+
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	printf("Shaders: %s recompiled in %.2f ms\n", fileName.c_str(), ms);
+	return true;
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(const std::string& fileName, std::string* outError)
+{
+	// Read the GLSL source
+	std::ifstream file(sourceDirectory + "/" + fileName, std::ios::binary);
+	if (!file.is_open())
+	{
+		*outError = "failed to open " + sourceDirectory + "/" + fileName;
+		return {};
+	}
+	std::stringstream sourceStream;
+	sourceStream << file.rdbuf();
+	std::string source = sourceStream.str();
+
+	// Cache hit: same source + same options
+	char hashText[17];
+	snprintf(hashText, sizeof(hashText), "%016llx", static_cast<unsigned long long>(hashSource(source, SHADER_COMPILE_OPTIONS)));
+	std::string cacheFileName = cacheDirectory + "/" + fileName + "." + hashText + ".spv";
+
+	std::vector<uint32_t> spirv;
+	if (readCache(cacheFileName, &spirv))
+	{
+		return spirv;
+	}
+
+	// GLSL -> SPIR-V, shaderc runs the spirv-opt performance passes itself so no separate optimizer library is linked
+	shaderc::Compiler compiler;
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+
+	shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, getShaderKind(fileName), fileName.c_str(), options);
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+	{
+		*outError = result.GetErrorMessage();
+		return {};
+	}
+	spirv.assign(result.cbegin(), result.cend());
+
+	writeCache(fileName, cacheFileName, spirv);
+	return spirv;
+}
+
+bool ShaderCompiler::readCache(const std::string& cacheFileName, std::vector<uint32_t>* outSpirv)
+{
+	std::ifstream file(cacheFileName, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return false;
+
+	size_t fileSize = (size_t)file.tellg();
+	if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) return false;		// Not a whole SPIR-V module, recompile
+
+	outSpirv->resize(fileSize / sizeof(uint32_t));
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(outSpirv->data()), fileSize);
+	return !file.fail();
+}
+
+void ShaderCompiler::writeCache(const std::string& fileName, const std::string& cacheFileName, const std::vector<uint32_t>& spirv)
+{
+	// Write to a temporary file then rename it in place, a crash never leaves a truncated module under a valid name
+	std::string tempFileName = cacheFileName + ".tmp";
+	std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) return;
+	file.write(reinterpret_cast<const char*>(spirv.data()), spirv.size() * sizeof(uint32_t));
+	file.close();
+
+	std::error_code error;
+	std::filesystem::rename(tempFileName, cacheFileName, error);
+	if (error)
+	{
+		std::filesystem::remove(tempFileName, error);
+		return;
+	}
+
+	// Drop the entries of older versions of this source
+	std::string prefix = fileName + ".";
+	for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error))
+	{
+		std::string entryName = entry.path().filename().string();
+		if (entryName.compare(0, prefix.size(), prefix) == 0 && entry.path() != std::filesystem::path(cacheFileName))
+		{
+			std::error_code removeError;
+			std::filesystem::remove(entry.path(), removeError);
+		}
+	}
+}
+
+shaderc_shader_kind ShaderCompiler::getShaderKind(const std::string& fileName)
+{
+	std::string extension = std::filesystem::path(fileName).extension().string();
+	if (extension == ".vert") return shaderc_glsl_vertex_shader;
+	if (extension == ".frag") return shaderc_glsl_fragment_shader;
+	if (extension == ".comp") return shaderc_glsl_compute_shader;
+	return shaderc_glsl_infer_from_source;
+}
+
+uint64_t ShaderCompiler::hashSource(const std::string& source, const std::string& options)
+{
+	// 64 bit FNV-1a over the options then the source
+	uint64_t hash = 14695981039346656037ull;
+	for (const std::string* text : { &options, &source })
+	{
+		for (char c : *text)
+		{
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <shaderc/shaderc.hpp>
+
+// Compiles GLSL sources to SPIR-V at startup (shaderc with performance optimisation).
+// Results are cached on disk under a hash of the source and the compile options, so only shaders whose source changed are recompiled
+class ShaderCompiler
+{
+public:
+	ShaderCompiler();
+	ShaderCompiler(const std::string& newSourceDirectory, const std::string& newCacheDirectory);
+
+	// Compile (or load from the cache) every shader in parallel, a failure is logged and leaves that shader without SPIR-V
+	void compileAll(const std::vector<std::string>& fileNames);
+
+	// SPIR-V of a shader handled by compileAll(), throws if it failed to compile
+	const std::vector<uint32_t>& getSpirv(const std::string& fileName);
+	// Hot reload: compiles 1 shader again, a failure is logged and the SPIR-V compiled before is kept. True when the SPIR-V was replaced
+	bool recompile(const std::string& fileName);
+
+	~ShaderCompiler();
+
+private:
+	std::string sourceDirectory;
+	std::string cacheDirectory;
+	std::unordered_map<std::string, std::vector<uint32_t>> spirvList;
+
+	std::vector<uint32_t> compile(const std::string& fileName, std::string* outError);
+	bool readCache(const std::string& cacheFileName, std::vector<uint32_t>* outSpirv);
+	void writeCache(const std::string& fileName, const std::string& cacheFileName, const std::vector<uint32_t>& spirv);
+
+	static shaderc_shader_kind getShaderKind(const std::string& fileName);
+	static uint64_t hashSource(const std::string& source, const std::string& options);
+};
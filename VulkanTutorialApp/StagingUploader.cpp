@@ -0,0 +1,186 @@
+#include "StagingUploader.h"
+#include "DebugUtils.h"
+
+#include <algorithm>
+#include <limits>
+
+StagingUploader::StagingUploader(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue newTransferQueue,
+	VkCommandPool newTransferCommandPool)
+{
+	physicalDevice = newPhysicalDevice;
+	device = newDevice;
+	transferQueue = newTransferQueue;
+	transferCommandPool = newTransferCommandPool;
+
+	// Plain host visible memory is usually write combined, reading it back from the CPU is very slow
+	stagingMemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if (hasMemoryType(physicalDevice, ~0u, stagingMemoryProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+	{
+		stagingMemoryProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	}
+}
+
+StagingRegion StagingUploader::allocate(VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Sub-allocate linearly from the last block, open a new block when it is full
+	VkDeviceSize alignedSize = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+	if (blocks.empty() || blocks.back().used + alignedSize > blocks.back().size)
+	{
+		StagingBlock block = {};
+		block.size = std::max(STAGING_BLOCK_SIZE, alignedSize);
+		createBuffer(physicalDevice, device, block.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			stagingMemoryProperties, &block.buffer, &block.memory, MEMORY_CATEGORY_STAGING);
+		DebugUtils::setObjectName(device, VK_OBJECT_TYPE_BUFFER, block.buffer, "Staging block");
+
+		// Mapped once for the whole life of the block
+		void* data;
+		vkMapMemory(device, block.memory, 0, block.size, 0, &data);
+		block.mapped = static_cast<uint8_t*>(data);
+
+		blocks.push_back(block);
+	}
+
+	StagingBlock& block = blocks.back();
+	StagingRegion region = {};
+	region.buffer = block.buffer;
+	region.offset = block.used;
+	region.size = size;
+	region.data = block.mapped + block.used;
+	block.used += alignedSize;
+
+	return region;
+}
+
+void StagingUploader::copyToBuffer(const StagingRegion& region, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PendingCopy copy = {};
+	copy.srcBuffer = region.buffer;
+	copy.dstBuffer = dstBuffer;
+	copy.region.srcOffset = region.offset;
+	copy.region.dstOffset = dstOffset;
+	copy.region.size = region.size;
+	pendingCopies.push_back(copy);
+}
+
+void StagingUploader::copyToImage(const StagingRegion& region, VkImage dstImage, uint32_t width, uint32_t height, uint32_t layerCount)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PendingImageCopy copy = {};
+	copy.srcBuffer = region.buffer;
+	copy.dstImage = dstImage;
+	copy.region.bufferOffset = region.offset;
+	copy.region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	copy.region.imageSubresource.layerCount = layerCount;
+	copy.region.imageExtent = { width, height, 1 };
+	pendingImageCopies.push_back(copy);
+}
+
+void StagingUploader::flush()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!pendingCopies.empty() || !pendingImageCopies.empty())
+	{
+		// 1 command buffer and 1 submission for every copy instead of one wait per buffer
+		VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
+		recordPendingCopies(transferCommandBuffer);
+		endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
+	}
+
+	releaseBlocks();
+}
+
+void StagingUploader::submit()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (submitFence != VK_NULL_HANDLE)
+	{
+		throw std::runtime_error("Staging uploader submitted twice!");
+	}
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(device, &fenceCreateInfo, nullptr, &submitFence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Fence!");
+	}
+
+	// Same single command buffer as flush(), but the fence is polled instead of waiting for the queue
+	submittedCommandBuffer = beginCommandBuffer(device, transferCommandPool);
+	recordPendingCopies(submittedCommandBuffer);
+	vkEndCommandBuffer(submittedCommandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &submittedCommandBuffer;
+	if (vkQueueSubmit(transferQueue, 1, &submitInfo, submitFence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit staging copies!");
+	}
+}
+
+bool StagingUploader::poll()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (submitFence != VK_NULL_HANDLE)
+	{
+		if (vkGetFenceStatus(device, submitFence) != VK_SUCCESS) return false;
+		releaseSubmission();
+		releaseBlocks();
+	}
+	return true;
+}
+
+void StagingUploader::recordPendingCopies(VkCommandBuffer commandBuffer)
+{
+	for (const PendingCopy& copy : pendingCopies)
+	{
+		vkCmdCopyBuffer(commandBuffer, copy.srcBuffer, copy.dstBuffer, 1, &copy.region);
+	}
+	for (const PendingImageCopy& copy : pendingImageCopies)
+	{
+		recordImageLayoutTransition(commandBuffer, copy.dstImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		vkCmdCopyBufferToImage(commandBuffer, copy.srcBuffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+		recordImageLayoutTransition(commandBuffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	pendingCopies.clear();
+	pendingImageCopies.clear();
+}
+
+void StagingUploader::releaseSubmission()
+{
+	vkFreeCommandBuffers(device, transferCommandPool, 1, &submittedCommandBuffer);
+	vkDestroyFence(device, submitFence, nullptr);
+	submittedCommandBuffer = VK_NULL_HANDLE;
+	submitFence = VK_NULL_HANDLE;
+}
+
+void StagingUploader::releaseBlocks()
+{
+	for (StagingBlock& block : blocks)
+	{
+		vkUnmapMemory(device, block.memory);
+		vkDestroyBuffer(device, block.buffer, nullptr);
+		MemoryTracker::freeMemory(device, block.memory);
+	}
+	blocks.clear();
+}
+
+StagingUploader::~StagingUploader()
+{
+	// Copies that were never flushed are dropped, submitted ones still read the staging memory
+	if (submitFence != VK_NULL_HANDLE)
+	{
+		vkWaitForFences(device, 1, &submitFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		releaseSubmission();
+	}
+	releaseBlocks();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include <mutex>
+#include "Utility.h"
+
+// A piece of mapped staging memory handed out by the StagingUploader
+struct StagingRegion {
+	VkBuffer buffer;			// Staging buffer the region lives in
+	VkDeviceSize offset;		// Offset of the region in that buffer
+	VkDeviceSize size;
+	void* data;					// Mapped pointer to the start of the region, write the data to upload here
+};
+
+// Hands out mapped staging memory so data can be written straight to where the GPU copies it from,
+// then uploads every pending copy with a single command buffer submission, blocking in flush() or polled with submit() / poll()
+class StagingUploader
+{
+public:
+	StagingUploader(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue newTransferQueue,
+		VkCommandPool newTransferCommandPool);
+
+	// Thread safe, the returned memory stays mapped until flush()
+	StagingRegion allocate(VkDeviceSize size);
+	// Queue a copy from a staging region to a device buffer, executed in flush()
+	void copyToBuffer(const StagingRegion& region, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+	// Queue a copy of tightly packed RGBA8 texels to a new image, which ends up in SHADER_READ_ONLY_OPTIMAL. Layers of an array image follow each other in region
+	void copyToImage(const StagingRegion& region, VkImage dstImage, uint32_t width, uint32_t height, uint32_t layerCount = 1);
+	// Submit all queued copies at once, wait for them and release the staging memory
+	void flush();
+	// Submit all queued copies at once without waiting, only once per uploader. The staging memory stays alive until poll() sees them done
+	void submit();
+	// True when no submitted copy is in flight anymore, the staging memory is released the first time the copies are seen finished
+	bool poll();
+
+	~StagingUploader();
+
+private:
+	struct StagingBlock {
+		VkBuffer buffer;
+		VkDeviceMemory memory;
+		uint8_t* mapped;
+		VkDeviceSize size;
+		VkDeviceSize used;
+	};
+
+	struct PendingCopy {
+		VkBuffer srcBuffer;
+		VkBuffer dstBuffer;
+		VkBufferCopy region;
+	};
+
+	struct PendingImageCopy {
+		VkBuffer srcBuffer;
+		VkImage dstImage;
+		VkBufferImageCopy region;
+	};
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+	VkQueue transferQueue;
+	VkCommandPool transferCommandPool;
+
+	VkMemoryPropertyFlags stagingMemoryProperties;		// Host cached when available, the importer reads the vertices back while building meshlets and LODs
+	std::vector<StagingBlock> blocks;
+	std::vector<PendingCopy> pendingCopies;
+	std::vector<PendingImageCopy> pendingImageCopies;
+	std::mutex mutex;
+
+	// submit() in flight
+	VkCommandBuffer submittedCommandBuffer = VK_NULL_HANDLE;
+	VkFence submitFence = VK_NULL_HANDLE;
+
+	void recordPendingCopies(VkCommandBuffer commandBuffer);
+	void releaseSubmission();
+	void releaseBlocks();
+};
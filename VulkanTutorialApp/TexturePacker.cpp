@@ -0,0 +1,109 @@
+#include "TexturePacker.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+TexturePackLayout TexturePacker::plan(const std::vector<glm::uvec2>& sizes)
+{
+	TexturePackLayout layout;
+	layout.placements.resize(sizes.size());
+	for (const glm::uvec2& size : sizes)
+	{
+		layout.layerWidth = std::max(layout.layerWidth, size.x);
+		layout.layerHeight = std::max(layout.layerHeight, size.y);
+	}
+
+	// Tallest first, the first texture of a shelf sets its height
+	std::vector<size_t> order(sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a].y > sizes[b].y; });
+
+	// Shelves of the atlas layer being filled
+	bool atlasOpen = false;
+	uint32_t atlasLayer = 0;
+	uint32_t shelfX = 0;
+	uint32_t shelfY = 0;
+	uint32_t shelfHeight = 0;
+	for (size_t i : order)
+	{
+		TexturePlacement& placement = layout.placements[i];
+		placement.width = sizes[i].x;
+		placement.height = sizes[i].y;
+		uint32_t paddedWidth = placement.width + 2 * TEXTURE_ATLAS_GUTTER;
+		uint32_t paddedHeight = placement.height + 2 * TEXTURE_ATLAS_GUTTER;
+
+		if (paddedWidth > layout.layerWidth || paddedHeight > layout.layerHeight)
+		{
+			// No room for a gutter on every side (textures the layer size): a layer of its own
+			placement.layer = layout.layerCount++;
+			placement.x = 0;
+			placement.y = 0;
+		}
+		else
+		{
+			// Next shelf when this one is full, next atlas layer when there is no room for another shelf
+			if (atlasOpen && shelfX + paddedWidth > layout.layerWidth)
+			{
+				shelfY += shelfHeight;
+				shelfX = 0;
+				shelfHeight = 0;
+			}
+			if (!atlasOpen || shelfY + paddedHeight > layout.layerHeight)
+			{
+				atlasLayer = layout.layerCount++;
+				atlasOpen = true;
+				shelfX = 0;
+				shelfY = 0;
+				shelfHeight = 0;
+			}
+
+			placement.layer = atlasLayer;
+			placement.x = shelfX + TEXTURE_ATLAS_GUTTER;
+			placement.y = shelfY + TEXTURE_ATLAS_GUTTER;
+			shelfX += paddedWidth;
+			shelfHeight = std::max(shelfHeight, paddedHeight);
+		}
+
+		placement.uvTransform = glm::vec4(
+			static_cast<float>(placement.width) / layout.layerWidth, static_cast<float>(placement.height) / layout.layerHeight,
+			static_cast<float>(placement.x) / layout.layerWidth, static_cast<float>(placement.y) / layout.layerHeight);
+	}
+
+	return layout;
+}
+
+void TexturePacker::write(const TexturePackLayout& layout, size_t textureIndex, const uint8_t* pixels, uint8_t* outLayers)
+{
+	const TexturePlacement& placement = layout.placements[textureIndex];
+	const size_t pixelSize = 4;
+	uint8_t* layer = outLayers + static_cast<size_t>(placement.layer) * layout.layerWidth * layout.layerHeight * pixelSize;
+
+	// Placement + gutter, clamped to the layer. Gutter pixels repeat the closest edge pixel of the texture
+	uint32_t firstX = placement.x - std::min(placement.x, TEXTURE_ATLAS_GUTTER);
+	uint32_t endX = std::min(layout.layerWidth, placement.x + placement.width + TEXTURE_ATLAS_GUTTER);
+	uint32_t firstY = placement.y - std::min(placement.y, TEXTURE_ATLAS_GUTTER);
+	uint32_t endY = std::min(layout.layerHeight, placement.y + placement.height + TEXTURE_ATLAS_GUTTER);
+
+	for (uint32_t y = firstY; y < endY; y++)
+	{
+		uint32_t sourceY = std::min(placement.height - 1, y - std::min(y, placement.y));
+		const uint8_t* sourceRow = pixels + static_cast<size_t>(sourceY) * placement.width * pixelSize;
+		uint8_t* row = layer + static_cast<size_t>(y) * layout.layerWidth * pixelSize;
+
+		for (uint32_t x = firstX; x < placement.x; x++)
+		{
+			memcpy(row + x * pixelSize, sourceRow, pixelSize);
+		}
+		memcpy(row + placement.x * pixelSize, sourceRow, placement.width * pixelSize);
+		for (uint32_t x = placement.x + placement.width; x < endX; x++)
+		{
+			memcpy(row + x * pixelSize, sourceRow + (placement.width - 1) * pixelSize, pixelSize);
+		}
+	}
+}
+
+std::string TexturePacker::getPackedName(const std::string& meshFileName)
+{
+	return meshFileName + " (packed textures)";
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Utility.h"
+
+// Where one texture of a packed model ends up
+struct TexturePlacement {
+	uint32_t layer;
+	uint32_t x;
+	uint32_t y;
+	uint32_t width;
+	uint32_t height;
+	glm::vec4 uvTransform;					// xy: scale, zw: offset, uv in the layer = uv * scale + offset
+};
+
+// Layers of a VK_IMAGE_VIEW_TYPE_2D_ARRAY, all layerWidth x layerHeight
+struct TexturePackLayout {
+	uint32_t layerWidth = 0;
+	uint32_t layerHeight = 0;
+	uint32_t layerCount = 0;
+	std::vector<TexturePlacement> placements;	// Same order as the sizes given to plan()
+};
+
+// Packs the textures of one model into a texture array, so the whole model renders with a single sampler descriptor set.
+// The layer size is the size of the biggest texture: textures that size get a layer each, smaller ones share atlas layers
+// (shelf packing) with TEXTURE_ATLAS_GUTTER pixels of edge replication around them so bilinear filtering doesn't bleed
+class TexturePacker
+{
+public:
+	static TexturePackLayout plan(const std::vector<glm::uvec2>& sizes);
+	// Copies the RGBA8 pixels of texture textureIndex to its placement and fills its gutter. outLayers holds every layer
+	// back to back. Textures only write their own placement + gutter, so they can be written in parallel
+	static void write(const TexturePackLayout& layout, size_t textureIndex, const uint8_t* pixels, uint8_t* outLayers);
+
+	// Name the texture array of a model is known by (loadedTextures, debug names)
+	static std::string getPackedName(const std::string& meshFileName);
+};
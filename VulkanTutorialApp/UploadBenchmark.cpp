@@ -0,0 +1,548 @@
+// Host to device upload throughput: the renderer's upload paths (createBuffer + copyBuffer per upload, copyImageBuffer,
+// the batching StagingUploader) against a persistent staging ring and, when the device has host visible device local memory,
+// plain writes into it. Swept over upload size, batching depth (uploads per submission) and the queue doing the copies.
+// No window, no swapchain: only a device with a queue per tested family
+
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include "StagingUploader.h"
+#include "Utility.h"
+
+const VkDeviceSize UPLOAD_MIN_SIZE = 4 * 1024;
+const VkDeviceSize UPLOAD_MAX_SIZE = 256 * 1024 * 1024;
+const VkDeviceSize UPLOAD_MAX_BATCH_BYTES = 256 * 1024 * 1024;		// size x depth cap, also the size of the destination buffer
+const uint32_t UPLOAD_BATCH_DEPTHS[] = { 1, 8, 64 };
+const uint32_t UPLOAD_RING_SLOTS = 4;								// Staging ring: slots in flight, each with its own command buffer and fence
+const VkDeviceSize UPLOAD_RING_SLOT_SIZE = 16 * 1024 * 1024;
+const uint64_t UPLOAD_MIN_OPS = 2;
+
+struct UploadBenchmarkConfig {
+	VkDeviceSize maxSize = UPLOAD_MAX_SIZE;
+	double minSeconds = 0.25;						// Per measurement, on top of 1 warm up op
+	std::string filter;								// Only the strategies whose name contains this
+	std::string outputFile = "upload_benchmark.json";
+};
+
+// A queue the copies can run on, with its own command pool
+struct UploadQueue {
+	std::string name;
+	uint32_t familyIndex;
+	VkQueue queue;
+	VkCommandPool commandPool;
+};
+
+struct UploadResult {
+	std::string strategy;
+	std::string queue;								// "-" for direct writes, no queue involved
+	VkDeviceSize size;
+	uint32_t depth;
+	uint64_t uploads;
+	double bytesPerSecond;
+	double usPerUpload;
+};
+
+// Persistent mapped staging memory split in slots, reused round robin: writing a slot only waits for that slot's last copy,
+// so filling one slot overlaps with the copies of the others
+struct StagingRing {
+	VkBuffer buffer;
+	VkDeviceMemory memory;
+	uint8_t* mapped;
+	struct Slot {
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+		VkDeviceSize used;
+		bool recording;
+	} slots[UPLOAD_RING_SLOTS];
+	uint32_t currentSlot;
+};
+
+UploadBenchmarkConfig config;
+VkInstance instance;
+VkPhysicalDevice physicalDevice;
+VkPhysicalDeviceProperties deviceProperties;
+VkDevice device;
+std::vector<UploadQueue> queues;
+std::vector<uint8_t> sourceData;					// What gets uploaded, the size of the biggest upload
+VkBuffer destinationBuffer;							// Device local, every batch copies to consecutive ranges of it
+VkDeviceMemory destinationMemory;
+std::vector<UploadResult> results;
+
+// --name=value arguments, anything unknown is ignored
+UploadBenchmarkConfig parseArguments(int argc, char** argv) {
+	UploadBenchmarkConfig parsed;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		size_t equals = arg.find('=');
+		std::string name = arg.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+		if (name == "--max-size-mib") parsed.maxSize = std::stoull(value) * 1024 * 1024;
+		else if (name == "--min-time") parsed.minSeconds = std::stod(value);
+		else if (name == "--filter") parsed.filter = value;
+		else if (name == "--output") parsed.outputFile = value;
+	}
+	parsed.maxSize = std::min(std::max(parsed.maxSize, UPLOAD_MIN_SIZE), UPLOAD_MAX_SIZE);
+	return parsed;
+}
+
+std::string formatSize(VkDeviceSize size) {
+	if (size >= 1024 * 1024) return std::to_string(size / (1024 * 1024)) + " MiB";
+	return std::to_string(size / 1024) + " KiB";
+}
+
+// -- DEVICE -------------------------------------------------------------------------------
+
+// First discrete GPU, otherwise the first device. A queue on the graphics family (where the renderer uploads today) and one on a
+// dedicated transfer family, or failing that an async compute family, when the device has one
+void createDevice() {
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Upload Benchmark";
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceCreateInfo = {};
+	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceCreateInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceCreateInfo, nullptr, &instance) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a Vulkan Instance!");
+	}
+
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	if (deviceCount == 0) {
+		throw std::runtime_error("Can't find GPUs that support Vulkan Instance!");
+	}
+	std::vector<VkPhysicalDevice> deviceList(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, deviceList.data());
+	physicalDevice = deviceList[0];
+	for (VkPhysicalDevice candidate : deviceList) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+		if (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+			physicalDevice = candidate;
+			break;
+		}
+	}
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+	int graphicsFamily = -1, transferFamily = -1, computeFamily = -1;
+	for (uint32_t i = 0; i < familyCount; i++) {
+		VkQueueFlags flags = families[i].queueFlags;
+		if (families[i].queueCount == 0) continue;
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) && graphicsFamily < 0) graphicsFamily = i;
+		else if (!(flags & VK_QUEUE_GRAPHICS_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT) && (flags & VK_QUEUE_TRANSFER_BIT) && transferFamily < 0) transferFamily = i;
+		else if (!(flags & VK_QUEUE_GRAPHICS_BIT) && (flags & VK_QUEUE_COMPUTE_BIT) && computeFamily < 0) computeFamily = i;
+	}
+	if (graphicsFamily < 0) {
+		throw std::runtime_error("No graphics queue family!");
+	}
+	queues.push_back({ "graphics", static_cast<uint32_t>(graphicsFamily), VK_NULL_HANDLE, VK_NULL_HANDLE });
+	if (transferFamily >= 0) queues.push_back({ "transfer", static_cast<uint32_t>(transferFamily), VK_NULL_HANDLE, VK_NULL_HANDLE });
+	else if (computeFamily >= 0) queues.push_back({ "compute", static_cast<uint32_t>(computeFamily), VK_NULL_HANDLE, VK_NULL_HANDLE });
+
+	float priority = 1.0f;
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for (const UploadQueue& uploadQueue : queues) {
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = uploadQueue.familyIndex;
+		queueCreateInfo.queueCount = 1;
+		queueCreateInfo.pQueuePriorities = &priority;
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
+
+	VkDeviceCreateInfo deviceCreateInfo = {};
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+	if (vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a Logical Device!");
+	}
+
+	for (UploadQueue& uploadQueue : queues) {
+		vkGetDeviceQueue(device, uploadQueue.familyIndex, 0, &uploadQueue.queue);
+
+		// Reset per command buffer, the staging ring re-records its slots
+		VkCommandPoolCreateInfo poolCreateInfo = {};
+		poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		poolCreateInfo.queueFamilyIndex = uploadQueue.familyIndex;
+		if (vkCreateCommandPool(device, &poolCreateInfo, nullptr, &uploadQueue.commandPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a Command Pool!");
+		}
+	}
+
+	MemoryTracker::init(instance, physicalDevice, false);
+}
+
+void destroyDevice() {
+	for (UploadQueue& uploadQueue : queues) {
+		vkDestroyCommandPool(device, uploadQueue.commandPool, nullptr);
+	}
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+}
+
+// -- MEASUREMENT --------------------------------------------------------------------------
+
+bool isSelected(const std::string& strategy) {
+	return config.filter.empty() || strategy.find(config.filter) != std::string::npos;
+}
+
+// op uploads depth x size bytes. After the timed loop the queue is drained, so copies still in flight (staging ring) are counted
+template <typename Op>
+void measure(const std::string& strategy, const UploadQueue* uploadQueue, VkDeviceSize size, uint32_t depth, Op op) {
+	op();						// Warm up: first touch of fresh memory, driver side allocations
+	if (uploadQueue) vkQueueWaitIdle(uploadQueue->queue);
+
+	uint64_t ops = 0;
+	auto start = std::chrono::steady_clock::now();
+	double elapsedSeconds = 0.0;
+	do {
+		op();
+		ops++;
+		elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsedSeconds < config.minSeconds || ops < UPLOAD_MIN_OPS);
+	if (uploadQueue) vkQueueWaitIdle(uploadQueue->queue);
+	elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	UploadResult result;
+	result.strategy = strategy;
+	result.queue = uploadQueue ? uploadQueue->name : "-";
+	result.size = size;
+	result.depth = depth;
+	result.uploads = ops * depth;
+	result.bytesPerSecond = static_cast<double>(size) * result.uploads / elapsedSeconds;
+	result.usPerUpload = elapsedSeconds * 1e6 / result.uploads;
+	results.push_back(result);
+
+	printf("%-16s %-9s %10s %6u %12.1f %14.2f\n", strategy.c_str(), result.queue.c_str(), formatSize(size).c_str(), depth,
+		result.bytesPerSecond / (1024.0 * 1024.0), result.usPerUpload);
+}
+
+// -- STRATEGIES ---------------------------------------------------------------------------
+
+// Staging buffer created, filled, copied with copyBuffer() (1 submission + queue wait) and destroyed per upload
+void benchmarkCopyBuffer(const UploadQueue& uploadQueue, VkDeviceSize size) {
+	measure("copyBuffer", &uploadQueue, size, 1, [&]() {
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(physicalDevice, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, size, 0, &data);
+		memcpy(data, sourceData.data(), static_cast<size_t>(size));
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		copyBuffer(device, uploadQueue.queue, uploadQueue.commandPool, stagingBuffer, destinationBuffer, size);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		MemoryTracker::freeMemory(device, stagingBufferMemory);
+	});
+}
+
+// Same as copyBuffer into a square RGBA8 image of the same byte size, the texture path
+void benchmarkCopyImageBuffer(const UploadQueue& uploadQueue, VkDeviceSize size) {
+	uint32_t side = static_cast<uint32_t>(std::sqrt(static_cast<double>(size / 4)));
+	if (side * side * 4 != size || side > deviceProperties.limits.maxImageDimension2D) return;
+
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.extent = { side, side, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkImage image;
+	if (vkCreateImage(device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create an Image!");
+	}
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+	VkMemoryAllocateInfo memoryAllocInfo = {};
+	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocInfo.allocationSize = memoryRequirements.size;
+	memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	VkDeviceMemory imageMemory;
+	if (MemoryTracker::allocateMemory(device, memoryAllocInfo, MEMORY_CATEGORY_TEXTURES, &imageMemory) != VK_SUCCESS) {
+		vkDestroyImage(device, image, nullptr);
+		printf("%-16s %-9s %10s: image memory allocation failed, skipped\n", "copyImageBuffer", uploadQueue.name.c_str(), formatSize(size).c_str());
+		return;
+	}
+	vkBindImageMemory(device, image, imageMemory, 0);
+	transitionImageLayout(device, uploadQueue.queue, uploadQueue.commandPool, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+	measure("copyImageBuffer", &uploadQueue, size, 1, [&]() {
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		createBuffer(physicalDevice, device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory, MEMORY_CATEGORY_STAGING);
+
+		void* data;
+		vkMapMemory(device, stagingBufferMemory, 0, size, 0, &data);
+		memcpy(data, sourceData.data(), static_cast<size_t>(size));
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		copyImageBuffer(device, uploadQueue.queue, uploadQueue.commandPool, stagingBuffer, image, side, side);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		MemoryTracker::freeMemory(device, stagingBufferMemory);
+	});
+
+	vkDestroyImage(device, image, nullptr);
+	MemoryTracker::freeMemory(device, imageMemory);
+}
+
+// depth uploads written to StagingUploader regions, then 1 flush() (1 submission + queue wait, staging blocks released)
+void benchmarkStagingUploader(const UploadQueue& uploadQueue, VkDeviceSize size, uint32_t depth) {
+	StagingUploader uploader(physicalDevice, device, uploadQueue.queue, uploadQueue.commandPool);
+	measure("StagingUploader", &uploadQueue, size, depth, [&]() {
+		for (uint32_t i = 0; i < depth; i++) {
+			StagingRegion region = uploader.allocate(size);
+			memcpy(region.data, sourceData.data(), static_cast<size_t>(size));
+			uploader.copyToBuffer(region, destinationBuffer, i * size);
+		}
+		uploader.flush();
+	});
+}
+
+void createStagingRing(const UploadQueue& uploadQueue, StagingRing& ring) {
+	// First host visible + coherent type, the ring is only ever written by the CPU and read by the transfer
+	createBuffer(physicalDevice, device, UPLOAD_RING_SLOT_SIZE * UPLOAD_RING_SLOTS, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ring.buffer, &ring.memory, MEMORY_CATEGORY_STAGING);
+	void* data;
+	vkMapMemory(device, ring.memory, 0, UPLOAD_RING_SLOT_SIZE * UPLOAD_RING_SLOTS, 0, &data);
+	ring.mapped = static_cast<uint8_t*>(data);
+	ring.currentSlot = 0;
+
+	for (StagingRing::Slot& slot : ring.slots) {
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = uploadQueue.commandPool;
+		allocInfo.commandBufferCount = 1;
+		vkAllocateCommandBuffers(device, &allocInfo, &slot.commandBuffer);
+
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;		// Free to use straight away
+		vkCreateFence(device, &fenceCreateInfo, nullptr, &slot.fence);
+		slot.used = 0;
+		slot.recording = false;
+	}
+}
+
+void destroyStagingRing(const UploadQueue& uploadQueue, StagingRing& ring) {
+	vkQueueWaitIdle(uploadQueue.queue);
+	for (StagingRing::Slot& slot : ring.slots) {
+		vkDestroyFence(device, slot.fence, nullptr);
+		vkFreeCommandBuffers(device, uploadQueue.commandPool, 1, &slot.commandBuffer);
+	}
+	vkUnmapMemory(device, ring.memory);
+	vkDestroyBuffer(device, ring.buffer, nullptr);
+	MemoryTracker::freeMemory(device, ring.memory);
+}
+
+// Submit the current slot without waiting for it, move on to the next one
+void submitRingSlot(const UploadQueue& uploadQueue, StagingRing& ring) {
+	StagingRing::Slot& slot = ring.slots[ring.currentSlot];
+	if (!slot.recording) return;
+
+	vkEndCommandBuffer(slot.commandBuffer);
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &slot.commandBuffer;
+	vkQueueSubmit(uploadQueue.queue, 1, &submitInfo, slot.fence);
+
+	slot.recording = false;
+	ring.currentSlot = (ring.currentSlot + 1) % UPLOAD_RING_SLOTS;
+}
+
+// Uploads bigger than a slot are split over several slots
+void ringUpload(const UploadQueue& uploadQueue, StagingRing& ring, VkDeviceSize dstOffset, VkDeviceSize size) {
+	VkDeviceSize done = 0;
+	while (done < size) {
+		StagingRing::Slot& slot = ring.slots[ring.currentSlot];
+		if (!slot.recording) {
+			// Only blocks when the GPU is a whole ring behind
+			vkWaitForFences(device, 1, &slot.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			vkResetFences(device, 1, &slot.fence);
+			vkResetCommandBuffer(slot.commandBuffer, 0);
+
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(slot.commandBuffer, &beginInfo);
+			slot.used = 0;
+			slot.recording = true;
+		}
+
+		VkDeviceSize chunk = std::min(size - done, UPLOAD_RING_SLOT_SIZE - slot.used);
+		VkDeviceSize ringOffset = ring.currentSlot * UPLOAD_RING_SLOT_SIZE + slot.used;
+		memcpy(ring.mapped + ringOffset, sourceData.data() + done, static_cast<size_t>(chunk));
+
+		VkBufferCopy copyRegion = {};
+		copyRegion.srcOffset = ringOffset;
+		copyRegion.dstOffset = dstOffset + done;
+		copyRegion.size = chunk;
+		vkCmdCopyBuffer(slot.commandBuffer, ring.buffer, destinationBuffer, 1, &copyRegion);
+
+		slot.used = (slot.used + chunk + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		done += chunk;
+		if (slot.used >= UPLOAD_RING_SLOT_SIZE) {
+			submitRingSlot(uploadQueue, ring);
+		}
+	}
+}
+
+// depth uploads through the ring, then the partly filled slot is submitted. Nothing waits for the copies to finish
+void benchmarkStagingRing(const UploadQueue& uploadQueue, StagingRing& ring, VkDeviceSize size, uint32_t depth) {
+	measure("staging ring", &uploadQueue, size, depth, [&]() {
+		for (uint32_t i = 0; i < depth; i++) {
+			ringUpload(uploadQueue, ring, i * size, size);
+		}
+		submitRingSlot(uploadQueue, ring);
+	});
+}
+
+// memcpy straight into mapped device local memory (resizable BAR, integrated GPUs), no copy on the GPU at all
+void benchmarkDirectWrite(VkDeviceSize size, uint32_t depth) {
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory;
+	try {
+		createBuffer(physicalDevice, device, size * depth, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&buffer, &memory, MEMORY_CATEGORY_GEOMETRY);
+	}
+	catch (const std::runtime_error&) {
+		// Without resizable BAR the host visible part of VRAM is usually 256 MiB, shared with the driver
+		printf("%-16s %-9s %10s %6u: allocation failed, skipped\n", "direct write", "-", formatSize(size).c_str(), depth);
+		vkDestroyBuffer(device, buffer, nullptr);		// createBuffer() creates the buffer before the memory type lookup / allocation that threw
+		return;
+	}
+	void* data;
+	vkMapMemory(device, memory, 0, size * depth, 0, &data);
+	uint8_t* mapped = static_cast<uint8_t*>(data);
+
+	measure("direct write", nullptr, size, depth, [&]() {
+		for (uint32_t i = 0; i < depth; i++) {
+			memcpy(mapped + i * size, sourceData.data(), static_cast<size_t>(size));
+		}
+	});
+
+	vkUnmapMemory(device, memory);
+	vkDestroyBuffer(device, buffer, nullptr);
+	MemoryTracker::freeMemory(device, memory);
+}
+
+// -- RESULTS ------------------------------------------------------------------------------
+
+void writeResults() {
+	std::ofstream file(config.outputFile, std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open " + config.outputFile + " for writing!");
+	}
+
+	file << "{\n";
+	file << "  \"device\": \"" << escapeJson(deviceProperties.deviceName) << "\",\n";
+	file << "  \"queues\": [";
+	for (size_t i = 0; i < queues.size(); i++) {
+		file << (i == 0 ? "" : ", ") << "{ \"name\": \"" << queues[i].name << "\", \"family\": " << queues[i].familyIndex << " }";
+	}
+	file << "],\n";
+	file << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		char line[320];
+		snprintf(line, sizeof(line), "    { \"strategy\": \"%s\", \"queue\": \"%s\", \"size\": %llu, \"depth\": %u, \"uploads\": %llu, \"mib_per_second\": %.1f, \"us_per_upload\": %.2f }%s\n",
+			results[i].strategy.c_str(), results[i].queue.c_str(), static_cast<unsigned long long>(results[i].size), results[i].depth,
+			static_cast<unsigned long long>(results[i].uploads), results[i].bytesPerSecond / (1024.0 * 1024.0), results[i].usPerUpload,
+			i + 1 < results.size() ? "," : "");
+		file << line;
+	}
+	file << "  ]\n}\n";
+	file.close();
+
+	printf("Upload benchmark: %zu results written to %s\n", results.size(), config.outputFile.c_str());
+}
+
+int main(int argc, char** argv) {
+	config = parseArguments(argc, argv);
+
+	try {
+		createDevice();
+		printf("Upload benchmark on %s, queues:", deviceProperties.deviceName);
+		for (const UploadQueue& uploadQueue : queues) printf(" %s (family %u)", uploadQueue.name.c_str(), uploadQueue.familyIndex);
+		printf("\n%-16s %-9s %10s %6s %12s %14s\n", "strategy", "queue", "size", "depth", "MiB/s", "us/upload");
+
+		sourceData.resize(static_cast<size_t>(config.maxSize));
+		for (size_t i = 0; i < sourceData.size(); i++) sourceData[i] = static_cast<uint8_t>(i * 31);
+
+		createBuffer(physicalDevice, device, UPLOAD_MAX_BATCH_BYTES, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &destinationBuffer, &destinationMemory, MEMORY_CATEGORY_GEOMETRY);
+
+		for (const UploadQueue& uploadQueue : queues) {
+			StagingRing ring;
+			createStagingRing(uploadQueue, ring);
+
+			for (VkDeviceSize size = UPLOAD_MIN_SIZE; size <= config.maxSize; size *= 4) {
+				if (isSelected("copyBuffer")) benchmarkCopyBuffer(uploadQueue, size);
+				if (isSelected("copyImageBuffer")) benchmarkCopyImageBuffer(uploadQueue, size);
+				for (uint32_t depth : UPLOAD_BATCH_DEPTHS) {
+					if (size * depth > UPLOAD_MAX_BATCH_BYTES) continue;
+					if (isSelected("StagingUploader")) benchmarkStagingUploader(uploadQueue, size, depth);
+					if (isSelected("staging ring")) benchmarkStagingRing(uploadQueue, ring, size, depth);
+				}
+			}
+
+			destroyStagingRing(uploadQueue, ring);
+		}
+
+		// Host visible device local memory, no queue involved
+		if (isSelected("direct write")) {
+			if (hasMemoryType(physicalDevice, ~0u, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+				for (VkDeviceSize size = UPLOAD_MIN_SIZE; size <= config.maxSize; size *= 4) {
+					for (uint32_t depth : UPLOAD_BATCH_DEPTHS) {
+						if (size * depth > UPLOAD_MAX_BATCH_BYTES) continue;
+						benchmarkDirectWrite(size, depth);
+					}
+				}
+			}
+			else {
+				printf("No host visible device local memory type, direct writes skipped\n");
+			}
+		}
+
+		vkDestroyBuffer(device, destinationBuffer, nullptr);
+		MemoryTracker::freeMemory(device, destinationMemory);
+		writeResults();
+		destroyDevice();
+	}
+	catch (const std::runtime_error& e) {
+		printf("Upload benchmark ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return 0;
+}
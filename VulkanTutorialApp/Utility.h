@@ -1,13 +1,91 @@
 #pragma once
 #include <fstream>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include "MemoryTracker.h"
 
-const int MAX_FRAME_DRAWS = 2; // this number should be less than or equal to the number of swapchain images
+const int MAX_FRAME_DRAWS = 3; // upper bound of frames in flight (throughput profile), the count in use is picked at runtime by the latency profile
 const int MAX_OBJECTS = 256;
 
+// Level of Detail
+const int MAX_LOD_LEVELS = 5;						// LOD 0 (full resolution) + up to 4 simplified levels
+const size_t LOD_MIN_INDEX_COUNT = 3 * 64;			// Meshes with fewer triangles than this only keep LOD 0
+const float LOD_PIXEL_ERROR_THRESHOLD = 1.0f;		// Max projected geometric error (in pixels) allowed for the chosen level
+const float LOD_HYSTERESIS = 0.75f;					// A coarser level has to be this far below the threshold before switching to it, avoids popping back and forth
+
+// Meshlets
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+const uint32_t MESHLET_CULL_GROUP_SIZE = 64;			// Must match local_size_x in meshlet_cull.comp
+const VkDeviceSize CULL_OUTPUT_HEADER_SIZE = 32;		// VkDrawIndexedIndirectCommand padded to 32 bytes, the culled indices follow it
+const uint32_t MAX_CULLED_MESHES = 1024;				// Size of the meshlet culling descriptor pool (1 set per mesh)
+
+// Subpasses of the render pass. The depth pre-pass is always there, it is just empty while the pre-pass is off, so turning it on or off
+// doesn't touch the render pass or the framebuffers. Profiler zones keep their names: "Subpass 0" = color, "Subpass 1" = composite
+const uint32_t SUBPASS_DEPTH_PREPASS = 0;
+const uint32_t SUBPASS_COLOR = 1;
+const uint32_t SUBPASS_COMPOSITE = 2;
+
+// Shaders, GLSL sources are compiled at startup and the SPIR-V is cached in SHADER_CACHE_DIRECTORY
+const char* const SHADER_SOURCE_DIRECTORY = "shaders";
+const char* const SHADER_CACHE_DIRECTORY = "shaders/cache";
+
+// Latency measurement, the averages are printed once per this many frames
+const uint32_t LATENCY_REPORT_INTERVAL = 300;
+
+// GPU profiler
+const uint32_t GPU_PROFILER_MAX_QUERIES = 512;			// Timestamps per frame in flight (2 per zone)
+const size_t GPU_PROFILER_HISTORY = 256;				// Frames kept per zone for min / avg / p99
+const size_t GPU_PROFILER_TRACE_EVENTS = 65536;			// Zones kept for the Chrome trace
+const char* const GPU_TRACE_FILE = "gpu_trace.json";
+const uint32_t GPU_PROFILER_MAX_STATISTICS = 4;			// Pipeline statistics scopes per frame in flight
+// Counters are returned in bit order: IA vertices, IA primitives, VS invocations, clipping primitives, FS invocations
+const VkQueryPipelineStatisticFlags GPU_PROFILER_STATISTICS_FLAGS =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+const uint32_t GPU_PROFILER_STATISTICS_COUNT = 5;
+
+// CPU profiler (zones compiled in with ENABLE_CPU_PROFILER)
+const size_t CPU_PROFILER_RING_SIZE = 65536;			// Zones kept per thread
+const char* const CPU_TRACE_FILE = "cpu_trace.json";
+const char* const CPU_FOLDED_FILE = "cpu_stacks.folded";
+
+// Pipeline cache blob, relative to the working directory
+const char* const PIPELINE_CACHE_FILE = "pipeline_cache.bin";
+
+// Staging uploads
+const VkDeviceSize STAGING_BLOCK_SIZE = 64 * 1024 * 1024;	// Staging memory is sub-allocated from blocks of this size (bigger requests get their own block)
+const VkDeviceSize STAGING_ALIGNMENT = 16;					// Alignment of every staging region
+
+// Asynchronous imports, see VulkanRenderer::addNCreateImportMeshAsync()
+const double IMPORT_FRAME_BUDGET_MS = 2.0;					// Render thread time per frame spent turning loaded imports into GPU resources
+const size_t MESH_BATCH_MAX_VERTICES = 65536;				// ImportOptions::batchByTexture starts a new batch past this, the LOD chain of a batch gets slow to build beyond it
+const char* const DEFAULT_TEXTURE_FILE = "white.jpg";		// Texture 0, materials without texture. Packed imports get it as a layer / atlas rect instead
+const uint32_t TEXTURE_ATLAS_GUTTER = 4;					// ImportOptions::packTextures: edge pixels repeated around an atlas texture
+const float TEXTURE_ATLAS_MAX_ANISOTROPY = 4.0f;			// Anisotropy of the packed array sampler: taps reach half of it + 1 bilinear texel past a border, inside the gutter.
+															// No mips, so past 4:1 minification samples can still land in a neighbouring texture
+
+// Job system
+const size_t JOB_CHUNKS_PER_THREAD = 4;					// JobSystem::parallelFor() splits into at most this many chunks per thread, enough for stealing to even out uneven chunks
+const size_t LOD_SELECTION_GRAIN_SIZE = 64;				// Import meshes per LOD selection job, fewer than this are picked on the render thread
+const size_t PACK_MODELS_GRAIN_SIZE = 4096;				// Model matrices per ImportMesh::PackModels() job, a copy of 64 bytes is too cheap for smaller chunks
+
+// Hot reload, see VulkanRenderer::setHotReload()
+const double HOT_RELOAD_POLL_INTERVAL_MS = 250.0;			// Time between 2 scans of the watched files' modification times
+
+// Memory tracking, a warning is printed when an allocation takes a heap past this fraction of its budget
+const double MEMORY_BUDGET_WARNING_RATIO = 0.9;
+
 const std::vector<const char*> deviceExtensionsNeeded = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME  //"VK_KHR_swapchain"
 };
@@ -23,9 +101,14 @@ struct Model {
 	glm::mat4 model;
 };
 
-// Push Constants
-struct PushConstBlock {
-	glm::vec3 pushConstData;
+// Push constants of the subpass 0 pipeline, set per draw
+struct DrawPushConst {
+	uint32_t textureLayer;		// Layer of the bound texture array, 0 unless the model's textures are packed
+};
+
+// Push constants of the composite pipeline, set once per frame
+struct CompositePushConst {
+	float framebufferWidth;		// Turns splitFraction into pixels without baking the width into the pipeline
 };
 
 //vertes data representation
@@ -35,6 +118,125 @@ struct Vertex {
 	glm::vec2 uv;		// texture coord
 };
 
+// One level of detail of a mesh, a range inside the mesh's index buffer
+struct MeshLod {
+	uint32_t firstIndex;		// First index of this level in the index buffer
+	uint32_t indexCount;		// Number of indices of this level
+	float error;				// Geometric error (object space distance) introduced by the simplification
+};
+
+// A cluster of at most MESHLET_MAX_VERTICES vertices / MESHLET_MAX_TRIANGLES triangles, layout matches the Meshlet struct in meshlet_cull.comp (std430)
+struct Meshlet {
+	glm::vec4 sphere;			// xyz: object space center, w: radius
+	glm::vec4 cone;				// xyz: normal cone axis, w: cutoff (sine of the cone half angle), 1 = never back facing
+	uint32_t firstIndex;		// First index of the meshlet in the LOD 0 index range
+	uint32_t indexCount;
+	uint32_t padding[2];
+};
+
+// Push constants of the meshlet culling pass, everything in the object space of the mesh being culled
+struct MeshletCullPushConst {
+	glm::vec4 frustumPlanes[6];		// Normalized planes (left, right, bottom, top, near, far), inside is dot(plane.xyz, p) + plane.w >= 0
+	glm::vec4 cameraPosition;
+	uint32_t meshletCount;
+	uint32_t padding[3];
+};
+
+// Views of the subpass 1 composite, value of the DEBUG_VIEW_MODE specialization constant in subpass1.frag
+enum DebugViewMode : int32_t {
+	DEBUG_VIEW_COLOUR = 0,		// Colour only, no per fragment branch
+	DEBUG_VIEW_SPLIT = 1,		// Colour left of splitFraction, depth right of it
+	DEBUG_VIEW_DEPTH = 2		// Depth only
+};
+
+// Specialization constants of subpass1.frag, in constant_id order
+struct CompositeSpecialization {
+	int32_t debugViewMode;
+	float splitFraction;		// Screen split as a fraction of the framebuffer width, so a resize keeps the same variant
+	float depthLowerBound;		// Depth range stretched to black..white in the depth view
+	float depthUpperBound;
+};
+
+// A composite pipeline built for one set of specialization constants
+struct CompositeVariant {
+	CompositeSpecialization specialization;
+	VkPipeline pipeline;
+};
+
+// Trade off between input latency and GPU throughput, picked before VulkanRenderer::init(). The default is a fixed choice (the
+// 2 frames + MAILBOX the renderer always used), not derived from a measurement: compare the profiles with the printed LatencyStats
+enum LatencyProfile {
+	LATENCY_PROFILE_DEFAULT,		// 2 frames in flight, MAILBOX when available else FIFO
+	LATENCY_PROFILE_LOW_LATENCY,	// 1 frame in flight, FIFO, the CPU waits for the last frame before sampling input
+	LATENCY_PROFILE_THROUGHPUT		// 3 frames in flight, MAILBOX, else IMMEDIATE, else FIFO
+};
+
+// Accumulated latencies (milliseconds) since the last report
+struct LatencyStats {
+	double inputToSubmitSum = 0.0;		// Input sampled -> vkQueueSubmit
+	double submitToPresentSum = 0.0;	// vkQueueSubmit -> frame fence seen signalled. A proxy: the fence signals when rendering is done, the present itself isn't timed
+	double inputToSubmitMax = 0.0;
+	double submitToPresentMax = 0.0;
+	uint32_t inputToSubmitCount = 0;
+	uint32_t submitToPresentCount = 0;
+};
+
+// Everything one frame in flight writes to, reused once its fence signals
+struct FrameContext {
+	VkCommandPool commandPool;					// Transient pool, reset as a whole with vkResetCommandPool at the start of the frame
+	VkCommandBuffer commandBuffer;
+	VkSemaphore imageAvailable;					// Signalled by vkAcquireNextImageKHR
+	VkSemaphore finishRender;					// Signalled by the submit, waited on by the present
+	VkFence drawFence;							// Signalled when the frame's submit finished on the GPU
+	VkBuffer vpUniformBuffer;					// View projection uniform of this frame
+	VkDeviceMemory vpUniformBufferMemory;
+	VkBuffer mUniformBufferDynamic;				// Model dynamic uniform of this frame
+	VkDeviceMemory mUniformBufferMemory;
+	VkDescriptorSet descriptorSet;				// Points at this frame's uniform buffers
+	std::chrono::steady_clock::time_point submitTime;		// Last vkQueueSubmit, for the latency measurement
+	bool submitPending;										// Submit time not measured yet
+};
+
+// A resource replaced while the frames in flight may still use it (hot reload), destroyed once they are done with it
+struct RetiredResource {
+	uint64_t retiredAtFrame;					// Frames submitted when it was replaced
+	std::function<void()> destroy;
+};
+
+// Progress of an asynchronous import
+enum ImportState {
+	IMPORT_STATE_LOADING,				// Parsing, decoding and converting in a loader job
+	IMPORT_STATE_UPLOADING,				// Textures being created, copies submitted, waiting for their fence
+	IMPORT_STATE_READY,					// In importMeshList, drawn from this frame on
+	IMPORT_STATE_FAILED
+};
+typedef uint32_t ImportHandle;
+
+struct ImportStatus {
+	ImportState state;
+	int modelId;						// Index in importMeshList (for updateModel()) once READY, -1 before
+};
+
+// How models are imported, see VulkanRenderer::setImportOptions()
+struct ImportOptions {
+	bool batchByTexture = false;		// Sub-meshes sharing a texture are merged into 1 mesh (1 draw), their meshlets keep the culling per sub-mesh
+	bool packTextures = false;			// Every texture of the model in 1 texture array (atlas layers for the smaller ones), 1 sampler binding per model.
+										// Atlas UVs are clamped to [0, 1], textures repeated over a mesh need their own layer
+};
+
+// Source files watched for hot reload, see AssetWatcher
+enum AssetKind {
+	ASSET_KIND_MESH,					// ../ImportObj/ (see getMeshFilePath()), every import mesh made from it is re-imported
+	ASSET_KIND_TEXTURE,					// ../Textures/, new image swapped into the texture's sampler descriptor set slot
+	ASSET_KIND_SHADER					// SHADER_SOURCE_DIRECTORY, the pipelines using it are rebuilt
+};
+
+// Object space bounds of a mesh
+struct BoundingSphere {
+	glm::vec3 center;
+	float radius;
+};
+
 // Indices (locations) of Queue Families (if they exist at all)
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;			// Location of Graphics Queue Family
@@ -58,6 +260,35 @@ struct SwapChainImage {
 	VkImageView imageView;		//create imageview by setup interpretation of image
 };
 
+// Nearest rank percentile (0..100) of an ascending sorted, non empty list
+static double percentileOfSorted(const std::vector<double>& sorted, double percent)
+{
+	size_t index = static_cast<size_t>((sorted.size() * percent) / 100.0);
+	return sorted[std::min(sorted.size() - 1, index)];
+}
+
+// Escape a string to be written inside a JSON string literal
+static std::string escapeJson(const std::string& text)
+{
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\') { escaped += '\\'; escaped += c; }
+		else if (static_cast<unsigned char>(c) < 0x20) escaped += ' ';
+		else escaped += c;
+	}
+	return escaped;
+}
+
+// Mesh files are looked up in ../ImportObj/, unless the name is already an absolute path (e.g. a file generated in the temp directory)
+static std::string getMeshFilePath(const std::string& meshFileName) {
+	if (std::filesystem::path(meshFileName).is_absolute()) {
+		return meshFileName;
+	}
+	return "../ImportObj/" + meshFileName;
+}
+
 static std::vector<char> readFile(const std::string& filename) {
 	// open stream from given file
 	// std::ios::binary tells stream to read file as binary
@@ -86,11 +317,11 @@ static std::vector<char> readFile(const std::string& filename) {
 	return fileBuffer;
 }
 
+// Seconds since the last call, measured on the steady clock (glfwGetTime() as a float loses precision over long uptimes)
 static float getDeltaTime() {
-	static float deltaTime = 0.0f;
-	static float lastTime = 0.0f;
-	float now = glfwGetTime();
-	deltaTime = now - lastTime;
+	static std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	float deltaTime = std::chrono::duration<float>(now - lastTime).count();		// The difference is taken in integer ticks, only the result is a float
 	lastTime = now;
 	return deltaTime;
 }
@@ -113,6 +344,22 @@ static uint32_t findMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
 	}
 }
 
+// Same search as findMemoryTypeIndex() without picking the type, to check if optional property flags can be used
+static bool hasMemoryType(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 static VkCommandBuffer beginCommandBuffer(VkDevice device, VkCommandPool commandPool)
 {
 	// Command buffer to hold transfer commands
@@ -160,7 +407,7 @@ static void endAndSubmitCommandBuffer(VkDevice device, VkCommandPool commandPool
 
 static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, 
 	VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags bufferProperties, VkBuffer* outBuffer, 
-	VkDeviceMemory* outBufferMemory)
+	VkDeviceMemory* outBufferMemory, MemoryCategory category)
 {	// 1) Create buffer 2) allocate memory 3) and bind buffer & memory
 
 	// CREATE VERTEX BUFFER
@@ -189,7 +436,7 @@ static void createBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDev
 		bufferProperties);																						// VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT	: CPU can interact with memory
 																												// VK_MEMORY_PROPERTY_HOST_COHERENT_BIT	: Allows placement of data straight into buffer after mapping (otherwise would have to specify manually)
 																												// Allocate memory to VkDeviceMemory
-	result = vkAllocateMemory(device, &memoryAllocInfo, nullptr, outBufferMemory);
+	result = MemoryTracker::allocateMemory(device, memoryAllocInfo, category, outBufferMemory);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to allocate Vertex Buffer Memory!");
@@ -245,12 +492,9 @@ static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPoo
 	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, 
-	VkImageLayout oldLayout, VkImageLayout newLayout)
+// Records the layout transition barrier into a command buffer being recorded, see transitionImageLayout() for the supported transitions
+static void recordImageLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
 {
-	// Create buffer
-	VkCommandBuffer commandBuffer = beginCommandBuffer(device, commandPool);
-
 	VkImageMemoryBarrier imageMemoryBarrier = {};
 	imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	imageMemoryBarrier.oldLayout = oldLayout;									// Layout to transition from
@@ -262,7 +506,7 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
 	imageMemoryBarrier.subresourceRange.baseMipLevel = 0;						// First mip level to start alterations on
 	imageMemoryBarrier.subresourceRange.levelCount = 1;							// Number of mip levels to alter starting from baseMipLevel
 	imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;						// First layer to start alterations on
-	imageMemoryBarrier.subresourceRange.layerCount = 1;							// Number of layers to alter starting from baseArrayLayer
+	imageMemoryBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;	// Number of layers to alter starting from baseArrayLayer (all of a texture array)
 
 	VkPipelineStageFlags srcStage;
 	VkPipelineStageFlags dstStage;
@@ -294,6 +538,15 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
 		0, nullptr,				// Buffer Memory Barrier count + data
 		1, &imageMemoryBarrier	// Image Memory Barrier count + data
 	);
+}
+
+static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image, 
+	VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+	// Create buffer
+	VkCommandBuffer commandBuffer = beginCommandBuffer(device, commandPool);
+
+	recordImageLayoutTransition(commandBuffer, image, oldLayout, newLayout);
 
 	endAndSubmitCommandBuffer(device, commandPool, queue, commandBuffer);
 }
\ No newline at end of file
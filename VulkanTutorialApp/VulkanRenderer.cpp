@@ -12,22 +12,31 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 {
 	window = newWindow;
 
+	// Resize notification, the swapchain is recreated on the next draw()
+	glfwSetWindowUserPointer(window, this);
+	glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+
 	try {
 		createInstance();
+		DebugUtils::load(instance, debugUtilsEnabled);	// Object names and labels, no-ops without VK_EXT_debug_utils
 		setupDebugMessenger();	
 		createSuface();							// create surface 
 		getPhysicalDevice();		
 		createLogicalDevice();					// this will call getQueueFamily(), need instantce, physical device, and surface before we can get & check support of queuefamily 
+		MemoryTracker::init(instance, mainDevice.physicalDevice, memoryBudgetEnabled);	// Before the first allocation
 		createSwapChain();
 		createRenderPass();
 		createDescriptorSetLayout();
-		createPushConstantRange();
+		compileShaders();
+		createPipelineCache();
 		createGraphicsPipeline();
+		createMeshletCullPipeline();
+		createCommandPool();
+		createFrameContexts();					// Before the attachments, they are created per frame in flight
+		createGpuProfiler();
 		createDepthBufferImage();
 		createColorBufferImage();
 		createFramebuffer();
-		createCommandPool();
-		allocateCommandBuffers();
 		createTextureSampler();
 		allocateDynamicBufferTransferSpace();	// Compute dynamic uniform buffer alignment
 		createUniformBuffers();
@@ -35,8 +44,8 @@ int VulkanRenderer::init(GLFWwindow* newWindow)
 		allocateDescriptorSets();
 		allocateSubpassInputDescriptorSets();
 		//recordCommands();						// This one is removed because it is called in the draw(). [Note]: Record command every frame deosn't lead to a lot of overhead actually
-		createSynchronization();
 			createTestMesh();
+		importLoader.start(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool);	// Async imports copy on the graphics queue, submitted from draw()
 	}
 	catch (const std::runtime_error& e) {
 		printf("Vulkan Infrastructure ERROR: %s\n", e.what());
@@ -80,14 +89,46 @@ void VulkanRenderer::addTextureFileName(const std::string& fileName)
 
 void VulkanRenderer::cleanup() // whenever vkCreate#() is called, has to call vkDestroy#()
 {	
+	// No more async imports or file scans, the ones running are finished first
+	importLoader.stop();
+	assetWatcher.stop();
+
 	// CPU will not proceed until all commands are executed and nothing is pending in the queue
 	vkDeviceWaitIdle(mainDevice.logicalDevice); //or to use vkQueueWaitIdle();
 
+	// Drop the async imports that never became resident (their textures are already in the texture lists)
+	for (auto& import : importLoader.takeLoaded())
+	{
+		uploadingImports.push_back(std::move(import));
+	}
+	for (auto& import : uploadingImports)
+	{
+		for (Mesh& mesh : import->meshes)
+		{
+			mesh.destroyBuffers();
+		}
+	}
+	uploadingImports.clear();				// The uploaders release their staging memory and command buffers, before the pool goes
+
+	// Hot reloads not swapped in yet, then everything replaced by the ones that were
+	importLoader.takeReloadedTextures();
+	for (auto& reload : uploadingTextureReloads)
+	{
+		vkDestroyImage(mainDevice.logicalDevice, reload->image, nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, reload->imageMemory);
+	}
+	uploadingTextureReloads.clear();
+	freeRetiredResources(true);
+
 	// Destroy Import Mesh
 	for (size_t i = 0; i < importMeshList.size(); i++) {
 		importMeshList[i].destroyImportMesh();
 	}
 
+	// Destroy Meshlet Culling Descriptor Pool + Layout (descriptor sets are freed with the pool)
+	vkDestroyDescriptorPool(mainDevice.logicalDevice, meshletCullDescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, meshletCullSetLayout, nullptr);
+
 	// Destroy Subpass Input Descriptor Pool
 	vkDestroyDescriptorPool(mainDevice.logicalDevice, subpassInputDescriptorPool, nullptr);
 	// Destroy Subpass Input Descriptor Set Layout
@@ -99,25 +140,16 @@ void VulkanRenderer::cleanup() // whenever vkCreate#() is called, has to call vk
 	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, samplerDescriptorSetLayout, nullptr);
 	// Destroy Sampler (texture)
 	vkDestroySampler(mainDevice.logicalDevice, textureSampler, nullptr);
+	vkDestroySampler(mainDevice.logicalDevice, packedTextureSampler, nullptr);
 	
 	// Destroy images, image views, and image memory (texture)
 	for (size_t i = 0; i < textureImages.size(); i++) {
 		vkDestroyImageView(mainDevice.logicalDevice, textureImageViews[i], nullptr);
 		vkDestroyImage(mainDevice.logicalDevice, textureImages[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, textureImageMemory[i], nullptr);
-	}
-	// Destroy images, image views, and image memory (depth buffer)
-	for (size_t i = 0; i < depthBufferImage.size(); i++) {
-		vkDestroyImageView(mainDevice.logicalDevice, depthBufferImageView[i], nullptr);
-		vkDestroyImage(mainDevice.logicalDevice, depthBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, depthBufferImageMemory[i], nullptr);
-	}
-	// Destroy color buffer
-	for (size_t i = 0; i < colorBufferImage.size(); i++) {
-		vkDestroyImageView(mainDevice.logicalDevice, colorBufferImageView[i], nullptr);
-		vkDestroyImage(mainDevice.logicalDevice, colorBufferImage[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, colorBufferImageMemory[i], nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, textureImageMemory[i]);
 	}
+	// Destroy framebuffers, depth + color buffers and swapchain image views
+	destroySwapChainResources();
 
 	// Free memory allocated for dynamic uniform buffer
 	_aligned_free(modelTransferSpace);
@@ -126,43 +158,37 @@ void VulkanRenderer::cleanup() // whenever vkCreate#() is called, has to call vk
 	// Destroy descriptor set layout (uniform)
 	vkDestroyDescriptorSetLayout(mainDevice.logicalDevice, descriptorSetLayout, nullptr);
 
-	// Destroy buffer and memory (view projection uniform, model dynamic uniform)
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-		vkDestroyBuffer(mainDevice.logicalDevice, vpUniformBuffer[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, vpUniformBufferMemory[i], nullptr);
-		vkDestroyBuffer(mainDevice.logicalDevice, mUniformBufferDynamic[i], nullptr);
-		vkFreeMemory(mainDevice.logicalDevice, mUniformBufferMemory[i], nullptr);
-	}
+	// Destroy frame contexts (uniform buffers, semaphores, fences, frame command pools)
+	destroyFrameContexts();
+
+	// GPU timings of the last frames, then the query pool
+	gpuProfiler.exportChromeTrace(GPU_TRACE_FILE);
+	gpuProfiler.destroyProfiler();
 
 	// May delete in future
 	for (size_t i = 0; i < meshList.size(); i++) {
 		meshList[i].destroyBuffers();
 	}
 
-	// Destroy semaphores, Fences
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++) {
-		vkDestroySemaphore(mainDevice.logicalDevice, semaphoreFinishRender[i], nullptr);
-		vkDestroySemaphore(mainDevice.logicalDevice, semaphoreImageAvailable[i], nullptr);
-		vkDestroyFence(mainDevice.logicalDevice, drawFences[i], nullptr);
-	}
-
 	// Destroy Command Pool, Command Buffer
 	vkDestroyCommandPool(mainDevice.logicalDevice, graphicsCommandPool, nullptr);
-	for (const VkFramebuffer& framebuffer : swapChainFramebuffers) {
-		vkDestroyFramebuffer(mainDevice.logicalDevice, framebuffer, nullptr);
-	}
 
 	// Destroy Pipeline, Pipeline layout, Render pass
 	vkDestroyPipeline(mainDevice.logicalDevice, graphicsPipeline, nullptr);
+	vkDestroyPipeline(mainDevice.logicalDevice, depthEqualGraphicsPipeline, nullptr);
+	vkDestroyPipeline(mainDevice.logicalDevice, depthPrepassPipeline, nullptr);
 	vkDestroyPipelineLayout(mainDevice.logicalDevice, pipelineLayout, nullptr);
-	vkDestroyPipeline(mainDevice.logicalDevice, subpass1GraphicsPipeline, nullptr);
+	for (const CompositeVariant& variant : compositeVariants) {
+		vkDestroyPipeline(mainDevice.logicalDevice, variant.pipeline, nullptr);
+	}
 	vkDestroyPipelineLayout(mainDevice.logicalDevice, subpass1PipelineLayout, nullptr);
+	vkDestroyPipeline(mainDevice.logicalDevice, meshletCullPipeline, nullptr);
+	vkDestroyPipelineLayout(mainDevice.logicalDevice, meshletCullPipelineLayout, nullptr);
+	pipelineCache.save();					// Write the cache back before it is destroyed, next launch starts warm
+	pipelineCache.destroyCache();
 	vkDestroyRenderPass(mainDevice.logicalDevice, renderPass, nullptr);
 	
-	// Destroy Swapchain Image view, swapchain
-	for (const SwapChainImage& image : swapChainImages) {
-		vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
-	}
+	// Destroy swapchain
 	vkDestroySwapchainKHR(mainDevice.logicalDevice, swapchain, nullptr);
 	
 	// Destroy Surface
@@ -171,17 +197,31 @@ void VulkanRenderer::cleanup() // whenever vkCreate#() is called, has to call vk
 	// Destroy Logical Device
 	vkDestroyDevice(mainDevice.logicalDevice, nullptr);
 
+	// Every allocation should be freed by now
+	MemorySnapshot memory = MemoryTracker::getSnapshot();
+	for (int c = 0; c < MEMORY_CATEGORY_COUNT; c++)
+	{
+		if (memory.categories[c].allocationCount > 0)
+		{
+			printf("Memory tracker: %u %s allocations never freed\n", memory.categories[c].allocationCount,
+				MemoryTracker::getCategoryName(static_cast<MemoryCategory>(c)));
+		}
+	}
+
 	// Destroy Debug Messenger
 	if (validationLayers.enableValidationLayers) {
 		DestoryDebugUtilsMessengerEXT(instance, debugMessenger, nullptr); //destroy messenger ext first, then instance
 	}
 
 	// Destroy Instance
+	DebugUtils::unload();
 	vkDestroyInstance(instance, nullptr);
 }
 
 void VulkanRenderer::draw()
 {
+	CPU_PROFILE_ZONE("draw");
+
 	// 3 stages
 	// 1. Get the next available image and draw to it, then set the signal when finish drawing (semaphore)
 	// 2. Submit command buffer to queue for excecution, make sure command wait for the image to be signalled as available before drawing, and signals when finish drawing
@@ -190,15 +230,50 @@ void VulkanRenderer::draw()
 	// -- GET NEXT IMAGE --
 	// program stop and wait, until drawFences[currentFrame] is signalled, ( wait for given fence to signal (open) from last draw before continuing
 	// drawFences[currentFrame] will be signalled by vkQueueSubmit()
-	vkWaitForFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-	// Manually reset/close fences
-	vkResetFences(mainDevice.logicalDevice, 1, &drawFences[currentFrame]);
+	waitForFrameSlot();			// No-op when main() already waited before sampling input
+
+	freeRetiredResources(false);	// Hot reloaded resources no frame in flight uses anymore
+	processAsyncImports();		// Loaded models become resident between frames, within importFrameBudgetMs
+	if (hotReloadEnabled)
+	{
+		processHotReload();
+	}
+
+	FrameContext& frame = frames[currentFrame];
 
 	// Get index of next image to be drawn to, and then signal semaphore when ready to be drawn to
 	uint32_t nextImageIndex;										//never timeout
-	vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(), semaphoreImageAvailable[currentFrame], VK_NULL_HANDLE, &nextImageIndex); //this extension call finds which one is the next image, and pass the index of that image in the swapchain
+	VkResult result;
+	{
+		CPU_PROFILE_ZONE("vkAcquireNextImageKHR");
+		result = vkAcquireNextImageKHR(mainDevice.logicalDevice, swapchain, std::numeric_limits<uint64_t>::max(), frame.imageAvailable, VK_NULL_HANDLE, &nextImageIndex); //this extension call finds which one is the next image, and pass the index of that image in the swapchain
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		// Swapchain no longer matches the surface, nothing can be drawn to it. Fence is still signalled so this frame slot can be reused straight away
+		recreateSwapChain();
+		return;
+	}
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)		// Suboptimal can still be presented, it is recreated after the present
+	{
+		throw std::runtime_error("Failed to acquire a Swapchain Image!");
+	}
+
+	// The image may still be read by another frame in flight (more images than frames, or images acquired out of order)
+	if (imagesInFlight[nextImageIndex] != VK_NULL_HANDLE)
+	{
+		CPU_PROFILE_ZONE("Image fence wait");
+		vkWaitForFences(mainDevice.logicalDevice, 1, &imagesInFlight[nextImageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	imagesInFlight[nextImageIndex] = frame.drawFence;
+
+	// Manually reset/close fences, only once it is certain this frame gets submitted
+	vkResetFences(mainDevice.logicalDevice, 1, &frame.drawFence);
 
-	updateUniformBuffers(nextImageIndex);		// Copy MVP matrix data to the uniform buffer
+	// The GPU is done with everything this frame recorded last time, reset all of its command buffers at once
+	vkResetCommandPool(mainDevice.logicalDevice, frame.commandPool, 0);
+
+	updateUniformBuffers(frame);				// Copy MVP matrix data to the uniform buffer
 	recordCommands(nextImageIndex);				// Record command every frame
 
 	// -- SUBMIT COMMAND BUFFER TO RENDER --
@@ -206,40 +281,217 @@ void VulkanRenderer::draw()
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.waitSemaphoreCount = 1;										// Number of semaphores to wait on
-	submitInfo.pWaitSemaphores = &semaphoreImageAvailable[currentFrame];	// List of semaphores to wait on
+	submitInfo.pWaitSemaphores = &frame.imageAvailable;					// List of semaphores to wait on
 	VkPipelineStageFlags waitStages[] = {
 		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
 	};
 	submitInfo.pWaitDstStageMask = waitStages;								// Stages to check semaphores at
 	submitInfo.commandBufferCount = 1;										// Number of command buffers to submit
-	submitInfo.pCommandBuffers = &commandBuffers[nextImageIndex];			// Command buffer to submit, the index here is the same index get from vkAcquireNextImageKHR()
+	submitInfo.pCommandBuffers = &frame.commandBuffer;						// Command buffer to submit, recorded for this frame in flight
 	submitInfo.signalSemaphoreCount = 1;									// Number of semaphores to signal
-	submitInfo.pSignalSemaphores = &semaphoreFinishRender[currentFrame];	// Semaphores to signal when command buffer finishes
+	submitInfo.pSignalSemaphores = &frame.finishRender;					// Semaphores to signal when command buffer finishes
 	// Submit command buffer to queue
-	VkResult result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, drawFences[currentFrame]);	// when finish drawing, signal the fence
+	{
+		CPU_PROFILE_ZONE("vkQueueSubmit");
+		result = vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.drawFence);	// when finish drawing, signal the fence
+	}
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to submit Command Buffer to Queue!");
 	}
+	submittedFrameCount++;
+
+	// Latency: input -> submit now, submit -> present when this slot's fence is seen signalled
+	frame.submitTime = std::chrono::steady_clock::now();
+	frame.submitPending = true;
+	double inputToSubmit = std::chrono::duration<double, std::milli>(frame.submitTime - inputSampleTime).count();
+	latencyStats.inputToSubmitSum += inputToSubmit;
+	latencyStats.inputToSubmitMax = std::max(latencyStats.inputToSubmitMax, inputToSubmit);
+	latencyStats.inputToSubmitCount++;
 
 	// -- PRESENT RENDERED IMAGE TO SCREEN --
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;										// Number of semaphores to wait on
-	presentInfo.pWaitSemaphores = &semaphoreFinishRender[currentFrame];		// Semaphores to wait on
+	presentInfo.pWaitSemaphores = &frame.finishRender;						// Semaphores to wait on
 	presentInfo.swapchainCount = 1;											// Number of swapchains to present to
 	presentInfo.pSwapchains = &swapchain;									// Swapchains to present images to
 	presentInfo.pImageIndices = &nextImageIndex;								// Index of images in swapchains to present
 
 	// Present image
-	result = vkQueuePresentKHR(presentationQueue, &presentInfo);
-	if (result != VK_SUCCESS)
+	{
+		CPU_PROFILE_ZONE("vkQueuePresentKHR");
+		result = vkQueuePresentKHR(presentationQueue, &presentInfo);
+	}
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized)
+	{
+		framebufferResized = false;
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to present Image!");
 	}
 
-	// Get next frame (use % MAX_FRAME_DRAWS to keep value below MAX_FRAME_DRAWS)
-	currentFrame = (currentFrame + 1) % MAX_FRAME_DRAWS;
+	// Get next frame (use % framesInFlight to keep value below framesInFlight)
+	currentFrame = (currentFrame + 1) % framesInFlight;
+
+	if (++latencyFrameCount >= LATENCY_REPORT_INTERVAL) reportLatency();
+}
+
+void VulkanRenderer::setLatencyProfile(LatencyProfile profile)
+{
+	if (!frames.empty())
+	{
+		throw std::runtime_error("Latency profile has to be set before init()!");
+	}
+	latencyProfile = profile;
+	switch (profile)
+	{
+	case LATENCY_PROFILE_LOW_LATENCY:	framesInFlight = 1; break;
+	case LATENCY_PROFILE_THROUGHPUT:	framesInFlight = MAX_FRAME_DRAWS; break;
+	default:							framesInFlight = 2; break;
+	}
+}
+
+void VulkanRenderer::waitForFrameSlot()
+{
+	CPU_PROFILE_ZONE("Frame fence wait");
+
+	// program stop and wait, until the frame's drawFence is signalled, ( wait for given fence to signal (open) from last draw before continuing
+	// the drawFence will be signalled by vkQueueSubmit()
+	// [note]: with 1 frame in flight this is the CPU pacing of the low latency profile, input is only sampled once the GPU caught up
+	vkWaitForFences(mainDevice.logicalDevice, 1, &frames[currentFrame].drawFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	recordSubmitToPresent(currentFrame);
+}
+
+void VulkanRenderer::markInputSampled()
+{
+	inputSampleTime = std::chrono::steady_clock::now();
+}
+
+void VulkanRenderer::recordSubmitToPresent(int frame)
+{
+	// VK_KHR_present_wait is not available, the frame fence signalling is the closest observable point to the present.
+	// It is seen when the slot is reused, so with several frames in flight this is an upper bound
+	if (!frames[frame].submitPending) return;
+	frames[frame].submitPending = false;
+
+	double submitToPresent = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frames[frame].submitTime).count();
+	latencyStats.submitToPresentSum += submitToPresent;
+	latencyStats.submitToPresentMax = std::max(latencyStats.submitToPresentMax, submitToPresent);
+	latencyStats.submitToPresentCount++;
+}
+
+void VulkanRenderer::reportLatency()
+{
+	static const char* const profileNames[] = { "default", "low latency", "throughput" };
+
+	double inputToSubmitAvg = latencyStats.inputToSubmitCount > 0 ? latencyStats.inputToSubmitSum / latencyStats.inputToSubmitCount : 0.0;
+	double submitToPresentAvg = latencyStats.submitToPresentCount > 0 ? latencyStats.submitToPresentSum / latencyStats.submitToPresentCount : 0.0;
+	printf("Latency [%s, %u frames in flight]: input->submit avg %.2f ms (max %.2f), submit->present avg %.2f ms (max %.2f)\n",
+		profileNames[latencyProfile], framesInFlight, inputToSubmitAvg, latencyStats.inputToSubmitMax,
+		submitToPresentAvg, latencyStats.submitToPresentMax);
+
+	latencyStats = LatencyStats();
+	latencyFrameCount = 0;
+
+	// GPU pass timings and memory usage at the same interval
+	gpuProfiler.printStats();
+	MemoryTracker::printSnapshot();
+}
+
+void VulkanRenderer::setProfileDrawGroups(bool enabled)
+{
+	profileDrawGroups = enabled;
+	gpuProfiler.setProfileDrawGroups(enabled);
+}
+
+void VulkanRenderer::setDepthPrepass(bool enabled)
+{
+	depthPrepassEnabled = enabled;
+}
+
+void VulkanRenderer::setPipelineStatistics(bool enabled)
+{
+	if (!frames.empty())
+	{
+		throw std::runtime_error("Pipeline statistics have to be requested before init()!");
+	}
+	pipelineStatisticsRequested = enabled;
+}
+
+void VulkanRenderer::createGpuProfiler()
+{
+	// Query pool ringed per frame in flight, timestamps are written on the graphics queue
+	gpuProfiler = GpuProfiler(mainDevice.physicalDevice, mainDevice.logicalDevice,
+		static_cast<uint32_t>(queueFamilyIndices.graphicsFamily), static_cast<uint32_t>(frames.size()),
+		pipelineStatisticsEnabled);
+	gpuProfiler.setProfileDrawGroups(profileDrawGroups);
+}
+
+void VulkanRenderer::recreateSwapChain()
+{
+	CPU_PROFILE_ZONE("recreateSwapChain");
+
+	// Minimized: nothing to present to until the window has a size again
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	while (width == 0 || height == 0)
+	{
+		glfwWaitEvents();
+		glfwGetFramebufferSize(window, &width, &height);
+	}
+
+	// Only wait for the frames in flight that may still use the swapchain sized resources, not for the whole device
+	for (const FrameContext& frame : frames)
+	{
+		vkWaitForFences(mainDevice.logicalDevice, 1, &frame.drawFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	// Destroy everything sized after the swapchain, pipelines / render pass / descriptor sets are kept
+	destroySwapChainResources();
+
+	swapChainImages.clear();
+	createSwapChain();													// Hands the old swapchain over through oldSwapchain, the image count may change
+	createDepthBufferImage();
+	createColorBufferImage();
+	createFramebuffer();
+	updateSubpassInputDescriptorSets();									// Point the input attachments at the new images
+	imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);		// Every frame was waited on above
+}
+
+void VulkanRenderer::destroySwapChainResources()
+{
+	for (const VkFramebuffer& framebuffer : swapChainFramebuffers) {
+		vkDestroyFramebuffer(mainDevice.logicalDevice, framebuffer, nullptr);
+	}
+	for (size_t i = 0; i < depthBufferImage.size(); i++) {
+		vkDestroyImageView(mainDevice.logicalDevice, depthBufferImageView[i], nullptr);
+		vkDestroyImage(mainDevice.logicalDevice, depthBufferImage[i], nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, depthBufferImageMemory[i]);
+	}
+	for (size_t i = 0; i < colorBufferImage.size(); i++) {
+		vkDestroyImageView(mainDevice.logicalDevice, colorBufferImageView[i], nullptr);
+		vkDestroyImage(mainDevice.logicalDevice, colorBufferImage[i], nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, colorBufferImageMemory[i]);
+	}
+	for (const SwapChainImage& image : swapChainImages) {
+		vkDestroyImageView(mainDevice.logicalDevice, image.imageView, nullptr);
+	}
+}
+
+void VulkanRenderer::framebufferResizeCallback(GLFWwindow* window, int /*width*/, int /*height*/)
+{
+	VulkanRenderer* renderer = static_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
+	renderer->framebufferResized = true;
+}
+
+void VulkanRenderer::setDebugViewMode(DebugViewMode mode)
+{
+	// Picks (or builds once) the composite variant with this view baked in, command buffers are re-recorded every frame
+	compositeSpecialization.debugViewMode = mode;
+	subpass1GraphicsPipeline = getCompositePipeline(compositeSpecialization);
 }
 
 VkExtent2D VulkanRenderer::getSwapChainExtent()
@@ -247,6 +499,44 @@ VkExtent2D VulkanRenderer::getSwapChainExtent()
 	return swapChainExtent;
 }
 
+std::string VulkanRenderer::getDeviceName()
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &deviceProperties);
+	return deviceProperties.deviceName;
+}
+
+uint32_t VulkanRenderer::getDrawCount()
+{
+	return drawCount;
+}
+
+uint32_t VulkanRenderer::getDepthPrepassDrawCount()
+{
+	return prepassDrawCount;
+}
+
+uint32_t VulkanRenderer::getTextureBindCount()
+{
+	return textureBindCount;
+}
+
+bool VulkanRenderer::getGpuStats(const std::string& name, GpuStatSummary& outSummary)
+{
+	return gpuProfiler.getStats(name, outSummary);
+}
+
+void VulkanRenderer::resetGpuStats(size_t historySize)
+{
+	gpuProfiler.resetHistory(historySize);
+}
+
+void VulkanRenderer::collectGpuStats()
+{
+	vkDeviceWaitIdle(mainDevice.logicalDevice);
+	gpuProfiler.collectAll();
+}
+
 void VulkanRenderer::createInstance()
 {
 	//validation layers
@@ -327,6 +617,8 @@ void VulkanRenderer::createSwapChain()
 	// How many images are in the swap chain? Get 1 more than the minimum to allow triple buffering
 	// image count in swap chain depends on the number provided by surface, so get the imageCount from surface settings, and then set it to swap chain
 	uint32_t imageCount = swapChainDetails.surfaceCapabilities.minImageCount + 1;
+	// Enough images that every frame in flight can hold one while another is being presented
+	imageCount = std::max(imageCount, framesInFlight + 1);
 
 	// If imageCount higher than max, then clamp down to max
 	// If maxImageCount = 0, then it's limitless
@@ -375,7 +667,8 @@ void VulkanRenderer::createSwapChain()
 	}
 
 	// IF old swap chain been destroyed and this one replaces it, then link old one to quickly hand over responsibilities
-	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE; //this is used when resizing window
+	VkSwapchainKHR oldSwapchain = swapchain;
+	swapChainCreateInfo.oldSwapchain = oldSwapchain; //this is used when resizing window, VK_NULL_HANDLE on first creation
 
 	// Create Swapchain
 	VkResult result = vkCreateSwapchainKHR(mainDevice.logicalDevice, &swapChainCreateInfo, nullptr, 
@@ -385,6 +678,9 @@ void VulkanRenderer::createSwapChain()
 		throw std::runtime_error("Failed to create a Swapchain!");
 	}
 
+	// Old swapchain is retired by the creation above, its images are no longer acquired
+	vkDestroySwapchainKHR(mainDevice.logicalDevice, oldSwapchain, nullptr);
+
 	//// Store for later reference
 	swapChainImageFormat = surfaceFormat.format;
 	swapChainExtent = extent;
@@ -401,6 +697,12 @@ void VulkanRenderer::createSwapChain()
 		SwapChainImage swapChainImage = {};
 		swapChainImage.image = image;
 		swapChainImage.imageView = createImageView(image, swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		if (DebugUtils::isEnabled())
+		{
+			std::string name = "Swapchain image " + std::to_string(swapChainImages.size());
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE, image, name);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW, swapChainImage.imageView, name);
+		}
 
 		// Add to swapchain image list
 		swapChainImages.push_back(swapChainImage);
@@ -409,8 +711,8 @@ void VulkanRenderer::createSwapChain()
 
 void VulkanRenderer::createRenderPass()
 {
-	// 2 Subpasses
-	std::array<VkSubpassDescription, 2> subpasses{};
+	// 3 Subpasses: depth pre-pass, color, composite (see SUBPASS_DEPTH_PREPASS)
+	std::array<VkSubpassDescription, 3> subpasses{};
 
 	// SUBPASS 1 ATTACHMENT + REFERENCE ========================================================
 	// - Output Attachment
@@ -435,7 +737,7 @@ void VulkanRenderer::createRenderPass()
 	// - - Depth Attachment, will be output to framebuffer
 	VkAttachmentDescription depthAttachment = {};
 	this->depthBufferImageFormat = chooseSupportedFormat(				// Get the depthBufferFormat and save it for createDepthBufferImage()
-		{ VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT },
+		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },		// Stencil is never used, prefer the format without it
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
 	depthAttachment.format = this->depthBufferImageFormat;
@@ -450,11 +752,15 @@ void VulkanRenderer::createRenderPass()
 	VkAttachmentReference depthAttachmentReference = {};							// Refer to the order of <vkImageView>attachments in createFrameBuffer();
 	depthAttachmentReference.attachment = 2;
 	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	// SET DEPTH PRE-PASS, depth only. Empty while the pre-pass is off, the depth is then cleared when the color subpass starts
+	subpasses[SUBPASS_DEPTH_PREPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[SUBPASS_DEPTH_PREPASS].colorAttachmentCount = 0;
+	subpasses[SUBPASS_DEPTH_PREPASS].pDepthStencilAttachment = &depthAttachmentReference;
 	// SET SUBPASS 1
-	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;		// Pipeline type subpass is to be bound to
-	subpasses[0].colorAttachmentCount = 1;
-	subpasses[0].pColorAttachments = &colorAttachmentReference;				// Set output color attachment
-	subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;		// Set output depth attachment
+	subpasses[SUBPASS_COLOR].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;		// Pipeline type subpass is to be bound to
+	subpasses[SUBPASS_COLOR].colorAttachmentCount = 1;
+	subpasses[SUBPASS_COLOR].pColorAttachments = &colorAttachmentReference;				// Set output color attachment
+	subpasses[SUBPASS_COLOR].pDepthStencilAttachment = &depthAttachmentReference;		// Set output depth attachment (read only after the pre-pass, depth writes are off in that pipeline)
 
 
 	// SUBPASS 2 ATTACHMENT + REFERENCES ================================================================
@@ -480,38 +786,62 @@ void VulkanRenderer::createRenderPass()
 	swapchainColorAttachmentReference.attachment = 0;										// this 0 is index
 	swapchainColorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;	// [note]: the layout is changed from VK_IMAGE_LAYOUT_UNDEFINED (initial layout) => VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL (subpass layout)=> VK_IMAGE_LAYOUT_PRESENT_SRC_KHR (final layout)
 	// SET SUBPASS 2
-	subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;						// Pipeline type subpass is to be bound to
-	subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputReferences.size());		
-	subpasses[1].pInputAttachments = inputReferences.data();								// Set input attachment
-	subpasses[1].colorAttachmentCount = 1;
-	subpasses[1].pColorAttachments = &swapchainColorAttachmentReference;					// Set output attachment
+	subpasses[SUBPASS_COMPOSITE].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;						// Pipeline type subpass is to be bound to
+	subpasses[SUBPASS_COMPOSITE].inputAttachmentCount = static_cast<uint32_t>(inputReferences.size());		
+	subpasses[SUBPASS_COMPOSITE].pInputAttachments = inputReferences.data();								// Set input attachment
+	subpasses[SUBPASS_COMPOSITE].colorAttachmentCount = 1;
+	subpasses[SUBPASS_COMPOSITE].pColorAttachments = &swapchainColorAttachmentReference;					// Set output attachment
 
 	// SUBPASS DEPENDENCIES =========================================================================			// Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL // [note] specify two moment, first is the end of the subpass external, second is the 1st subpass start to read
-	std::array<VkSubpassDependency, 3> subpassDependencies;							// Need to determine when layout transitions occur using subpass dependencies, dependencies also defines the exact moment when the layout changes
-	// - From External to subpass 0
+	std::array<VkSubpassDependency, 6> subpassDependencies;							// Need to determine when layout transitions occur using subpass dependencies, dependencies also defines the exact moment when the layout changes
+	// - From External to the color subpass
 	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;						// Subpass index (VK_SUBPASS_EXTERNAL = Special value meaning outside of subpass)
 	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;		// Pipeline stage, end of a pipeline
 	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;				// Stage access mask (memory access)
-	subpassDependencies[0].dstSubpass = 0;
+	subpassDependencies[0].dstSubpass = SUBPASS_COLOR;
 	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 	subpassDependencies[0].dependencyFlags = 0;
-	// - From subpass 0 to subpass 1
-	subpassDependencies[1].srcSubpass = 0;						
-	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	subpassDependencies[1].dstSubpass = 1;
+	// - From the color subpass to the composite
+	subpassDependencies[1].srcSubpass = SUBPASS_COLOR;						
+	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[1].dstSubpass = SUBPASS_COMPOSITE;
 	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 	subpassDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
 	subpassDependencies[1].dependencyFlags = 0;
-	// - From subpass 1 to External
-	subpassDependencies[2].srcSubpass = 0;
+	// - From the composite subpass to External
+	subpassDependencies[2].srcSubpass = SUBPASS_COMPOSITE;
 	subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	subpassDependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;;
 	subpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
 	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 	subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
 	subpassDependencies[2].dependencyFlags = 0;
+	// - From External to the depth pre-pass: the composite of this frame slot's last frame read the depth buffer
+	subpassDependencies[3].srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependencies[3].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	subpassDependencies[3].srcAccessMask = 0;
+	subpassDependencies[3].dstSubpass = SUBPASS_DEPTH_PREPASS;
+	subpassDependencies[3].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[3].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[3].dependencyFlags = 0;
+	// - From the depth pre-pass to the color subpass, which depth tests against it
+	subpassDependencies[4].srcSubpass = SUBPASS_DEPTH_PREPASS;
+	subpassDependencies[4].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[4].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[4].dstSubpass = SUBPASS_COLOR;
+	subpassDependencies[4].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[4].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[4].dependencyFlags = 0;
+	// - From the depth pre-pass to the composite, which reads depth as an input attachment
+	subpassDependencies[5].srcSubpass = SUBPASS_DEPTH_PREPASS;
+	subpassDependencies[5].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[5].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[5].dstSubpass = SUBPASS_COMPOSITE;
+	subpassDependencies[5].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	subpassDependencies[5].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+	subpassDependencies[5].dependencyFlags = 0;
 
 	// CREATE RENDER PASS ==================================================================================
 	std::array<VkAttachmentDescription, 3> renderPassAttachments = {swapchainColorAttachment, colorAttachment, depthAttachment};
@@ -622,26 +952,127 @@ void VulkanRenderer::createDescriptorSetLayout()
 		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
 	}
 
+	// MESHLET CULLING DESCRIPTOR SET LAYOUT (set = 0 of the compute pipeline) ======================
+	std::array<VkDescriptorSetLayoutBinding, 3> meshletCullBindings = {};
+	// - Meshlet bounds
+	meshletCullBindings[0].binding = 0;
+	meshletCullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	meshletCullBindings[0].descriptorCount = 1;
+	meshletCullBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	// - LOD 0 indices of the mesh
+	meshletCullBindings[1].binding = 1;
+	meshletCullBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	meshletCullBindings[1].descriptorCount = 1;
+	meshletCullBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	// - Draw command + culled indices, dynamic so one set serves every frame slot
+	meshletCullBindings[2].binding = 2;
+	meshletCullBindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	meshletCullBindings[2].descriptorCount = 1;
+	meshletCullBindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo meshletCullLayoutCreateInfo = {};
+	meshletCullLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	meshletCullLayoutCreateInfo.bindingCount = static_cast<uint32_t>(meshletCullBindings.size());
+	meshletCullLayoutCreateInfo.pBindings = meshletCullBindings.data();
+
+	result = vkCreateDescriptorSetLayout(mainDevice.logicalDevice, &meshletCullLayoutCreateInfo, nullptr,
+		&meshletCullSetLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Descriptor Set Layout!");
+	}
+
+
+}
+
+void VulkanRenderer::compileShaders()
+{
+	// All shaders at once so they compile in parallel, unchanged sources come straight from the cache
+	shaderCompiler = ShaderCompiler(SHADER_SOURCE_DIRECTORY, SHADER_CACHE_DIRECTORY);
+	std::vector<std::string> shaderNames = { "shader.vert", "shader.frag", "depth_prepass.vert", "subpass1.vert", "subpass1.frag",
+		"meshlet_cull.comp" };
+	shaderCompiler.compileAll(shaderNames);
 
+	for (const std::string& name : shaderNames)
+	{
+		assetWatcher.watch(ASSET_KIND_SHADER, name, std::string(SHADER_SOURCE_DIRECTORY) + "/" + name);
+	}
 }
 
-void VulkanRenderer::createPushConstantRange()
+void VulkanRenderer::createPipelineCache()
 {
-	// Define push constant values
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;	// Shader stage push constant will go to
-	pushConstantRange.offset = 0;								// Offset into given data to pass to push constant
-	pushConstantRange.size = sizeof(PushConstBlock);					// Size of data being passed
+	// Seeded from the blob saved by the last run (if it matches this driver + device), saved again in cleanup()
+	pipelineCache = PipelineCache(mainDevice.physicalDevice, mainDevice.logicalDevice, PIPELINE_CACHE_FILE);
 }
 
 void VulkanRenderer::createGraphicsPipeline()
 {
-	// Read in SPIR-V code of shaders
-	std::vector<char> vertexShaderCode = readFile("shaders/vert.spv");
-	std::vector<char> fragmentShaderCode = readFile("shaders/frag.spv");
+	// -- PIPELINE LAYOUT -- : DescriptorSet & Push Constants
+	std::array<VkDescriptorSetLayout, 2> descriptorSetLayout = { this->descriptorSetLayout, this->samplerDescriptorSetLayout };
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayout.size());
+	pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayout.data();						
+
+	// Layer of the texture array bound to set 1, changes per draw
+	VkPushConstantRange drawPushConstantRange = {};
+	drawPushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	drawPushConstantRange.offset = 0;
+	drawPushConstantRange.size = sizeof(DrawPushConst);
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &drawPushConstantRange;
+
+	// Create Pipeline Layout
+	VkResult result = vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, 
+		&pipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Pipeline Layout!");
+	}
 
-	// Create Shader Modules
-	VkShaderModule vertexShaderModule = createShaderModule(vertexShaderCode);
-	VkShaderModule fragmentShaderModule = createShaderModule(fragmentShaderCode);
+	// Subpass 0 pipelines, rebuilt on their own when one of their shaders is hot reloaded. Both color variants are built up front,
+	// the depth pre-pass can be turned on and off between any two frames
+	graphicsPipeline = createSubpass0Pipeline(false);
+	depthEqualGraphicsPipeline = createSubpass0Pipeline(true);
+	depthPrepassPipeline = createDepthPrepassPipeline();
+
+
+	// PIPELINE OF SUBPASS 2 ==========================================================================
+	// Layout shared by every composite variant
+	VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo = {};
+	secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	secondPipelineLayoutCreateInfo.setLayoutCount = 1;
+	secondPipelineLayoutCreateInfo.pSetLayouts = &subpassInputSetLayout;
+
+	// Framebuffer width, the split fraction is resolved to pixels in the shader
+	VkPushConstantRange compositePushConstantRange = {};
+	compositePushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	compositePushConstantRange.offset = 0;
+	compositePushConstantRange.size = sizeof(CompositePushConst);
+	secondPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	secondPipelineLayoutCreateInfo.pPushConstantRanges = &compositePushConstantRange;
+
+	result = vkCreatePipelineLayout(mainDevice.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, 
+		&subpass1PipelineLayout);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Pipeline Layout!");
+	}
+
+	// Only the variant in use is built, the others are built the first time they are asked for
+	compositeSpecialization.debugViewMode = DEBUG_VIEW_COLOUR;		// Split / depth views are opt-in through setDebugViewMode()
+	compositeSpecialization.splitFraction = 0.5f;
+	compositeSpecialization.depthLowerBound = 0.98f;
+	compositeSpecialization.depthUpperBound = 1.0f;
+	subpass1GraphicsPipeline = getCompositePipeline(compositeSpecialization);
+}
+
+VkPipeline VulkanRenderer::createSubpass0Pipeline(bool afterDepthPrepass)
+{
+	// Create Shader Modules from the SPIR-V compiled in compileShaders()
+	VkShaderModule vertexShaderModule = createShaderModule(shaderCompiler.getSpirv("shader.vert"));
+	VkShaderModule fragmentShaderModule = createShaderModule(shaderCompiler.getSpirv("shader.frag"));
 
 	// -- SHADER STAGE CREATION INFORMATION --
 	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};			// Vertex Stage creation information
@@ -700,38 +1131,25 @@ void VulkanRenderer::createGraphicsPipeline()
 	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;		// TRIANGLE_LIST, TRIANGLE_STRIP, TRIANGLE_FANS ...
 	inputAssembly.primitiveRestartEnable = VK_FALSE;					// Allow overriding of "strip" topology to start new primitives
 
-	// -- VIEWPORT & SCISSOR --
-	// Create a viewport info struct
-	VkViewport viewport = {};
-	viewport.x = 0.0f;									// x start coordinate
-	viewport.y = 0.0f;									// y start coordinate
-	viewport.width = (float)swapChainExtent.width;		// width of viewport
-	viewport.height = (float)swapChainExtent.height;	// height of viewport
-	viewport.minDepth = 0.0f;							// min framebuffer depth
-	viewport.maxDepth = 1.0f;							// max framebuffer depth
-
-	// Create a scissor info struct
-	VkRect2D scissor = {};
-	scissor.offset = { 0,0 };							// Offset to use region from
-	scissor.extent = swapChainExtent;					// Extent to describe region to use, starting at offset
-
+	// -- VIEWPORT & SCISSOR -- : only the counts here, the values are set in recordCommands() (dynamic state)
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
 	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
+	viewportStateCreateInfo.pViewports = nullptr;
 	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
+	viewportStateCreateInfo.pScissors = nullptr;
 
 	// -- DYNAMIC STATES --
 	// Dynamic states to enable
-	//std::vector<VkDynamicState> dynamicStateEnables;
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);	// Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
-	//dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);	// Dynamic Scissor	: Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
-	//// Dynamic State creation info
-	//VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-	//dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	//dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-	//dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+	std::array<VkDynamicState, 2> dynamicStateEnables = {
+		VK_DYNAMIC_STATE_VIEWPORT,		// Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandbuffer, 0, 1, &viewport);
+		VK_DYNAMIC_STATE_SCISSOR		// Dynamic Scissor	: Can resize in command buffer with vkCmdSetScissor(commandbuffer, 0, 1, &scissor);
+	};
+	// Dynamic State creation info
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
 
 	// -- RASTERIZER --
 	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
@@ -774,30 +1192,14 @@ void VulkanRenderer::createGraphicsPipeline()
 	colourBlendingCreateInfo.attachmentCount = 1;
 	colourBlendingCreateInfo.pAttachments = &colourState;
 
-	// -- PIPELINE LAYOUT -- : DescriptorSet & Push Constants
-	std::array<VkDescriptorSetLayout, 2> descriptorSetLayout = { this->descriptorSetLayout, this->samplerDescriptorSetLayout };
-
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
-	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayout.size());
-	pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayout.data();						
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
-
-	// Create Pipeline Layout
-	VkResult result = vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, 
-		&pipelineLayout);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create Pipeline Layout!");
-	}
-
 	// -- DEPTH STENCIL TESTING --
+	// After the depth pre-pass the depth buffer already holds the closest surface: only the fragments that are exactly on it
+	// pass (EQUAL), so shader.frag runs once per visible pixel, and there is nothing left to write
 	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
 	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthStencilCreateInfo.depthTestEnable = VK_TRUE;				// Enable checking depth to determine fragment write
-	depthStencilCreateInfo.depthWriteEnable = VK_TRUE;				// Enable writing to depth buffer (to replace old values)
-	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;		// Comparison operation that allows an overwrite (is in front)
+	depthStencilCreateInfo.depthWriteEnable = afterDepthPrepass ? VK_FALSE : VK_TRUE;		// Enable writing to depth buffer (to replace old values)
+	depthStencilCreateInfo.depthCompareOp = afterDepthPrepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;	// Comparison operation that allows an overwrite (is in front)
 	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;		// Depth Bounds Test: Does the depth value exist between two bounds
 	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;			// Enable Stencil Test
 
@@ -809,142 +1211,441 @@ void VulkanRenderer::createGraphicsPipeline()
 	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;		// All the fixed function pipeline states
 	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
 	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	pipelineCreateInfo.pDynamicState = nullptr;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
 	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
 	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
 	pipelineCreateInfo.pColorBlendState = &colourBlendingCreateInfo;
 	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
 	pipelineCreateInfo.layout = pipelineLayout;							// Pipeline Layout pipeline should use
 	pipelineCreateInfo.renderPass = renderPass;							// Render pass description the pipeline is compatible with
-	pipelineCreateInfo.subpass = 0;										// Subpass index of render pass to use with pipeline
+	pipelineCreateInfo.subpass = SUBPASS_COLOR;							// Subpass index of render pass to use with pipeline
 
 	// Pipeline Derivatives : Can create multiple pipelines that derive from one another for optimisation
 	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;	// Existing pipeline to derive from...
 	pipelineCreateInfo.basePipelineIndex = -1;				// or index of pipeline being created to derive from (in case creating multiple at once)
 
 	// Create Graphics Pipeline
-	result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
-		nullptr, &graphicsPipeline);
+	VkPipeline pipeline;
+	auto pipelineStartTime = std::chrono::steady_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, pipelineCache.getCache(), 1, &pipelineCreateInfo,
+		nullptr, &pipeline);
+
+	// Destroy Shader Modules, no longer needed after Pipeline created (or failed to, a hot reload keeps running)
+	vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
+	vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule, nullptr);
+
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create a Graphics Pipeline!");
 	}
+	pipelineCache.logCreation(afterDepthPrepass ? "subpass 0, depth equal" : "subpass 0", pipelineStartTime);
+	DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_PIPELINE, pipeline,
+		afterDepthPrepass ? "Subpass 0 pipeline, depth equal" : "Subpass 0 pipeline");
+
+	return pipeline;
+}
+
+VkPipeline VulkanRenderer::createDepthPrepassPipeline()
+{
+	VkShaderModule vertexShaderModule = createShaderModule(shaderCompiler.getSpirv("depth_prepass.vert"));
+
+	// -- SHADER STAGES -- : vertex only, the depth test and write happen without a fragment shader
+	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+	vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	vertexShaderCreateInfo.module = vertexShaderModule;
+	vertexShaderCreateInfo.pName = "main";
+
+	// -- VERTEX INPUT -- : position only, read from the same interleaved vertex buffers as subpass 0
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Vertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription positionAttribute = {};
+	positionAttribute.binding = 0;
+	positionAttribute.location = 0;
+	positionAttribute.format = VK_FORMAT_R32G32B32_SFLOAT;
+	positionAttribute.offset = offsetof(Vertex, pos);
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+	vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = 1;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = &positionAttribute;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// -- VIEWPORT & SCISSOR -- : dynamic, same as the subpass 0 pipeline
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.scissorCount = 1;
+
+	std::array<VkDynamicState, 2> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+
+	// -- RASTERIZER -- : same culling as subpass 0, or the EQUAL test there would see depths this pass never wrote
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizerCreateInfo.lineWidth = 1.0f;
+	rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// -- BLENDING -- : the pre-pass has no color attachment
+	VkPipelineColorBlendStateCreateInfo colourBlendingCreateInfo = {};
+	colourBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colourBlendingCreateInfo.attachmentCount = 0;
+
+	// -- DEPTH STENCIL TESTING -- : the closest surface wins, like subpass 0 without the pre-pass
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+	depthStencilCreateInfo.depthWriteEnable = VK_TRUE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	// -- GRAPHICS PIPELINE CREATION --
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = 1;
+	pipelineCreateInfo.pStages = &vertexShaderCreateInfo;
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colourBlendingCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.layout = pipelineLayout;				// Only set 0 is used, same layout so the uniform set stays bound for subpass 0
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.subpass = SUBPASS_DEPTH_PREPASS;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	auto pipelineStartTime = std::chrono::steady_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, pipelineCache.getCache(), 1, &pipelineCreateInfo,
+		nullptr, &pipeline);
 
-	// Destroy Shader Modules, no longer needed after Pipeline created
-	vkDestroyShaderModule(mainDevice.logicalDevice, fragmentShaderModule, nullptr);
 	vkDestroyShaderModule(mainDevice.logicalDevice, vertexShaderModule, nullptr);
 
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Graphics Pipeline!");
+	}
+	pipelineCache.logCreation("depth pre-pass", pipelineStartTime);
+	DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_PIPELINE, pipeline, "Depth pre-pass pipeline");
+
+	return pipeline;
+}
 
-	// PIPELINE OF SUBPASS 2 ==========================================================================
-	// Second pass shaders
-	auto secondVertexShaderCode = readFile("Shaders/subpass1_vert.spv");
-	auto secondFragmentShaderCode = readFile("Shaders/subpass1_frag.spv");
+VkPipeline VulkanRenderer::getCompositePipeline(const CompositeSpecialization& specialization)
+{
+	for (const CompositeVariant& variant : compositeVariants)
+	{
+		if (memcmp(&variant.specialization, &specialization, sizeof(CompositeSpecialization)) == 0)
+		{
+			return variant.pipeline;
+		}
+	}
 
-	// Build shaders
-	VkShaderModule subpass1VertexShaderModule = createShaderModule(secondVertexShaderCode);
-	VkShaderModule subpass1FragmentShaderModule = createShaderModule(secondFragmentShaderCode);
+	CompositeVariant variant = {};
+	variant.specialization = specialization;
+	variant.pipeline = createCompositePipeline(specialization);
+	compositeVariants.push_back(variant);
+	return variant.pipeline;
+}
 
-	// Set new shaders
+VkPipeline VulkanRenderer::createCompositePipeline(const CompositeSpecialization& specialization)
+{
+	VkShaderModule subpass1VertexShaderModule = createShaderModule(shaderCompiler.getSpirv("subpass1.vert"));
+	VkShaderModule subpass1FragmentShaderModule = createShaderModule(shaderCompiler.getSpirv("subpass1.frag"));
+
+	// -- SPECIALIZATION CONSTANTS -- : constant_id 0..3 of subpass1.frag, baked in when the pipeline is created so the unused views compile out
+	std::array<VkSpecializationMapEntry, 4> specializationEntries;
+	specializationEntries[0] = { 0, offsetof(CompositeSpecialization, debugViewMode), sizeof(int32_t) };
+	specializationEntries[1] = { 1, offsetof(CompositeSpecialization, splitFraction), sizeof(float) };
+	specializationEntries[2] = { 2, offsetof(CompositeSpecialization, depthLowerBound), sizeof(float) };
+	specializationEntries[3] = { 3, offsetof(CompositeSpecialization, depthUpperBound), sizeof(float) };
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = sizeof(CompositeSpecialization);
+	specializationInfo.pData = &specialization;
+
+	// -- SHADER STAGES --
+	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+	vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 	vertexShaderCreateInfo.module = subpass1VertexShaderModule;
+	vertexShaderCreateInfo.pName = "main";
+
+	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
+	fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragmentShaderCreateInfo.module = subpass1FragmentShaderModule;
+	fragmentShaderCreateInfo.pName = "main";
+	fragmentShaderCreateInfo.pSpecializationInfo = &specializationInfo;
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> subpass1ShaderStages = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
+
+	// -- VERTEX INPUT -- : none, the full screen triangle is generated in the vertex shader
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-	VkPipelineShaderStageCreateInfo subpass1ShaderStages[] = { vertexShaderCreateInfo, fragmentShaderCreateInfo };
+	// -- VIEWPORT & SCISSOR -- : dynamic, same as the subpass 0 pipeline
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
+	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportStateCreateInfo.viewportCount = 1;
+	viewportStateCreateInfo.scissorCount = 1;
+
+	std::array<VkDynamicState, 2> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+	dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+
+	// -- RASTERIZER --
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizerCreateInfo.lineWidth = 1.0f;
+	rasterizerCreateInfo.cullMode = VK_CULL_MODE_NONE;						// Single full screen triangle, nothing to cull
+	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	// -- MULTISAMPLING --
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo = {};
+	multisamplingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisamplingCreateInfo.sampleShadingEnable = VK_FALSE;
+	multisamplingCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
 
-	// No vertex data for second pass
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-	vertexInputCreateInfo.pVertexBindingDescriptions = nullptr;
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputCreateInfo.pVertexAttributeDescriptions = nullptr;
+	// -- BLENDING -- : the composite overwrites the swapchain image
+	VkPipelineColorBlendAttachmentState colourState = {};
+	colourState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+		| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colourState.blendEnable = VK_FALSE;
 
-	// Don't want to write to depth buffer
+	VkPipelineColorBlendStateCreateInfo colourBlendingCreateInfo = {};
+	colourBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colourBlendingCreateInfo.logicOpEnable = VK_FALSE;
+	colourBlendingCreateInfo.attachmentCount = 1;
+	colourBlendingCreateInfo.pAttachments = &colourState;
+
+	// -- DEPTH STENCIL TESTING -- : subpass 1 reads depth as an input attachment, no depth test
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_FALSE;
 	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
 
-	// Create new pipeline layout
-	VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo = {};
-	secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	secondPipelineLayoutCreateInfo.setLayoutCount = 1;
-	secondPipelineLayoutCreateInfo.pSetLayouts = &subpassInputSetLayout;
-	secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	// -- GRAPHICS PIPELINE CREATION --
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = static_cast<uint32_t>(subpass1ShaderStages.size());
+	pipelineCreateInfo.pStages = subpass1ShaderStages.data();
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
+	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colourBlendingCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.layout = subpass1PipelineLayout;		// Input attachment descriptor sets
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.subpass = SUBPASS_COMPOSITE;			// Use the composite subpass
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline compositePipeline;
+	auto pipelineStartTime = std::chrono::steady_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, pipelineCache.getCache(), 1, &pipelineCreateInfo, nullptr, 
+		&compositePipeline);
+
+	vkDestroyShaderModule(mainDevice.logicalDevice, subpass1FragmentShaderModule, nullptr);
+	vkDestroyShaderModule(mainDevice.logicalDevice, subpass1VertexShaderModule, nullptr);
 
-	result = vkCreatePipelineLayout(mainDevice.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, 
-		&subpass1PipelineLayout);
 	if (result != VK_SUCCESS)
 	{
-		throw std::runtime_error("Failed to create a Pipeline Layout!");
+		throw std::runtime_error("Failed to create a Graphics Pipeline!");
+	}
+	pipelineCache.logCreation("subpass 1", pipelineStartTime);
+	if (DebugUtils::isEnabled())
+	{
+		std::string name = "Subpass 1 pipeline, view mode " + std::to_string(specialization.debugViewMode);
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_PIPELINE, compositePipeline, name);
 	}
 
-	pipelineCreateInfo.pStages = subpass1ShaderStages;	// Update second shader stage list
-	pipelineCreateInfo.layout = subpass1PipelineLayout;	// Change pipeline layout for input attachment descriptor sets
-	pipelineCreateInfo.subpass = 1;						// Use second subpass
+	return compositePipeline;
+}
 
-	// Create second pipeline
-	result = vkCreateGraphicsPipelines(mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, 
-		&subpass1GraphicsPipeline);
+void VulkanRenderer::createMeshletCullPipeline()
+{
+	// The culling pass is recorded in the graphics command buffer, so the graphics queue family must support compute
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(mainDevice.physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(mainDevice.physicalDevice, &queueFamilyCount, queueFamilies.data());
+	if (!(queueFamilies[queueFamilyIndices.graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT))
+	{
+		printf("Meshlet culling disabled: graphics queue has no compute support\n");
+		return;
+	}
+
+	// -- PIPELINE LAYOUT -- : meshlet buffers + object space frustum/camera as push constants
+	VkPushConstantRange cullPushConstantRange = {};
+	cullPushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	cullPushConstantRange.offset = 0;
+	cullPushConstantRange.size = sizeof(MeshletCullPushConst);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &meshletCullSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &cullPushConstantRange;
+
+	VkResult result = vkCreatePipelineLayout(mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr,
+		&meshletCullPipelineLayout);
 	if (result != VK_SUCCESS)
 	{
-		throw std::runtime_error("Failed to create a Graphics Pipeline!");
+		throw std::runtime_error("Failed to create a Pipeline Layout!");
 	}
 
-	// Destroy second shader modules
-	vkDestroyShaderModule(mainDevice.logicalDevice, subpass1FragmentShaderModule, nullptr);
-	vkDestroyShaderModule(mainDevice.logicalDevice, subpass1VertexShaderModule, nullptr);
+	// A shader that failed to compile only disables the culling pass, meshes are then drawn without it (a hot reload of
+	// the shader can still turn it on)
+	try {
+		meshletCullPipeline = createMeshletCullComputePipeline();
+	}
+	catch (const std::runtime_error& e) {
+		printf("Meshlet culling disabled: %s\n", e.what());
+		return;
+	}
 
+	meshletCullingEnabled = true;
+}
+
+VkPipeline VulkanRenderer::createMeshletCullComputePipeline()
+{
+	VkShaderModule computeShaderModule = createShaderModule(shaderCompiler.getSpirv("meshlet_cull.comp"));
+
+	VkPipelineShaderStageCreateInfo computeShaderCreateInfo = {};
+	computeShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	computeShaderCreateInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	computeShaderCreateInfo.module = computeShaderModule;
+	computeShaderCreateInfo.pName = "main";
+
+	// -- COMPUTE PIPELINE CREATION --
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage = computeShaderCreateInfo;
+	pipelineCreateInfo.layout = meshletCullPipelineLayout;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline;
+	auto pipelineStartTime = std::chrono::steady_clock::now();
+	VkResult result = vkCreateComputePipelines(mainDevice.logicalDevice, pipelineCache.getCache(), 1, &pipelineCreateInfo,
+		nullptr, &pipeline);
+
+	vkDestroyShaderModule(mainDevice.logicalDevice, computeShaderModule, nullptr);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Compute Pipeline!");
+	}
+	pipelineCache.logCreation("meshlet culling", pipelineStartTime);
+	DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_PIPELINE, pipeline, "Meshlet culling pipeline");
+
+	return pipeline;
 }
 
 void VulkanRenderer::createDepthBufferImage()
 {
-	depthBufferImage.resize(swapChainImages.size());
-	depthBufferImageMemory.resize(swapChainImages.size());
-	depthBufferImageView.resize(swapChainImages.size());
+	// 1 depth buffer per frame in flight, not per swapchain image: it only lives inside the render pass of the frame using it
+	depthBufferImage.resize(frames.size());
+	depthBufferImageMemory.resize(frames.size());
+	depthBufferImageView.resize(frames.size());
 
-	for (size_t i = 0; i < swapChainImages.size(); i++) {
-		// Create Depth Buffer Image
+	for (size_t i = 0; i < frames.size(); i++) {
+		// Create Depth Buffer Image, transient + lazily allocated: never stored, only read as input attachment inside the render pass (tilers can keep it on chip)
 		depthBufferImage[i] = createImage(swapChainExtent.width, swapChainExtent.height, 
 			this->depthBufferImageFormat,
 			VK_IMAGE_TILING_OPTIMAL, 
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,	// The depth buffer attachment is the input of subpass1 that's why VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthBufferImageMemory[i]);
+			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,	// The depth buffer attachment is the input of subpass1 that's why VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &depthBufferImageMemory[i], MEMORY_CATEGORY_ATTACHMENTS);
 
 		// Create Depth Buffer Image View
 		depthBufferImageView[i] = createImageView(depthBufferImage[i], this->depthBufferImageFormat, 
 			VK_IMAGE_ASPECT_DEPTH_BIT);
+		if (DebugUtils::isEnabled())
+		{
+			std::string name = "Depth attachment, frame " + std::to_string(i);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE, depthBufferImage[i], name);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW, depthBufferImageView[i], name);
+		}
 	}
 }
 
 void VulkanRenderer::createColorBufferImage()
 {
-	// Resize supported format for colour attachment
-	colorBufferImage.resize(swapChainImages.size());
-	colorBufferImageMemory.resize(swapChainImages.size());
-	colorBufferImageView.resize(swapChainImages.size());
+	// 1 colour buffer per frame in flight, same as the depth buffer
+	colorBufferImage.resize(frames.size());
+	colorBufferImageMemory.resize(frames.size());
+	colorBufferImageView.resize(frames.size());
 
-	for (size_t i = 0; i < swapChainImages.size(); i++)
+	for (size_t i = 0; i < frames.size(); i++)
 	{
-		// Create Colour Buffer Image
+		// Create Colour Buffer Image, transient + lazily allocated like the depth buffer
 		colorBufferImage[i] = createImage(swapChainExtent.width, swapChainExtent.height, 
 			this->colorBufferImageFormat, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, 
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &colorBufferImageMemory[i]);
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, 
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &colorBufferImageMemory[i], MEMORY_CATEGORY_ATTACHMENTS);
 
 		// Create Colour Buffer Image View
 		colorBufferImageView[i] = createImageView(colorBufferImage[i], 
 			this->colorBufferImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		if (DebugUtils::isEnabled())
+		{
+			std::string name = "Colour attachment, frame " + std::to_string(i);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE, colorBufferImage[i], name);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW, colorBufferImageView[i], name);
+		}
 	}
 }
 
-void VulkanRenderer::createFramebuffer() //for each swapchain image, create 1 corresponding framebuffer, and store them in a vector
+void VulkanRenderer::createFramebuffer() //for each (frame in flight, swapchain image) pair, create 1 corresponding framebuffer, and store them in a vector
 {
-	// Resize framebuffer count to equal swap chain image count
-	swapChainFramebuffers.resize(swapChainImages.size());
+	// Any frame can acquire any image, so each frame's attachments get a framebuffer with every swapchain image, see getFramebuffer()
+	swapChainFramebuffers.resize(frames.size() * swapChainImages.size());
 
-	// Create a framebuffer for each swap chain image
 	for (size_t i = 0; i < swapChainFramebuffers.size(); i++)
 	{
+		size_t frame = i / swapChainImages.size();
+		size_t image = i % swapChainImages.size();
 		std::array<VkImageView, 3> attachments = {		
-			swapChainImages[i].imageView,				// SwapChain Image			attachment 0
-			colorBufferImageView[i],					// Input of frame buffer	attachment 1
-			depthBufferImageView[i]						// Input of frame buffer	attachment 2
+			swapChainImages[image].imageView,			// SwapChain Image			attachment 0
+			colorBufferImageView[frame],				// Input of frame buffer	attachment 1
+			depthBufferImageView[frame]					// Input of frame buffer	attachment 2
 		};
 
 		VkFramebufferCreateInfo framebufferCreateInfo = {};
@@ -965,6 +1666,11 @@ void VulkanRenderer::createFramebuffer() //for each swapchain image, create 1 co
 	}
 }
 
+VkFramebuffer VulkanRenderer::getFramebuffer(uint32_t swapchainImageIndex)
+{
+	return swapChainFramebuffers[currentFrame * swapChainImages.size() + swapchainImageIndex];
+}
+
 void VulkanRenderer::createCommandPool()
 {
 	// Get indices of queue families from device
@@ -982,33 +1688,23 @@ void VulkanRenderer::createCommandPool()
 	}
 }
 
-void VulkanRenderer::allocateCommandBuffers() 
+void VulkanRenderer::createFrameContexts()
 {
-	// Resize command buffer count to have one for each framebuffer
-	commandBuffers.resize(swapChainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo cbAllocInfo = {};
-	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	cbAllocInfo.commandPool = graphicsCommandPool;
-	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;	// VK_COMMAND_BUFFER_LEVEL_PRIMARY	: Buffer you submit directly to queue. Cant be called by other buffers.
-															// VK_COMMAND_BUFFER_LEVEL_SECONARY	: Buffer can't be called directly. Can be called from other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer
-	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-	// Allocate command buffers and place handles in array of buffers
-	VkResult result = vkAllocateCommandBuffers(mainDevice.logicalDevice, &cbAllocInfo, commandBuffers.data());
-	if (result != VK_SUCCESS)
+	// Frames in flight can't be more than the swapchain images (the surface may clamp the image count)
+	if (framesInFlight > swapChainImages.size())
 	{
-		throw std::runtime_error("Failed to allocate Command Buffers!");
+		printf("Frames in flight clamped from %u to %zu (swapchain image count)\n", framesInFlight, swapChainImages.size());
+		framesInFlight = static_cast<uint32_t>(swapChainImages.size());
 	}
-	// [note]: no need to destroy CommandBuffers since cmdBuffs are held by cmdPool, and when cmdPool is destroyed, so are cmdBuffs
-}
+	frames.resize(framesInFlight);
+	imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+	inputSampleTime = std::chrono::steady_clock::now();
 
-void VulkanRenderer::createSynchronization()
-{
-	// The reason resize semaphore size is we want decouple frame with image, the max number of images in the queue should be MAX_FRAME_DRAWS
-	semaphoreImageAvailable.resize(MAX_FRAME_DRAWS);
-	semaphoreFinishRender.resize(MAX_FRAME_DRAWS);
-	drawFences.resize(MAX_FRAME_DRAWS);
+	// Transient pool per frame: its command buffer is re-recorded every frame, the whole pool is reset at once instead of each buffer
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = this->queueFamilyIndices.graphicsFamily;
 
 	// Semaphore creation information
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
@@ -1019,16 +1715,57 @@ void VulkanRenderer::createSynchronization()
 	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;			// let the fence be signalled/ open when start off created
 
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++){
-		if (vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &semaphoreImageAvailable[i]) != VK_SUCCESS ||
-			vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &semaphoreFinishRender[i]) != VK_SUCCESS ||
-			vkCreateFence(mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &drawFences[i]) != VK_SUCCESS){
+	for (FrameContext& frame : frames)
+	{
+		frame = {};
+		if (vkCreateCommandPool(mainDevice.logicalDevice, &poolInfo, nullptr, &frame.commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a Frame Command Pool!");
+		}
+
+		VkCommandBufferAllocateInfo cbAllocInfo = {};
+		cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbAllocInfo.commandPool = frame.commandPool;
+		cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;	// VK_COMMAND_BUFFER_LEVEL_PRIMARY	: Buffer you submit directly to queue. Cant be called by other buffers.
+		cbAllocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(mainDevice.logicalDevice, &cbAllocInfo, &frame.commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Command Buffers!");
+		}
+		// [note]: no need to free the command buffer, it is held by the frame's pool
+
+		if (vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &frame.imageAvailable) != VK_SUCCESS ||
+			vkCreateSemaphore(mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &frame.finishRender) != VK_SUCCESS ||
+			vkCreateFence(mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &frame.drawFence) != VK_SUCCESS){
 			throw std::runtime_error("Failed to create a Semaphore and/or Fence!");
 		}
 	}
 }
 
+void VulkanRenderer::destroyFrameContexts()
+{
+	for (FrameContext& frame : frames)
+	{
+		vkDestroyBuffer(mainDevice.logicalDevice, frame.vpUniformBuffer, nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, frame.vpUniformBufferMemory);
+		vkDestroyBuffer(mainDevice.logicalDevice, frame.mUniformBufferDynamic, nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, frame.mUniformBufferMemory);
+		vkDestroySemaphore(mainDevice.logicalDevice, frame.finishRender, nullptr);
+		vkDestroySemaphore(mainDevice.logicalDevice, frame.imageAvailable, nullptr);
+		vkDestroyFence(mainDevice.logicalDevice, frame.drawFence, nullptr);
+		vkDestroyCommandPool(mainDevice.logicalDevice, frame.commandPool, nullptr);
+	}
+	frames.clear();
+}
+
 void VulkanRenderer::createTextureSampler()
+{
+	textureSampler = createSampler(16.0f);
+	// Atlas textures sit next to each other in a layer, the anisotropic footprint has to stay inside the gutter
+	packedTextureSampler = createSampler(TEXTURE_ATLAS_MAX_ANISOTROPY);
+}
+
+VkSampler VulkanRenderer::createSampler(float maxAnisotropy)
 {
 	// Sampler Creation Info
 	VkSamplerCreateInfo samplerCreateInfo = {};
@@ -1045,14 +1782,16 @@ void VulkanRenderer::createTextureSampler()
 	samplerCreateInfo.minLod = 0.0f;									// Minimum Level of Detail to pick mip level
 	samplerCreateInfo.maxLod = 0.0f;									// Maximum Level of Detail to pick mip level
 	samplerCreateInfo.anisotropyEnable = VK_TRUE;						// Enable Anisotropy
-	samplerCreateInfo.maxAnisotropy = 16;								// Anisotropy sample level
+	samplerCreateInfo.maxAnisotropy = maxAnisotropy;					// Anisotropy sample level
 
+	VkSampler sampler;
 	VkResult result = vkCreateSampler(mainDevice.logicalDevice, &samplerCreateInfo, nullptr, 
-		&textureSampler);
+		&sampler);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Filed to create a Texture Sampler!");
 	}
+	return sampler;
 }
 
 void VulkanRenderer::createUniformBuffers()
@@ -1060,21 +1799,22 @@ void VulkanRenderer::createUniformBuffers()
 	VkDeviceSize viewProjectionBufferSize = sizeof(UboViewProjection);
 	VkDeviceSize modelBufferSize = static_cast<uint32_t>(modelUniformAlignment) * MAX_OBJECTS;		// Dynamic buffer size
 
-	// One uniform buffer for each image (and by extension, command buffer)
-	vpUniformBuffer.resize(swapChainImages.size());
-	vpUniformBufferMemory.resize(swapChainImages.size());
-	mUniformBufferDynamic.resize(swapChainImages.size());
-	mUniformBufferMemory.resize(swapChainImages.size());
-	
-	for (size_t i = 0; i < swapChainImages.size(); i++)
+	// One uniform buffer for each frame in flight, only the CPU writes of a finished frame can overwrite them
+	for (FrameContext& frame : frames)
 	{	
 		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, viewProjectionBufferSize,								// Create Uniform buffers, allocate memory, and bind them
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,		// set the uniform buffer as HOST_VISIBLE since this could be updated very often
-			&vpUniformBuffer[i], &vpUniformBufferMemory[i]);
+			&frame.vpUniformBuffer, &frame.vpUniformBufferMemory, MEMORY_CATEGORY_UNIFORMS);
 
 		createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, modelBufferSize,
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,		// VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT also fits dynamic uniform buffer
-			&mUniformBufferDynamic[i], &mUniformBufferMemory[i]);
+			&frame.mUniformBufferDynamic, &frame.mUniformBufferMemory, MEMORY_CATEGORY_UNIFORMS);
+		if (DebugUtils::isEnabled())
+		{
+			std::string frameName = ", frame " + std::to_string(&frame - frames.data());
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_BUFFER, frame.vpUniformBuffer, "View projection UBO" + frameName);
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_BUFFER, frame.mUniformBufferDynamic, "Model dynamic UBO" + frameName);
+		}
 	}
 }
 
@@ -1086,18 +1826,18 @@ void VulkanRenderer::createDescriptorPool()
 	// View projection pool
 	VkDescriptorPoolSize vpPoolSize = {};
 	vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vpPoolSize.descriptorCount = static_cast<uint32_t>(vpUniformBuffer.size());
+	vpPoolSize.descriptorCount = static_cast<uint32_t>(frames.size());
 	// Model pool (Dynamic)
 	VkDescriptorPoolSize mPoolSize = {};
 	mPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;					// Uniform buffer dynamic
-	mPoolSize.descriptorCount = static_cast<uint32_t>(mUniformBufferDynamic.size());
+	mPoolSize.descriptorCount = static_cast<uint32_t>(frames.size());
 
 	std::vector<VkDescriptorPoolSize> descriptorPoolSizes = {vpPoolSize, mPoolSize};
 
 	// Data to create Descriptor Pool
 	VkDescriptorPoolCreateInfo poolCreateInfo = {};
 	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	poolCreateInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());					// [note]: 1 descriptorSet to 1 swapchainImage; Maximum number of Descriptor Sets that can be created from pool
+	poolCreateInfo.maxSets = static_cast<uint32_t>(frames.size());							// [note]: 1 descriptorSet to 1 frame in flight; Maximum number of Descriptor Sets that can be created from pool
 	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());		// Amount of Pool Sizes being passed
 	poolCreateInfo.pPoolSizes = descriptorPoolSizes.data();									// Pool Sizes to create pool with
 
@@ -1116,6 +1856,7 @@ void VulkanRenderer::createDescriptorPool()
 
 	VkDescriptorPoolCreateInfo samplerPoolCreateInfo = {};
 	samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	samplerPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;		// A hot reloaded texture frees the set it replaces
 	samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
 	samplerPoolCreateInfo.poolSizeCount = 1;
 	samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
@@ -1131,11 +1872,11 @@ void VulkanRenderer::createDescriptorPool()
 	// - Colour Attachment Pool Size
 	VkDescriptorPoolSize subpassColourInputPoolSize = {};
 	subpassColourInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	subpassColourInputPoolSize.descriptorCount = static_cast<uint32_t>(colorBufferImageView.size());	// = swapchainImageView.size()
+	subpassColourInputPoolSize.descriptorCount = static_cast<uint32_t>(colorBufferImageView.size());	// = frames.size()
 	// - Depth Attachment Pool Size
 	VkDescriptorPoolSize subpassDepthInputPoolSize = {};
 	subpassDepthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	subpassDepthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView.size());		// = swapchainImageView.size()
+	subpassDepthInputPoolSize.descriptorCount = static_cast<uint32_t>(depthBufferImageView.size());		// = frames.size()
 
 	std::vector<VkDescriptorPoolSize> subpassInputDescriptorPoolSizes = { subpassColourInputPoolSize, 
 		subpassDepthInputPoolSize };
@@ -1143,7 +1884,7 @@ void VulkanRenderer::createDescriptorPool()
 	// Create input attachment pool
 	VkDescriptorPoolCreateInfo subpassInputPoolCreateInfo = {};
 	subpassInputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	subpassInputPoolCreateInfo.maxSets = swapChainImages.size();
+	subpassInputPoolCreateInfo.maxSets = static_cast<uint32_t>(frames.size());
 	subpassInputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(subpassInputDescriptorPoolSizes.size());
 	subpassInputPoolCreateInfo.pPoolSizes = subpassInputDescriptorPoolSizes.data();
 
@@ -1154,20 +1895,45 @@ void VulkanRenderer::createDescriptorPool()
 		throw std::runtime_error("Failed to create a Descriptor Pool!");
 	}
 
+	// MESHLET CULLING DESCRIPTOR POOL ==============================================================
+	// 1 set per culled mesh: meshlets + source indices (storage), culled output (dynamic storage)
+	VkDescriptorPoolSize meshletStoragePoolSize = {};
+	meshletStoragePoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	meshletStoragePoolSize.descriptorCount = 2 * MAX_CULLED_MESHES;
+	VkDescriptorPoolSize meshletOutputPoolSize = {};
+	meshletOutputPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	meshletOutputPoolSize.descriptorCount = MAX_CULLED_MESHES;
+
+	std::array<VkDescriptorPoolSize, 2> meshletCullPoolSizes = { meshletStoragePoolSize, meshletOutputPoolSize };
+
+	VkDescriptorPoolCreateInfo meshletCullPoolCreateInfo = {};
+	meshletCullPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	meshletCullPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;	// Freed with the meshes a hot reload replaces
+	meshletCullPoolCreateInfo.maxSets = MAX_CULLED_MESHES;
+	meshletCullPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(meshletCullPoolSizes.size());
+	meshletCullPoolCreateInfo.pPoolSizes = meshletCullPoolSizes.data();
+
+	result = vkCreateDescriptorPool(mainDevice.logicalDevice, &meshletCullPoolCreateInfo, nullptr,
+		&meshletCullDescriptorPool);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Descriptor Pool!");
+	}
+
 }
 
 void VulkanRenderer::allocateDescriptorSets()
 {
-	// Resize Descriptor Set list so one for every buffer; 1 descriptorSet to 1 swapchainImage
-	descriptorSets.resize(swapChainImages.size());
+	// 1 descriptorSet to 1 frame in flight
+	std::vector<VkDescriptorSet> descriptorSets(frames.size());
 
-	std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), descriptorSetLayout);	// in vk 1 swapChain image to 1 uniform buffer, 1 uniform buffer to 1 descriptor set, 1 descriptor set to 1 descriptor set layout. That's why the vector here
+	std::vector<VkDescriptorSetLayout> setLayouts(frames.size(), descriptorSetLayout);	// in vk 1 frame in flight to 1 uniform buffer, 1 uniform buffer to 1 descriptor set, 1 descriptor set to 1 descriptor set layout. That's why the vector here
 
 	// Descriptor Set Allocation Info
 	VkDescriptorSetAllocateInfo setAllocInfo = {};
 	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	setAllocInfo.descriptorPool = descriptorPool;									// Pool to allocate Descriptor Set from
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());	// Number of sets to allocate
+	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(frames.size());			// Number of sets to allocate
 	setAllocInfo.pSetLayouts = setLayouts.data();									// Layouts to use to allocate sets (1 to 1 relationship)
 
 	// Allocate descriptor sets (multiple)
@@ -1178,11 +1944,18 @@ void VulkanRenderer::allocateDescriptorSets()
 	}
 
 	// Connect the created descriptor sets with the actual uniform buffer data
-	for (size_t i = 0; i < swapChainImages.size(); i++)
+	for (size_t i = 0; i < frames.size(); i++)
 	{
+		frames[i].descriptorSet = descriptorSets[i];
+		if (DebugUtils::isEnabled())
+		{
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, descriptorSets[i],
+				"Uniform set, frame " + std::to_string(i));
+		}
+
 		// View Projection Descriptor
 		VkDescriptorBufferInfo vpBufferInfo = {};
-		vpBufferInfo.buffer = vpUniformBuffer[i];							// Buffer to get data from
+		vpBufferInfo.buffer = frames[i].vpUniformBuffer;							// Buffer to get data from
 		vpBufferInfo.offset = 0;											// Position of start of data
 		vpBufferInfo.range = sizeof(UboViewProjection);						// Size of data
 		// Data about connection between binding and buffer
@@ -1197,7 +1970,7 @@ void VulkanRenderer::allocateDescriptorSets()
 
 		// Model Descriptor
 		VkDescriptorBufferInfo mBufferInfo = {};
-		mBufferInfo.buffer = mUniformBufferDynamic[i];		
+		mBufferInfo.buffer = frames[i].mUniformBufferDynamic;
 		mBufferInfo.offset = 0;						
 		mBufferInfo.range = modelUniformAlignment;				
 		// Data about connection between binding and buffer
@@ -1221,17 +1994,17 @@ void VulkanRenderer::allocateDescriptorSets()
 
 void VulkanRenderer::allocateSubpassInputDescriptorSets()
 {
-	// Resize array to hold descriptor set for each swap chain image
-	subpassInputDescritporSets.resize(swapChainImages.size());
+	// Resize array to hold descriptor set for each frame in flight (1 per colour + depth attachment set)
+	subpassInputDescritporSets.resize(frames.size());
 
 	// Fill array of layouts ready for set creation
-	std::vector<VkDescriptorSetLayout> setLayouts(swapChainImages.size(), subpassInputSetLayout);
+	std::vector<VkDescriptorSetLayout> setLayouts(frames.size(), subpassInputSetLayout);
 
 	// Input Attachment Descriptor Set Allocation Info
 	VkDescriptorSetAllocateInfo setAllocInfo = {};
 	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	setAllocInfo.descriptorPool = subpassInputDescriptorPool;
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
+	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(frames.size());
 	setAllocInfo.pSetLayouts = setLayouts.data();
 
 	// Allocate Descriptor Sets
@@ -1242,9 +2015,22 @@ void VulkanRenderer::allocateSubpassInputDescriptorSets()
 	{
 		throw std::runtime_error("Failed to allocate Input Attachment Descriptor Sets!");
 	}
+	if (DebugUtils::isEnabled())
+	{
+		for (size_t i = 0; i < subpassInputDescritporSets.size(); i++)
+		{
+			DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, subpassInputDescritporSets[i],
+				"Subpass input set, frame " + std::to_string(i));
+		}
+	}
+
+	updateSubpassInputDescriptorSets();
+}
 
-	// Update each descriptor set with input attachment
-	for (size_t i = 0; i < swapChainImages.size(); i++)
+void VulkanRenderer::updateSubpassInputDescriptorSets()
+{
+	// Update each descriptor set with input attachment, also called when the attachments are recreated on resize
+	for (size_t i = 0; i < frames.size(); i++)
 	{
 		// Colour Attachment Descriptor
 		VkDescriptorImageInfo colourAttachmentDescriptor = {};
@@ -1287,12 +2073,161 @@ void VulkanRenderer::allocateSubpassInputDescriptorSets()
 	}
 }
 
+void VulkanRenderer::allocateMeshletCullDescriptorSet(Mesh* mesh)
+{
+	if (!meshletCullingEnabled || mesh->getMeshletCount() == 0) return;
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = meshletCullDescriptorPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &meshletCullSetLayout;
+
+	// Pool exhausted: the mesh simply keeps drawing without culling
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(mainDevice.logicalDevice, &setAllocInfo, &descriptorSet);
+	if (result != VK_SUCCESS)
+	{
+		return;
+	}
+
+	// 1 output slot per frame in flight, same as the uniform buffers
+	mesh->createCullOutputBuffer(frames.size(), minStorageBufferOffset);
+	if (!mesh->getDebugName().empty())
+	{
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, descriptorSet,
+			mesh->getDebugName() + " cull set");
+	}
+
+	// Meshlet bounds
+	VkDescriptorBufferInfo meshletBufferInfo = {};
+	meshletBufferInfo.buffer = mesh->getMeshletBuffer();
+	meshletBufferInfo.offset = 0;
+	meshletBufferInfo.range = VK_WHOLE_SIZE;
+	// LOD 0 range of the index buffer
+	VkDescriptorBufferInfo indexBufferInfo = {};
+	indexBufferInfo.buffer = mesh->getIndexBuffer();
+	indexBufferInfo.offset = 0;
+	indexBufferInfo.range = sizeof(uint32_t) * static_cast<VkDeviceSize>(mesh->getLod(0).indexCount);
+	// One frame slot of the output, the slot is chosen by the dynamic offset
+	VkDescriptorBufferInfo outputBufferInfo = {};
+	outputBufferInfo.buffer = mesh->getCullOutputBuffer();
+	outputBufferInfo.offset = 0;
+	outputBufferInfo.range = mesh->getCullOutputSlotSize();
+
+	std::array<VkWriteDescriptorSet, 3> setWrites = {};
+	std::array<VkDescriptorBufferInfo*, 3> bufferInfos = { &meshletBufferInfo, &indexBufferInfo, &outputBufferInfo };
+	for (size_t i = 0; i < setWrites.size(); i++)
+	{
+		setWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		setWrites[i].dstSet = descriptorSet;
+		setWrites[i].dstBinding = static_cast<uint32_t>(i);
+		setWrites[i].dstArrayElement = 0;
+		setWrites[i].descriptorType = (i == 2) ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		setWrites[i].descriptorCount = 1;
+		setWrites[i].pBufferInfo = bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()),
+		setWrites.data(), 0, nullptr);
+
+	mesh->setCullDescriptorSet(descriptorSet);
+}
+
+void VulkanRenderer::recordMeshletCulling(VkCommandBuffer commandBuffer)
+{
+	// Reset the draw command of every culled mesh: indexCount = 0, instanceCount = 1
+	const uint32_t drawHeader[CULL_OUTPUT_HEADER_SIZE / sizeof(uint32_t)] = { 0, 1, 0, 0, 0, 0, 0, 0 };
+	uint32_t uploadZone = gpuProfiler.beginZone(commandBuffer, "Cull output reset upload");
+	bool anyCulled = false;
+	for (auto& importMesh : importMeshList)
+	{
+		for (size_t l = 0; l < importMesh.getMeshCount(); l++)
+		{
+			Mesh* mesh = importMesh.getMesh(l);
+			if (!mesh->usesMeshletCulling()) continue;
+			vkCmdUpdateBuffer(commandBuffer, mesh->getCullOutputBuffer(), mesh->getCullOutputSlotSize() * currentFrame,
+				CULL_OUTPUT_HEADER_SIZE, drawHeader);
+			anyCulled = true;
+		}
+	}
+	gpuProfiler.endZone(commandBuffer, uploadZone);
+	if (!anyCulled) return;
+
+	// Reset must land before the shader's atomicAdd
+	VkMemoryBarrier resetBarrier = {};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipeline);
+
+	glm::vec3 cameraWorldPosition = glm::vec3(glm::inverse(uboViewProjection.view)[3]);
+
+	for (auto& importMesh : importMeshList)
+	{
+		glm::mat4 modelMat = importMesh.getModel().model;
+
+		// Frustum planes straight from the clip matrix (Gribb/Hartmann), already in object space since the model matrix is included.
+		// Vulkan clip space depth is 0..w so the near plane is row 2 alone
+		glm::mat4 clipMat = uboViewProjection.projectsion * uboViewProjection.view * modelMat;
+		glm::vec4 row0 = glm::vec4(clipMat[0][0], clipMat[1][0], clipMat[2][0], clipMat[3][0]);
+		glm::vec4 row1 = glm::vec4(clipMat[0][1], clipMat[1][1], clipMat[2][1], clipMat[3][1]);
+		glm::vec4 row2 = glm::vec4(clipMat[0][2], clipMat[1][2], clipMat[2][2], clipMat[3][2]);
+		glm::vec4 row3 = glm::vec4(clipMat[0][3], clipMat[1][3], clipMat[2][3], clipMat[3][3]);
+
+		MeshletCullPushConst cullData = {};
+		cullData.frustumPlanes[0] = row3 + row0;		// Left
+		cullData.frustumPlanes[1] = row3 - row0;		// Right
+		cullData.frustumPlanes[2] = row3 + row1;		// Bottom
+		cullData.frustumPlanes[3] = row3 - row1;		// Top
+		cullData.frustumPlanes[4] = row2;				// Near
+		cullData.frustumPlanes[5] = row3 - row2;		// Far
+		for (glm::vec4& plane : cullData.frustumPlanes)
+		{
+			plane /= glm::length(glm::vec3(plane));		// Normalize so the sphere test compares real distances
+		}
+		// Camera in object space for the normal cone test (assumes the model matrix has no non-uniform scale)
+		cullData.cameraPosition = glm::inverse(modelMat) * glm::vec4(cameraWorldPosition, 1.0f);
+
+		for (size_t l = 0; l < importMesh.getMeshCount(); l++)
+		{
+			Mesh* mesh = importMesh.getMesh(l);
+			if (!mesh->usesMeshletCulling()) continue;
+
+			cullData.meshletCount = mesh->getMeshletCount();
+			vkCmdPushConstants(commandBuffer, meshletCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+				0, sizeof(MeshletCullPushConst), &cullData);
+
+			VkDescriptorSet cullDescriptorSet = mesh->getCullDescriptorSet();
+			uint32_t dynamicOffset = static_cast<uint32_t>(mesh->getCullOutputSlotSize() * currentFrame);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletCullPipelineLayout,
+				0, 1, &cullDescriptorSet, 1, &dynamicOffset);
+
+			vkCmdDispatch(commandBuffer, mesh->getMeshletCount(), 1, 1);		// 1 workgroup per meshlet
+		}
+	}
+
+	// Culled indices and draw commands must be written before the draws consume them
+	VkMemoryBarrier cullBarrier = {};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
 void VulkanRenderer::recordCommands(uint32_t swapchainImageIndex)
 {
+	CPU_PROFILE_ZONE("recordCommands");
+
 	// Information about how to begin each command buffer
 	VkCommandBufferBeginInfo bufferBeginInfo = {};
 	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	//bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;	// Buffer can be resubmitted when it has already been submitted and is awaiting execution
+	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;		// Re-recorded every frame, submitted once
 
 	// Information about how to begin a render pass (only needed for graphical applications)
 	VkRenderPassBeginInfo renderPassBeginInfo = {};
@@ -1308,110 +2243,276 @@ void VulkanRenderer::recordCommands(uint32_t swapchainImageIndex)
 
 	renderPassBeginInfo.pClearValues = clearValues.data();							// List of clear values (TODO: Depth Attachment Clear Value)
 	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassBeginInfo.framebuffer = swapChainFramebuffers[swapchainImageIndex];
+	renderPassBeginInfo.framebuffer = getFramebuffer(swapchainImageIndex);
 
-	// Start recording commands to command buffer. [note]: vkBeginCommandBuffer() implicitly have the input commandBuffer reset, should explicitly set it in the createCommandPoolInfo (VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)
-	VkResult result = vkBeginCommandBuffer(commandBuffers[swapchainImageIndex], &bufferBeginInfo);
+	// Start recording commands to the frame's command buffer. [note]: the frame's pool was reset in draw(), so the buffer starts out empty
+	VkCommandBuffer commandBuffer = frames[currentFrame].commandBuffer;
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to start recording a Command Buffer!");
 	}
 
+		drawCount = 0;
+		prepassDrawCount = 0;
+		textureBindCount = 0;
+
+		// Read back the timestamps this frame slot wrote last time, reset its queries
+		gpuProfiler.beginFrame(commandBuffer, currentFrame,
+			static_cast<uint64_t>(swapChainExtent.width) * swapChainExtent.height);
+		uint32_t frameZone = gpuProfiler.beginZone(commandBuffer, "Frame");
+		DebugUtils::beginLabel(commandBuffer, "Frame", 0.8f, 0.8f, 0.8f);
+
+		// Pick the level of detail of every mesh first, the meshlet culling pass only runs on meshes drawn at LOD 0.
+		// Every mesh only writes its own LOD, big scenes are spread over the job system
+		JobSystem::parallelFor(importMeshList.size(), LOD_SELECTION_GRAIN_SIZE, [this](size_t begin, size_t end) {
+			for (size_t k = begin; k < end; k++)
+			{
+				ImportMesh& importMesh = importMeshList[k];
+				for (size_t l = 0; l < importMesh.getMeshCount(); l++)
+				{
+					selectMeshLod(importMesh.getMesh(l), importMesh.getModel().model);
+				}
+			}
+		});
+
+		// Meshlet culling has to be recorded outside of the render pass
+		if (meshletCullingEnabled)
+		{
+			uint32_t cullZone = gpuProfiler.beginZone(commandBuffer, "Meshlet culling");
+			DebugUtils::beginLabel(commandBuffer, "Meshlet culling", 0.9f, 0.6f, 0.2f);
+			recordMeshletCulling(commandBuffer);
+			DebugUtils::endLabel(commandBuffer);
+			gpuProfiler.endZone(commandBuffer, cullZone);
+		}
+
 		// Begin Render Pass, this will apply the colourAttachment.loadOp in createRenderPass()
-		vkCmdBeginRenderPass(commandBuffers[swapchainImageIndex], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			// Viewport and scissor are dynamic in every pipeline, so the pipelines survive a resize
+			VkViewport viewport = { 0.0f, 0.0f, (float)swapChainExtent.width, (float)swapChainExtent.height, 0.0f, 1.0f };
+			VkRect2D scissor = { { 0, 0 }, swapChainExtent };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			// Depth Pre-pass ==========================================================================
+			// Same meshes, LODs and culled index buffers as subpass 0, positions only. Left empty when the pre-pass is off
+			if (depthPrepassEnabled)
+			{
+				uint32_t prepassZone = gpuProfiler.beginZone(commandBuffer, "Depth pre-pass");
+				uint32_t prepassStatistics = gpuProfiler.beginStatistics(commandBuffer, "Depth pre-pass");
+				DebugUtils::beginLabel(commandBuffer, "Depth pre-pass", 0.5f, 0.5f, 0.5f);
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassPipeline);
+
+				for (size_t k = 0; k < importMeshList.size(); k++) {
+					uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment * k);
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						pipelineLayout, 0, 1, &frames[currentFrame].descriptorSet, 1, &dynamicOffset);
+
+					for (size_t l = 0; l < importMeshList[k].getMeshCount(); l++) {
+						recordMeshDraw(commandBuffer, importMeshList[k].getMesh(l));
+						prepassDrawCount++;
+					}
+				}
+
+				DebugUtils::endLabel(commandBuffer);
+				gpuProfiler.endStatistics(commandBuffer, prepassStatistics);
+				gpuProfiler.endZone(commandBuffer, prepassZone);
+			}
 			
 			// Start Subpass 0 =========================================================================
-			// Bind Pipeline to be used in render pass
-			vkCmdBindPipeline(commandBuffers[swapchainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			uint32_t subpass0Zone = gpuProfiler.beginZone(commandBuffer, "Subpass 0");
+			uint32_t subpass0Statistics = gpuProfiler.beginStatistics(commandBuffer, "Subpass 0");
+			DebugUtils::beginLabel(commandBuffer, "Subpass 0", 0.2f, 0.6f, 0.9f);
+			// Bind Pipeline to be used in render pass, after the pre-pass only the fragments on the closest surface are shaded
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+				depthPrepassEnabled ? depthEqualGraphicsPipeline : graphicsPipeline);
+
+			// Texture set and layer only change when a draw samples another texture, the meshes of a model with packed textures
+			// share 1 texture array
+			int boundTextureIndex = -1;
+			uint32_t boundTextureLayer = UINT32_MAX;
 
 			//// Import Model Mesh List
 			for (size_t k = 0; k < importMeshList.size(); k++) {
 
-				ImportMesh meshTemp = importMeshList[k];
-				// Push Constant
-				PushConstBlock pushConstData = {};
-				pushConstData.pushConstData = glm::vec3(1.0f);
-				//PushConstBlock pushData = meshList[k].getPushConstData();
-				vkCmdPushConstants(commandBuffers[swapchainImageIndex],	//
-					pipelineLayout,											//
-					VK_SHADER_STAGE_VERTEX_BIT,								// Shader stage to pass
-					0,														// Offset of push constant
-					sizeof(PushConstBlock),										// Actual size of data
-					&pushConstData);								// Ptr of data to be pushed
-
-				for (size_t l = 0; l < meshTemp.getMeshCount(); l++) {
+				ImportMesh& meshTemp = importMeshList[k];					// Reference, the LOD picked for each mesh is kept for next frame's hysteresis
+				uint32_t drawGroupZone = gpuProfiler.getProfileDrawGroups() ?
+					gpuProfiler.beginZone(commandBuffer, "ImportMesh " + std::to_string(k)) : UINT32_MAX;
+				if (DebugUtils::isEnabled())
+				{
+					DebugUtils::beginLabel(commandBuffer, ("ImportMesh " + std::to_string(k)).c_str(), 0.3f, 0.8f, 0.4f);
+				}
 
-					// Get the buffer to be bound in the pipeline
-					VkBuffer vertexBuffers[] = { meshTemp.getMesh(l)->getVertexBuffer() };						// buffers to bind
-					VkDeviceSize offsets[] = { 0 };												// Offsets into buffers being bound
-					vkCmdBindVertexBuffers(commandBuffers[swapchainImageIndex], 0, 1, vertexBuffers, offsets);	// cmd to bind vertex buffer before drawing
+				// Dynamic Offset Amount for dynamic descriptor set
+				uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment * k);
+				// Bind the uniform set of the model, set 1 stays bound (same pipeline layout)
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					pipelineLayout, 0, 1, &frames[currentFrame].descriptorSet, 1, &dynamicOffset);	// The dynamicOffset will not be indiscriminatedly applied to all the descriptor set, only on those with DYNAMIC flags
 
-					// Bind index buffer
-					vkCmdBindIndexBuffer(commandBuffers[swapchainImageIndex], 
-						meshTemp.getMesh(l)->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				for (size_t l = 0; l < meshTemp.getMeshCount(); l++) {
 
-					std::array<VkDescriptorSet, 2> descriptorSetGroup = { descriptorSets[swapchainImageIndex],
-						samplerDescriptorSets[meshTemp.getMesh(l)->getTextureIndex()] };
-
-					// Dynamic Offset Amount for dynamic descriptor set
-					uint32_t dynamicOffset = static_cast<uint32_t>(modelUniformAlignment * k);
-					// Bind Descriptor Sets
-					vkCmdBindDescriptorSets(commandBuffers[swapchainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS,
-						pipelineLayout, 0, static_cast<uint32_t>(descriptorSetGroup.size()),
-						descriptorSetGroup.data(), 1, &dynamicOffset);				// The dynamicOffset will not be indiscriminatedly applied to all the descriptor set, only on those with DYNAMIC flags
+					Mesh* mesh = meshTemp.getMesh(l);
+
+					// Bind the texture set, then the layer to sample in it
+					if (mesh->getTextureIndex() != boundTextureIndex)
+					{
+						boundTextureIndex = mesh->getTextureIndex();
+						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+							pipelineLayout, 1, 1, &samplerDescriptorSets[boundTextureIndex], 0, nullptr);
+						textureBindCount++;
+					}
+					if (mesh->getTextureLayer() != boundTextureLayer)
+					{
+						DrawPushConst drawPushConst = { mesh->getTextureLayer() };
+						boundTextureLayer = drawPushConst.textureLayer;
+						vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+							0, sizeof(DrawPushConst), &drawPushConst);
+					}
 
 					// Execute pipeline
-					// vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(mesh.getVertexCount()), 1, 0, 0);	// A vertex draw method
-					vkCmdDrawIndexed(commandBuffers[swapchainImageIndex], 
-						meshTemp.getMesh(l)->getIndexCount(), 1, 0, 0, 0);					// An index draw method
+					recordMeshDraw(commandBuffer, mesh);
+					drawCount++;
 				}
+
+				DebugUtils::endLabel(commandBuffer);
+				gpuProfiler.endZone(commandBuffer, drawGroupZone);
 			}
+			DebugUtils::endLabel(commandBuffer);
+			gpuProfiler.endStatistics(commandBuffer, subpass0Statistics);
+			gpuProfiler.endZone(commandBuffer, subpass0Zone);
 
 			// Start Subpass 1 ==================================================================
-			vkCmdNextSubpass(commandBuffers[swapchainImageIndex], VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+			uint32_t subpass1Zone = gpuProfiler.beginZone(commandBuffer, "Subpass 1");
+			uint32_t subpass1Statistics = gpuProfiler.beginStatistics(commandBuffer, "Subpass 1");
+			DebugUtils::beginLabel(commandBuffer, "Subpass 1", 0.6f, 0.3f, 0.9f);
 
-			vkCmdBindPipeline(commandBuffers[swapchainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, 
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
 				subpass1GraphicsPipeline);
-			vkCmdBindDescriptorSets(commandBuffers[swapchainImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, 
-				subpass1PipelineLayout, 0, 1, &subpassInputDescritporSets[swapchainImageIndex], 0, nullptr);
-			vkCmdDraw(commandBuffers[swapchainImageIndex], 3, 1, 0, 0);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
+				subpass1PipelineLayout, 0, 1, &subpassInputDescritporSets[currentFrame], 0, nullptr);
+			CompositePushConst compositePushConst = { static_cast<float>(swapChainExtent.width) };
+			vkCmdPushConstants(commandBuffer, subpass1PipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+				0, sizeof(CompositePushConst), &compositePushConst);
+			vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+			drawCount++;
+			DebugUtils::endLabel(commandBuffer);
+			gpuProfiler.endStatistics(commandBuffer, subpass1Statistics);
+			gpuProfiler.endZone(commandBuffer, subpass1Zone);
+
+		// End Render Pass
+		vkCmdEndRenderPass(commandBuffer);
+		DebugUtils::endLabel(commandBuffer);
+		gpuProfiler.endZone(commandBuffer, frameZone);
+
+
+
+	// Stop recording to command buffer
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to stop recording a Command Buffer!");
+	}
+	
+}
+
+void VulkanRenderer::recordMeshDraw(VkCommandBuffer commandBuffer, Mesh* mesh)
+{
+	// Get the buffer to be bound in the pipeline
+	VkBuffer vertexBuffers[] = { mesh->getVertexBuffer() };						// buffers to bind
+	VkDeviceSize offsets[] = { 0 };												// Offsets into buffers being bound
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);	// cmd to bind vertex buffer before drawing
+
+	// Bind index buffer, the culled one written by the meshlet culling pass when it ran for this mesh
+	VkDeviceSize cullSlotOffset = mesh->getCullOutputSlotSize() * currentFrame;
+	if (mesh->usesMeshletCulling())
+	{
+		vkCmdBindIndexBuffer(commandBuffer,
+			mesh->getCullOutputBuffer(), cullSlotOffset + CULL_OUTPUT_HEADER_SIZE, VK_INDEX_TYPE_UINT32);
+	}
+	else
+	{
+		vkCmdBindIndexBuffer(commandBuffer,
+			mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
 
-		// End Render Pass
-		vkCmdEndRenderPass(commandBuffers[swapchainImageIndex]);
+	// vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(mesh.getVertexCount()), 1, 0, 0);	// A vertex draw method
+	if (mesh->usesMeshletCulling())
+	{
+		// Index count of the surviving meshlets comes from the culling pass
+		vkCmdDrawIndexedIndirect(commandBuffer, mesh->getCullOutputBuffer(),
+			cullSlotOffset, 1, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else
+	{
+		// Level of detail picked before the render pass, all levels live in the same index buffer
+		const MeshLod& lod = mesh->getLod(mesh->getCurrentLod());
+		vkCmdDrawIndexed(commandBuffer, 
+			lod.indexCount, 1, lod.firstIndex, 0, 0);					// An index draw method
+	}
+}
 
+int VulkanRenderer::selectMeshLod(Mesh* mesh, const glm::mat4& modelMat)
+{
+	int lodCount = mesh->getLodCount();
+	if (lodCount <= 1) return 0;
+
+	// Bounds in view space, the model matrix may scale so scale the radius and error with the largest axis
+	BoundingSphere bounds = mesh->getBounds();
+	float scale = std::max(glm::length(glm::vec3(modelMat[0])), 
+		std::max(glm::length(glm::vec3(modelMat[1])), glm::length(glm::vec3(modelMat[2]))));
+	glm::vec3 viewCenter = glm::vec3(uboViewProjection.view * modelMat * glm::vec4(bounds.center, 1.0f));
+
+	// Distance to the closest point of the sphere, inside the sphere always use full resolution
+	float distance = glm::length(viewCenter) - bounds.radius * scale;
+	if (distance <= 0.0f)
+	{
+		mesh->setCurrentLod(0);
+		return 0;
+	}
 
+	// World space error -> pixels: error / distance gives the error in normalized device units (times projection[1][1]), then half the screen height in pixels
+	float pixelsPerUnit = std::abs(uboViewProjection.projectsion[1][1]) * 0.5f * static_cast<float>(swapChainExtent.height) / distance;
+	auto projectedError = [&](int level) { return mesh->getLod(level).error * scale * pixelsPerUnit; };
 
-	// Stop recording to command buffer
-	result = vkEndCommandBuffer(commandBuffers[swapchainImageIndex]);
-	if (result != VK_SUCCESS)
+	// Start from last frame's level, go finer while the error is visible, go coarser only when the next level is well below the threshold
+	int level = std::min(mesh->getCurrentLod(), lodCount - 1);
+	while (level > 0 && projectedError(level) > LOD_PIXEL_ERROR_THRESHOLD)
 	{
-		throw std::runtime_error("Failed to stop recording a Command Buffer!");
+		level--;
 	}
-	
+	while (level + 1 < lodCount && projectedError(level + 1) < LOD_PIXEL_ERROR_THRESHOLD * LOD_HYSTERESIS)
+	{
+		level++;
+	}
+
+	mesh->setCurrentLod(level);
+	return level;
 }
 
-void VulkanRenderer::updateUniformBuffers(uint32_t nextSwapChainImageIndex)		// this is called in draw()
+void VulkanRenderer::updateUniformBuffers(const FrameContext& frame)		// this is called in draw()
 {
+	CPU_PROFILE_ZONE("updateUniformBuffers");
+
 	// Copy VP data to the uniform buffer
 	void* data;
-	vkMapMemory(mainDevice.logicalDevice, vpUniformBufferMemory[nextSwapChainImageIndex], 0, 
+	vkMapMemory(mainDevice.logicalDevice, frame.vpUniformBufferMemory, 0, 
 		sizeof(UboViewProjection), 0, &data);
 	memcpy(data, &uboViewProjection, sizeof(UboViewProjection));
-	vkUnmapMemory(mainDevice.logicalDevice, vpUniformBufferMemory[nextSwapChainImageIndex]);
+	vkUnmapMemory(mainDevice.logicalDevice, frame.vpUniformBufferMemory);
 
 	// Prepare data ready to be copied to the dynamic uniform buffer
 	//for (size_t i = 0; i < meshList.size(); i++) {												// assign model information to the preparing memory allocated by _aligned_malloc() and then copy to the uniform buffer
 	//	Model* model = (Model*)((uint64_t)modelTransferSpace + (i * modelUniformAlignment));
 	//	*model = meshList[i].getModel();			
 	//}	
-	for (size_t i = 0; i < importMeshList.size(); i++) {												// assign model information to the preparing memory allocated by _aligned_malloc() and then copy to the uniform buffer
-		Model* model = (Model*)((uint64_t)modelTransferSpace + (i * modelUniformAlignment));
-		*model = importMeshList[i].getModel();
-	}												
-	vkMapMemory(mainDevice.logicalDevice, mUniformBufferMemory[nextSwapChainImageIndex], 0, 
+	ImportMesh::PackModels(importMeshList, modelTransferSpace, modelUniformAlignment);				// assign model information to the preparing memory allocated by _aligned_malloc() and then copy to the uniform buffer
+	vkMapMemory(mainDevice.logicalDevice, frame.mUniformBufferMemory, 0, 
 		modelUniformAlignment * importMeshList.size(), 0, &data);
 	memcpy(data, modelTransferSpace, modelUniformAlignment * importMeshList.size());
-	vkUnmapMemory(mainDevice.logicalDevice, mUniformBufferMemory[nextSwapChainImageIndex]);
+	vkUnmapMemory(mainDevice.logicalDevice, frame.mUniformBufferMemory);
 }
 
 void VulkanRenderer::createLogicalDevice()
@@ -1440,14 +2541,33 @@ void VulkanRenderer::createLogicalDevice()
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());			// Number of Queue Create Infos
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();									// List of queue create infos so device can create required queues, ckeck queue compatability by getQueueFamiliy() before assign here
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensionsNeeded.size());	// Number of enabled logical device extensions, check compatability in getPhysicalDevice() before assign here
-	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensionsNeeded.data();						// List of enabled logical device extensions
+	// Optional device extensions on top of the required ones
+	std::vector<const char*> deviceExtensions = deviceExtensionsNeeded;
+	std::vector<const char*> memoryBudgetExtension = { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME };
+	memoryBudgetEnabled = physicalDeviceProperties2Enabled
+		&& checkPhysicalDeviceExtensionSupport(mainDevice.physicalDevice, memoryBudgetExtension);
+	if (memoryBudgetEnabled)
+	{
+		deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());		// Number of enabled logical device extensions, check compatability in getPhysicalDevice() before assign here
+	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();								// List of enabled logical device extensions
 
 	// Physical Device Features the Logical Device will be using
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;						// Enable Anisotropy [note]: if this is not enabled, there will be error thrown when createTextureSampler() with anisotropy enabled
 	//deviceFeatures.depthClamp = VK_TRUE;
 
+	// Pipeline statistics queries are optional, only turned on when asked for and supported
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(mainDevice.physicalDevice, &supportedFeatures);
+	pipelineStatisticsEnabled = pipelineStatisticsRequested && supportedFeatures.pipelineStatisticsQuery;
+	deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsEnabled ? VK_TRUE : VK_FALSE;
+	if (pipelineStatisticsRequested && !pipelineStatisticsEnabled)
+	{
+		printf("Pipeline statistics queries not supported by this device, disabled\n");
+	}
+
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;			// Physical Device features Logical Device will use
 
 	// Create the logical device for the given physical device						//allocator
@@ -1494,6 +2614,7 @@ void VulkanRenderer::getPhysicalDevice()
 	vkGetPhysicalDeviceProperties(mainDevice.physicalDevice, &physicalDeviceProperty);
 
 	minUniformBufferOffset = physicalDeviceProperty.limits.minUniformBufferOffsetAlignment;
+	minStorageBufferOffset = physicalDeviceProperty.limits.minStorageBufferOffsetAlignment;
 }
 
 void VulkanRenderer::allocateDynamicBufferTransferSpace()
@@ -1554,7 +2675,7 @@ bool VulkanRenderer::checkPhysicalDeviceExtensionSupport(VkPhysicalDevice device
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensionsProvided.data());
 
 	// Check for extension
-	int extensionFoundCount = 0;
+	size_t extensionFoundCount = 0;
 	for (const char* deviceExtensionNeeded : deviceExtensionsNeeded)
 	{
 		for (const VkExtensionProperties& extensionProvided : extensionsProvided)
@@ -1566,7 +2687,7 @@ bool VulkanRenderer::checkPhysicalDeviceExtensionSupport(VkPhysicalDevice device
 			}
 		}
 	}
-	if (extensionCount < deviceExtensionsNeeded.size())
+	if (extensionFoundCount < deviceExtensionsNeeded.size())
 	{
 		return false;
 	}
@@ -1694,6 +2815,12 @@ VkSurfaceFormatKHR VulkanRenderer::chooseBestSurfaceFormat(const std::vector<VkS
 
 VkPresentModeKHR VulkanRenderer::chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& modes)
 {
+	// Low latency: FIFO, a queued frame is never replaced so the CPU pacing on the fence keeps exactly 1 frame queued
+	if (latencyProfile == LATENCY_PROFILE_LOW_LATENCY)
+	{
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
 	// Look for Mailbox presentation mode
 	for (const auto& presentationMode : modes)
 	{
@@ -1703,6 +2830,13 @@ VkPresentModeKHR VulkanRenderer::chooseBestPresentationMode(const std::vector<Vk
 		}
 	}
 
+	// Throughput: no vsync wait at all when mailbox is missing
+	if (latencyProfile == LATENCY_PROFILE_THROUGHPUT
+		&& std::find(modes.begin(), modes.end(), VK_PRESENT_MODE_IMMEDIATE_KHR) != modes.end())
+	{
+		return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+
 	// If can't find, use FIFO as Vulkan spec says it must be present
 	return VK_PRESENT_MODE_FIFO_KHR; //this is always available by default
 }
@@ -1758,12 +2892,13 @@ VkFormat VulkanRenderer::chooseSupportedFormat(const std::vector<VkFormat>& inFo
 	throw std::runtime_error("Failed to find a matching format!");
 }
 
-VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+	VkImageViewType viewType, uint32_t layerCount)
 {
 	VkImageViewCreateInfo viewCreateInfo = {};
 	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewCreateInfo.image = image;											// Image to create view for
-	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;						// Type of image (1D, 2D, 3D, Cube, etc)
+	viewCreateInfo.viewType = viewType;										// Type of image (1D, 2D, 3D, Cube, etc)
 	viewCreateInfo.format = format;											// Format of image data
 	viewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;			// Allows remapping of rgba components to other rgba values
 	viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -1775,7 +2910,7 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
 	viewCreateInfo.subresourceRange.baseMipLevel = 0;						// Start mipmap level to view from
 	viewCreateInfo.subresourceRange.levelCount = 1;							// Number of mipmap levels to view
 	viewCreateInfo.subresourceRange.baseArrayLayer = 0;						// Start array level to view from
-	viewCreateInfo.subresourceRange.layerCount = 1;							// Number of array levels to view
+	viewCreateInfo.subresourceRange.layerCount = layerCount;				// Number of array levels to view
 
 	// Create image view and return it
 	VkImageView imageView;
@@ -1788,13 +2923,13 @@ VkImageView VulkanRenderer::createImageView(VkImage image, VkFormat format, VkIm
 	return imageView;
 }
 
-VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
+VkShaderModule VulkanRenderer::createShaderModule(const std::vector<uint32_t>& code)
 {
 	// Shader Module creation information
 	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
 	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderModuleCreateInfo.codeSize = code.size();										// Size of code
-	shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());		// Pointer to code (of uint32_t pointer type)
+	shaderModuleCreateInfo.codeSize = code.size() * sizeof(uint32_t);					// Size of code in bytes
+	shaderModuleCreateInfo.pCode = code.data();											// Pointer to code
 
 	VkShaderModule shaderModule;
 	VkResult result = vkCreateShaderModule(mainDevice.logicalDevice, &shaderModuleCreateInfo, nullptr, &shaderModule);
@@ -1806,7 +2941,8 @@ VkShaderModule VulkanRenderer::createShaderModule(const std::vector<char>& code)
 	return shaderModule;
 }
 
-VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propertyFlags, VkDeviceMemory* outImageMemory)
+VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags useFlags, VkMemoryPropertyFlags propertyFlags, VkDeviceMemory* outImageMemory, MemoryCategory category,
+	uint32_t arrayLayers)
 {
 	// CREATE IMAGE
 	// Image Creation Info
@@ -1817,7 +2953,7 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
 	imageCreateInfo.extent.height = height;								// Height of image extent
 	imageCreateInfo.extent.depth = 1;									// Depth of image (just 1, no 3D aspect)
 	imageCreateInfo.mipLevels = 1;										// Number of mipmap levels
-	imageCreateInfo.arrayLayers = 1;									// Number of levels in image array
+	imageCreateInfo.arrayLayers = arrayLayers;							// Number of levels in image array
 	imageCreateInfo.format = format;									// Format type of image
 	imageCreateInfo.tiling = tiling;									// How image data should be "tiled" (arranged for optimal reading)
 	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;			// Layout of image data on creation, will be changed according to the layout dependencies specified in the pipeline creation
@@ -1838,6 +2974,13 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
 	VkMemoryRequirements memoryRequirements;
 	vkGetImageMemoryRequirements(mainDevice.logicalDevice, image, &memoryRequirements);
 
+	// Lazily allocated memory is optional (mostly tile based GPUs), fall back to plain device local memory
+	if ((propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+		&& !hasMemoryType(mainDevice.physicalDevice, memoryRequirements.memoryTypeBits, propertyFlags))
+	{
+		propertyFlags &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
 	// Allocate memory using image requirements and user defined properties
 	VkMemoryAllocateInfo memoryAllocInfo = {};
 	memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
@@ -1845,7 +2988,7 @@ VkImage VulkanRenderer::createImage(uint32_t width, uint32_t height, VkFormat fo
 	memoryAllocInfo.memoryTypeIndex = findMemoryTypeIndex(mainDevice.physicalDevice, 
 		memoryRequirements.memoryTypeBits, propertyFlags);
 
-	result = vkAllocateMemory(mainDevice.logicalDevice, &memoryAllocInfo, nullptr, outImageMemory);
+	result = MemoryTracker::allocateMemory(mainDevice.logicalDevice, memoryAllocInfo, category, outImageMemory);
 	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to allocate memory for image!");
@@ -1870,7 +3013,7 @@ int VulkanRenderer::createTextureImage(std::string fileName)
 	createBuffer(mainDevice.physicalDevice, mainDevice.logicalDevice, imageSize, 
 		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuffer, &imageStagingBufferMemory);
+		&imageStagingBuffer, &imageStagingBufferMemory, MEMORY_CATEGORY_STAGING);
 
 	// Copy image data to staging buffer
 	void* data;
@@ -1886,7 +3029,7 @@ int VulkanRenderer::createTextureImage(std::string fileName)
 	VkDeviceMemory texImageMemory;
 	texImage = createImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-		&texImageMemory);		//[note]: here we want to copy buffer to image, but copyBuffer() won't work since it's used for copy from buffer to buffer, here we want to copy to an image
+		&texImageMemory, MEMORY_CATEGORY_TEXTURES);		//[note]: here we want to copy buffer to image, but copyBuffer() won't work since it's used for copy from buffer to buffer, here we want to copy to an image
 
 
 	// COPY DATA TO IMAGE
@@ -1908,7 +3051,7 @@ int VulkanRenderer::createTextureImage(std::string fileName)
 
 	// Destroy staging buffers
 	vkDestroyBuffer(mainDevice.logicalDevice, imageStagingBuffer, nullptr);
-	vkFreeMemory(mainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
+	MemoryTracker::freeMemory(mainDevice.logicalDevice, imageStagingBufferMemory);
 
 	// Return index of new texture image
 	return textureImages.size() - 1;
@@ -1918,20 +3061,43 @@ int VulkanRenderer::createTexture(std::string fileName)
 {
 	// Create Texture Image and get its location in array
 	int textureImageIndex = createTextureImage(fileName);
+	assetWatcher.watch(ASSET_KIND_TEXTURE, fileName, "../Textures/" + fileName);
+
+	return createTextureDescriptor(textureImageIndex, fileName);
+}
 
+int VulkanRenderer::createTextureDescriptor(int textureImageIndex, const std::string& fileName, uint32_t layerCount, bool packed)
+{
 	// Create Image View and add to list
 	VkImageView imageView = createImageView(textureImages[textureImageIndex], VK_FORMAT_R8G8B8A8_UNORM, 
-		VK_IMAGE_ASPECT_COLOR_BIT);
+		VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D_ARRAY, layerCount);
 	textureImageViews.push_back(imageView);
 
 	// Create Texture Descriptor Set
-	int descriptorIndex = allocateTextureDescriptorSet(imageView);
+	int descriptorIndex = allocateTextureDescriptorSet(imageView, packed ? packedTextureSampler : textureSampler);
+
+	// Named after the source file in captures
+	if (DebugUtils::isEnabled())
+	{
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE, textureImages[textureImageIndex], fileName);
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW, imageView, fileName);
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, samplerDescriptorSets[descriptorIndex], fileName);
+	}
 
 	// Return location of set with texture
 	return descriptorIndex;
 }
 
-int VulkanRenderer::allocateTextureDescriptorSet(VkImageView textureImage)
+int VulkanRenderer::allocateTextureDescriptorSet(VkImageView textureImage, VkSampler sampler)
+{
+	// Add descriptor set to list
+	samplerDescriptorSets.push_back(createSamplerDescriptorSet(textureImage, sampler));
+
+	// Return descriptor set location
+	return samplerDescriptorSets.size() - 1;
+}
+
+VkDescriptorSet VulkanRenderer::createSamplerDescriptorSet(VkImageView textureImage, VkSampler sampler)
 {
 	VkDescriptorSet descriptorSet;
 
@@ -1953,7 +3119,7 @@ int VulkanRenderer::allocateTextureDescriptorSet(VkImageView textureImage)
 	VkDescriptorImageInfo imageInfo = {};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;	// Image layout when in use
 	imageInfo.imageView = textureImage;									// Image to bind to set
-	imageInfo.sampler = textureSampler;									// Sampler to use for set
+	imageInfo.sampler = sampler;										// Sampler to use for set
 
 	// Descriptor Write Info
 	VkWriteDescriptorSet descriptorWrite = {};
@@ -1968,19 +3134,21 @@ int VulkanRenderer::allocateTextureDescriptorSet(VkImageView textureImage)
 	// Update new descriptor set
 	vkUpdateDescriptorSets(mainDevice.logicalDevice, 1, &descriptorWrite, 0, nullptr);
 
-	// Add descriptor set to list
-	samplerDescriptorSets.push_back(descriptorSet);
-
-	// Return descriptor set location
-	return samplerDescriptorSets.size() - 1;
+	return descriptorSet;
 }
 
 void VulkanRenderer::addNCreateImportMesh(std::string meshFileName, glm::mat4 inModelMat)
 {
+	CPU_PROFILE_ZONE("addNCreateImportMesh");
+
 	// Import model "scene"
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile("../ImportObj/" + meshFileName, aiProcess_Triangulate | aiProcess_FlipUVs | 
-		aiProcess_JoinIdenticalVertices);
+	const aiScene* scene;
+	{
+		CPU_PROFILE_ZONE("Assimp ReadFile");
+		scene = importer.ReadFile(getMeshFilePath(meshFileName), aiProcess_Triangulate | aiProcess_FlipUVs | 
+			aiProcess_JoinIdenticalVertices);
+	}
 	if (!scene)
 	{
 		throw std::runtime_error("Failed to load model! (" + meshFileName + ")");
@@ -1991,18 +3159,56 @@ void VulkanRenderer::addNCreateImportMesh(std::string meshFileName, glm::mat4 in
 	std::vector<std::string> textureNames = ImportMesh::LoadMaterials(scene);
 	// - Conversion from the materials list IDs to samplerDescriptorSet Array Indices
 	std::vector<int> materialToSamplerDescriptorSetIndex(textureNames.size());
+	// - Packed: 1 texture array holds every texture of the model, materials get their layer + atlas rect
+	std::vector<TexturePlacement> materialPlacements;
+	std::string packedTextureName;
+	if (importOptions.packTextures)
+	{
+		CPU_PROFILE_ZONE("createPackedTexture");
+		std::vector<std::string> packedFileNames;
+		TexturePackLayout packLayout = ImportLoader::planTexturePack(textureNames, packedFileNames, materialPlacements);
+		if (!packedFileNames.empty())
+		{
+			packedTextureName = TexturePacker::getPackedName(meshFileName);
+			if (loadedTextures.count(packedTextureName) == 0)
+			{
+				StagingUploader uploader(mainDevice.physicalDevice, mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool);
+				DecodedTexture texture = {};
+				texture.fileName = packedTextureName;
+				ImportLoader::decodePackedTexture(uploader, packedFileNames, packLayout, texture);
+				int descriptorIndex = createAsyncTexture(texture, uploader);
+				uploader.flush();
+				publishTexture(packedTextureName, descriptorIndex, true);
+			}
+			printf("%s: %zu textures packed into %u layers of %ux%u\n", meshFileName.c_str(), packedFileNames.size(),
+				packLayout.layerCount, packLayout.layerWidth, packLayout.layerHeight);
+		}
+	}
 	// - Loop over textureNames and create textures for them
 	for (size_t i = 0; i < textureNames.size(); i++)
 	{
+		// Packed: every material, with or without texture, samples the texture array
+		if (!packedTextureName.empty())
+		{
+			materialToSamplerDescriptorSetIndex[i] = loadedTextures[packedTextureName];
+		}
 		// If material had no texture, set '0' to indicate no texture, texture 0 will be reserved for a default texture
-		if (textureNames[i].empty())
+		else if (textureNames[i].empty())
 		{
 			materialToSamplerDescriptorSetIndex[i] = 0;
 		}
+		else if (loadedTextures.count(textureNames[i]) > 0)
+		{
+			// Already loaded by an earlier import
+			materialToSamplerDescriptorSetIndex[i] = loadedTextures[textureNames[i]];
+		}
 		else
 		{
 			// Otherwise, create texture and set value to index of new texture
+			CPU_PROFILE_ZONE("createTexture");
 			materialToSamplerDescriptorSetIndex[i] = createTexture(textureNames[i]);
+			loadedTextures[textureNames[i]] = materialToSamplerDescriptorSetIndex[i];
+			importLoader.markTextureLoaded(textureNames[i]);
 		}
 	}
 
@@ -2010,14 +3216,467 @@ void VulkanRenderer::addNCreateImportMesh(std::string meshFileName, glm::mat4 in
 	// - Load in all our meshes
 	std::vector<Mesh> importMeshes = ImportMesh::LoadNode(mainDevice.physicalDevice, 
 		mainDevice.logicalDevice, graphicsQueue, graphicsCommandPool,
-		scene->mRootNode, scene, materialToSamplerDescriptorSetIndex);
+		scene->mRootNode, scene, materialToSamplerDescriptorSetIndex, importOptions, materialPlacements);
+	if (importOptions.batchByTexture)
+	{
+		printf("%s: %u meshes batched by texture into %zu draws\n", meshFileName.c_str(), scene->mNumMeshes, importMeshes.size());
+	}
 	// - Create mesh model and add to list
-	ImportMesh importMeshObj = ImportMesh(importMeshes, inModelMat);
-	importMeshList.push_back(importMeshObj);
+	addImportMesh(std::move(importMeshes), inModelMat, meshFileName);
 
 	//return this->importMeshList.size() - 1;
 }
 
+int VulkanRenderer::addImportMesh(std::vector<Mesh> meshes, glm::mat4 inModelMat, const std::string& meshFileName)
+{
+	importMeshList.push_back(ImportMesh(std::move(meshes), inModelMat));
+	importMeshFileNames.push_back(meshFileName);
+
+	int modelId = static_cast<int>(importMeshList.size()) - 1;
+	prepareImportMeshes(modelId);
+	assetWatcher.watch(ASSET_KIND_MESH, meshFileName, getMeshFilePath(meshFileName));
+
+	return modelId;
+}
+
+void VulkanRenderer::prepareImportMeshes(int modelId)
+{
+	// - Debug names, then the meshlet culling resources of the new meshes
+	ImportMesh& importMesh = importMeshList[modelId];
+	for (size_t i = 0; i < importMesh.getMeshCount(); i++)
+	{
+		if (DebugUtils::isEnabled())
+		{
+			importMesh.getMesh(i)->setDebugName(importMeshFileNames[modelId] + " mesh " + std::to_string(i));
+		}
+		allocateMeshletCullDescriptorSet(importMesh.getMesh(i));
+	}
+}
+
+ImportHandle VulkanRenderer::addNCreateImportMeshAsync(std::string meshFileName, glm::mat4 inModelMat)
+{
+	return requestImport(meshFileName, inModelMat, -1);
+}
+
+ImportHandle VulkanRenderer::requestImport(const std::string& meshFileName, glm::mat4 inModelMat, int reloadModelId)
+{
+	std::unique_ptr<AsyncImport> import(new AsyncImport());
+	import->handle = static_cast<ImportHandle>(importStatuses.size());
+	import->meshFileName = meshFileName;
+	import->modelMat = inModelMat;
+	import->reloadModelId = reloadModelId;
+	import->options = importOptions;
+
+	ImportHandle handle = import->handle;
+	importStatuses.push_back({ IMPORT_STATE_LOADING, -1 });
+	importLoader.request(std::move(import));
+
+	return handle;
+}
+
+ImportStatus VulkanRenderer::getImportStatus(ImportHandle handle)
+{
+	if (handle >= importStatuses.size())
+	{
+		throw std::runtime_error("Attempted to access invalid Import handle!");
+	}
+
+	return importStatuses[handle];
+}
+
+void VulkanRenderer::setImportFrameBudget(double milliseconds)
+{
+	importFrameBudgetMs = milliseconds;
+}
+
+void VulkanRenderer::setImportOptions(const ImportOptions& options)
+{
+	importOptions = options;
+}
+
+void VulkanRenderer::setHotReload(bool enabled)
+{
+	hotReloadEnabled = enabled;
+}
+
+void VulkanRenderer::processAsyncImports()
+{
+	CPU_PROFILE_ZONE("processAsyncImports");
+
+	for (auto& import : importLoader.takeLoaded())
+	{
+		if (!import->error.empty())
+		{
+			printf("Async import ERROR: %s\n", import->error.c_str());
+			importStatuses[import->handle].state = IMPORT_STATE_FAILED;
+			continue;
+		}
+		importStatuses[import->handle].state = IMPORT_STATE_UPLOADING;
+		uploadingImports.push_back(std::move(import));
+	}
+	if (uploadingImports.empty()) return;
+
+	// Work is done in small steps (1 texture image, 1 submit, 1 poll / finished import), no new step starts once the budget is spent.
+	// At least one step runs every frame so imports always make progress
+	auto start = std::chrono::steady_clock::now();
+	auto budgetLeft = [&]() {
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() < importFrameBudgetMs;
+	};
+
+	bool firstStep = true;
+	for (size_t i = 0; i < uploadingImports.size() && (firstStep || budgetLeft()); firstStep = false)
+	{
+		AsyncImport& import = *uploadingImports[i];
+
+		if (!import.submitted)
+		{
+			// TEXTURE: image + descriptor set, the copy is queued on the import's uploader
+			if (import.nextTexture < import.textures.size())
+			{
+				// Decoded twice when imports in flight at the same time share it, the first one keeps it
+				const DecodedTexture& texture = import.textures[import.nextTexture++];
+				if (loadedTextures.count(texture.fileName) == 0 && pendingTextures.count(texture.fileName) == 0)
+				{
+					import.createdTextures[texture.fileName] = createAsyncTexture(texture, *import.uploader);
+					pendingTextures.insert(texture.fileName);
+				}
+				continue;
+			}
+
+			// Mesh and texture copies in 1 submission, not waited for
+			import.uploader->submit();
+			import.submitted = true;
+			i++;
+			continue;
+		}
+
+		// Copies still running, checked again next frame
+		if (!import.uploader->poll())
+		{
+			i++;
+			continue;
+		}
+
+		// The textures this import created are resident now, other imports and addNCreateImportMesh() may use them
+		for (const auto& created : import.createdTextures)
+		{
+			publishTexture(created.first, created.second, created.first == import.packedTextureName);
+		}
+		import.createdTextures.clear();
+
+		// Textures shared with an import still copying them
+		if (!sharedTexturesReady(import))
+		{
+			i++;
+			continue;
+		}
+
+		finishAsyncImport(import);
+		uploadingImports.erase(uploadingImports.begin() + i);
+	}
+}
+
+int VulkanRenderer::createAsyncTexture(const DecodedTexture& texture, StagingUploader& uploader)
+{
+	VkDeviceMemory texImageMemory;
+	VkImage texImage = createImage(texture.width, texture.height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		&texImageMemory, MEMORY_CATEGORY_TEXTURES, texture.layerCount);
+	uploader.copyToImage(texture.region, texImage, texture.width, texture.height, texture.layerCount);	// Ends up SHADER_READ_ONLY_OPTIMAL, like createTextureImage()
+
+	textureImages.push_back(texImage);
+	textureImageMemory.push_back(texImageMemory);
+
+	// The image is UNDEFINED until the copy is done, the caller publishes the descriptor only then
+	return createTextureDescriptor(static_cast<int>(textureImages.size()) - 1, texture.fileName, texture.layerCount, texture.packed);
+}
+
+void VulkanRenderer::publishTexture(const std::string& fileName, int descriptorIndex, bool packed)
+{
+	pendingTextures.erase(fileName);
+	// addNCreateImportMesh() loaded it in the meantime: that one is resident already and stays, this copy goes unused
+	if (loadedTextures.count(fileName) > 0) return;
+
+	loadedTextures[fileName] = descriptorIndex;
+	importLoader.markTextureLoaded(fileName);
+
+	// Packed textures are named after their model, not a file: their sources aren't watched
+	if (!packed)
+	{
+		assetWatcher.watch(ASSET_KIND_TEXTURE, fileName, "../Textures/" + fileName);
+	}
+}
+
+bool VulkanRenderer::sharedTexturesReady(const AsyncImport& import)
+{
+	if (!import.packedTextureName.empty())
+	{
+		return pendingTextures.count(import.packedTextureName) == 0;
+	}
+	for (const std::string& fileName : import.materialTextures)
+	{
+		if (pendingTextures.count(fileName) > 0) return false;
+	}
+	return true;
+}
+
+void VulkanRenderer::finishAsyncImport(AsyncImport& import)
+{
+	CPU_PROFILE_ZONE("finishAsyncImport");
+
+	// Material index -> sampler descriptor set index, materials without texture use the default texture 0 (packed: its layer)
+	for (Mesh& mesh : import.meshes)
+	{
+		const std::string& materialTexture = import.materialTextures[mesh.getTextureIndex()];
+		const std::string& fileName = import.packedTextureName.empty() ? materialTexture : import.packedTextureName;
+		auto texture = loadedTextures.find(fileName);
+		mesh.setTextureIndex(fileName.empty() || texture == loadedTextures.end() ? 0 : texture->second);
+	}
+
+	if (import.reloadModelId >= 0)
+	{
+		replaceImportMeshes(import.reloadModelId, std::move(import.meshes));
+		importStatuses[import.handle].modelId = import.reloadModelId;
+	}
+	else
+	{
+		importStatuses[import.handle].modelId = addImportMesh(std::move(import.meshes), import.modelMat, import.meshFileName);
+	}
+	importStatuses[import.handle].state = IMPORT_STATE_READY;
+}
+
+void VulkanRenderer::processHotReload()
+{
+	CPU_PROFILE_ZONE("processHotReload");
+
+	assetWatcher.update();
+
+	for (const AssetChange& change : assetWatcher.takeChanges())
+	{
+		switch (change.kind)
+		{
+		case ASSET_KIND_MESH:
+			// Loaded again through the async import path, the meshes are swapped in once their copies are done
+			for (size_t i = 0; i < importMeshFileNames.size(); i++)
+			{
+				if (importMeshFileNames[i] == change.name)
+				{
+					printf("Hot reload: %s\n", change.name.c_str());
+					requestImport(change.name, importMeshList[i].getModel().model, static_cast<int>(i));
+				}
+			}
+			break;
+		case ASSET_KIND_TEXTURE:
+		{
+			printf("Hot reload: %s\n", change.name.c_str());
+			std::unique_ptr<TextureReload> reload(new TextureReload());
+			reload->texture.fileName = change.name;
+			importLoader.requestTextureReload(std::move(reload));
+			break;
+		}
+		case ASSET_KIND_SHADER:
+			reloadShader(change.name);
+			break;
+		}
+	}
+
+	processTextureReloads();
+}
+
+void VulkanRenderer::reloadShader(const std::string& fileName)
+{
+	if (!shaderCompiler.recompile(fileName)) return;
+
+	// Only the pipelines built from this shader are created again, a pipeline that fails keeps the old one in use
+	try
+	{
+		if (fileName == "shader.vert" || fileName == "shader.frag")
+		{
+			// Both color variants or neither, so they keep computing the same depth
+			VkPipeline newPipeline = createSubpass0Pipeline(false);
+			VkPipeline newDepthEqualPipeline;
+			try
+			{
+				newDepthEqualPipeline = createSubpass0Pipeline(true);
+			}
+			catch (const std::runtime_error&)
+			{
+				vkDestroyPipeline(mainDevice.logicalDevice, newPipeline, nullptr);
+				throw;
+			}
+			VkPipeline oldPipeline = graphicsPipeline;
+			VkPipeline oldDepthEqualPipeline = depthEqualGraphicsPipeline;
+			graphicsPipeline = newPipeline;
+			depthEqualGraphicsPipeline = newDepthEqualPipeline;
+			retire([this, oldPipeline, oldDepthEqualPipeline]() {
+				vkDestroyPipeline(mainDevice.logicalDevice, oldPipeline, nullptr);
+				vkDestroyPipeline(mainDevice.logicalDevice, oldDepthEqualPipeline, nullptr);
+			});
+		}
+		else if (fileName == "depth_prepass.vert")
+		{
+			VkPipeline newPipeline = createDepthPrepassPipeline();
+			VkPipeline oldPipeline = depthPrepassPipeline;
+			depthPrepassPipeline = newPipeline;
+			retire([this, oldPipeline]() { vkDestroyPipeline(mainDevice.logicalDevice, oldPipeline, nullptr); });
+		}
+		else if (fileName == "subpass1.vert" || fileName == "subpass1.frag")
+		{
+			// Every variant is built from the old source, only the one in use is created straight away
+			CompositeVariant variant = {};
+			variant.specialization = compositeSpecialization;
+			variant.pipeline = createCompositePipeline(compositeSpecialization);
+
+			std::vector<CompositeVariant> oldVariants = std::move(compositeVariants);
+			compositeVariants.clear();
+			compositeVariants.push_back(variant);
+			subpass1GraphicsPipeline = variant.pipeline;
+			retire([this, oldVariants = std::move(oldVariants)]() {
+				for (const CompositeVariant& oldVariant : oldVariants)
+				{
+					vkDestroyPipeline(mainDevice.logicalDevice, oldVariant.pipeline, nullptr);
+				}
+			});
+		}
+		else if (fileName == "meshlet_cull.comp" && meshletCullPipelineLayout != VK_NULL_HANDLE)
+		{
+			VkPipeline newPipeline = createMeshletCullComputePipeline();
+			VkPipeline oldPipeline = meshletCullPipeline;
+			meshletCullPipeline = newPipeline;
+			meshletCullingEnabled = true;		// Meshes made resident while it was disabled keep drawing without culling
+			retire([this, oldPipeline]() { vkDestroyPipeline(mainDevice.logicalDevice, oldPipeline, nullptr); });
+		}
+	}
+	catch (const std::runtime_error& e)
+	{
+		printf("Hot reload: %s pipeline not replaced: %s\n", fileName.c_str(), e.what());
+	}
+}
+
+void VulkanRenderer::processTextureReloads()
+{
+	for (auto& reload : importLoader.takeReloadedTextures())
+	{
+		if (!reload->error.empty())
+		{
+			printf("Hot reload ERROR: %s\n", reload->error.c_str());
+			continue;
+		}
+
+		// Image + copy now, the views and descriptor set are swapped once the copy is done
+		reload->image = createImage(reload->texture.width, reload->texture.height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&reload->imageMemory, MEMORY_CATEGORY_TEXTURES);
+		reload->uploader->copyToImage(reload->texture.region, reload->image, reload->texture.width, reload->texture.height);
+		reload->uploader->submit();
+		uploadingTextureReloads.push_back(std::move(reload));
+	}
+
+	for (size_t i = 0; i < uploadingTextureReloads.size();)
+	{
+		if (!uploadingTextureReloads[i]->uploader->poll())
+		{
+			i++;
+			continue;
+		}
+
+		finishTextureReload(*uploadingTextureReloads[i]);
+		uploadingTextureReloads.erase(uploadingTextureReloads.begin() + i);
+	}
+}
+
+void VulkanRenderer::finishTextureReload(TextureReload& reload)
+{
+	// Meshes keep their sampler descriptor set index, the objects behind it change. The image lists and samplerDescriptorSets share the index
+	auto loadedTexture = loadedTextures.find(reload.texture.fileName);
+	if (loadedTexture == loadedTextures.end())
+	{
+		// Watched but never registered (e.g. createTexture() outside of an import): no descriptor set to swap, the copy is done so
+		// the new image can go straight away
+		printf("Hot reload: %s isn't a loaded texture, not replaced\n", reload.texture.fileName.c_str());
+		vkDestroyImage(mainDevice.logicalDevice, reload.image, nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, reload.imageMemory);
+		reload.image = VK_NULL_HANDLE;
+		reload.imageMemory = VK_NULL_HANDLE;
+		return;
+	}
+	int index = loadedTexture->second;
+	VkImageView imageView = createImageView(reload.image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+	VkDescriptorSet descriptorSet = createSamplerDescriptorSet(imageView, textureSampler);		// Packed textures aren't watched
+
+	if (DebugUtils::isEnabled())
+	{
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE, reload.image, reload.texture.fileName);
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_IMAGE_VIEW, imageView, reload.texture.fileName);
+		DebugUtils::setObjectName(mainDevice.logicalDevice, VK_OBJECT_TYPE_DESCRIPTOR_SET, descriptorSet, reload.texture.fileName);
+	}
+
+	VkDescriptorSet oldDescriptorSet = samplerDescriptorSets[index];
+	VkImageView oldImageView = textureImageViews[index];
+	VkImage oldImage = textureImages[index];
+	VkDeviceMemory oldImageMemory = textureImageMemory[index];
+	samplerDescriptorSets[index] = descriptorSet;
+	textureImageViews[index] = imageView;
+	textureImages[index] = reload.image;
+	textureImageMemory[index] = reload.imageMemory;
+	reload.image = VK_NULL_HANDLE;
+	reload.imageMemory = VK_NULL_HANDLE;
+
+	retire([this, oldDescriptorSet, oldImageView, oldImage, oldImageMemory]() {
+		vkFreeDescriptorSets(mainDevice.logicalDevice, samplerDescriptorPool, 1, &oldDescriptorSet);
+		vkDestroyImageView(mainDevice.logicalDevice, oldImageView, nullptr);
+		vkDestroyImage(mainDevice.logicalDevice, oldImage, nullptr);
+		MemoryTracker::freeMemory(mainDevice.logicalDevice, oldImageMemory);
+	});
+}
+
+void VulkanRenderer::replaceImportMeshes(int modelId, std::vector<Mesh> meshes)
+{
+	// Always new buffers: overwriting the old ones in place would have to wait for the frames in flight
+	std::vector<Mesh> oldMeshes = importMeshList[modelId].replaceMeshes(std::move(meshes));
+	prepareImportMeshes(modelId);
+
+	retire([this, oldMeshes = std::move(oldMeshes)]() mutable {
+		for (Mesh& mesh : oldMeshes)
+		{
+			VkDescriptorSet cullDescriptorSet = mesh.getCullDescriptorSet();
+			if (cullDescriptorSet != VK_NULL_HANDLE)
+			{
+				vkFreeDescriptorSets(mainDevice.logicalDevice, meshletCullDescriptorPool, 1, &cullDescriptorSet);
+			}
+			mesh.destroyBuffers();
+		}
+	});
+}
+
+void VulkanRenderer::retire(std::function<void()> destroy)
+{
+	// Frames submitted so far may still use it, the next one won't
+	retiredResources.push_back({ submittedFrameCount, std::move(destroy) });
+}
+
+void VulkanRenderer::freeRetiredResources(bool all)
+{
+	// Frame slots are reused in order: once framesInFlight more frames were submitted, the frame slot being reused is past the retirement
+	while (!retiredResources.empty() &&
+		(all || submittedFrameCount >= retiredResources.front().retiredAtFrame + framesInFlight))
+	{
+		retiredResources.front().destroy();
+		retiredResources.pop_front();
+	}
+}
+
+void VulkanRenderer::getTextureFileSize(std::string fileName, int* outWidth, int* outHeight)
+{
+	int channels;
+	std::string fileLoc = "../Textures/" + fileName;
+	if (!stbi_info(fileLoc.c_str(), outWidth, outHeight, &channels))
+	{
+		throw std::runtime_error("Failed to load a Texture file! (" + fileName + ")");
+	}
+}
+
 stbi_uc* VulkanRenderer::loadTextureFile(std::string fileName, int* outWidth, int* outHeight, VkDeviceSize* outImageSize)
 {
 	// Number of channels image uses
@@ -2059,7 +3718,7 @@ void VulkanRenderer::createTestMesh()
 	//createImportMesh("Seahawk.obj", glm::mat4(1.0f));
 
 	// Default white texture
-	createTexture("white.jpg");
+	createTexture(DEFAULT_TEXTURE_FILE);
 }
 
 void VulkanRenderer::setupDebugMessenger()
@@ -2135,6 +3794,28 @@ std::vector<const char*> VulkanRenderer::getRequiredExtensions()
 		throw std::runtime_error("VkInstance does not support required extensions!");
 	}
 
+#ifdef ENABLE_DEBUG_UTILS
+	// Without validation, debug utils are still wanted for object names and labels in captures, but only if available
+	debugUtilsEnabled = validationLayers.enableValidationLayers;
+	if (!debugUtilsEnabled) {
+		std::vector<const char*> debugUtilsExtension = { VK_EXT_DEBUG_UTILS_EXTENSION_NAME };
+		if (checkInstanceExtensionSupport(&debugUtilsExtension)) {
+			instanceExtensionsRequired.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+			debugUtilsEnabled = true;
+		}
+	}
+#else
+	// Names and labels compiled out (Release): DebugUtils::isEnabled() stays false, every call is a branch
+	debugUtilsEnabled = false;
+#endif
+
+	// Memory budget queries go through vkGetPhysicalDeviceMemoryProperties2KHR (the instance is Vulkan 1.0), optional as well
+	std::vector<const char*> properties2Extension = { VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME };
+	physicalDeviceProperties2Enabled = checkInstanceExtensionSupport(&properties2Extension);
+	if (physicalDeviceProperties2Enabled) {
+		instanceExtensionsRequired.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
 	return instanceExtensionsRequired;
 }
 
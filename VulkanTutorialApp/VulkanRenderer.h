@@ -14,14 +14,26 @@
 #include <set>
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <deque>
 
 // A library to load in textures
 #include <stb_image.h>
 
 #include "Mesh.h"
 #include "ImportMesh.h"
+#include "ImportLoader.h"
 #include "Utility.h"
 #include "ValidationLayers.h"
+#include "PipelineCache.h"
+#include "ShaderCompiler.h"
+#include "GpuProfiler.h"
+#include "CpuProfiler.h"
+#include "DebugUtils.h"
+#include "JobSystem.h"
+#include "AssetWatcher.h"
 
 class VulkanRenderer
 {
@@ -35,35 +47,98 @@ public:
 
 	// Get func
 	VkExtent2D getSwapChainExtent();
+	std::string getDeviceName();
+	uint32_t getDrawCount();							// Draw calls recorded for the last frame, depth pre-pass excluded
+	uint32_t getDepthPrepassDrawCount();				// Depth pre-pass draw calls recorded for the last frame, 0 when it's off
+	uint32_t getTextureBindCount();						// Texture descriptor set binds recorded for the last frame
+	bool getGpuStats(const std::string& name, GpuStatSummary& outSummary);	// GPU timings / statistics, see GpuProfiler::getStats()
+	void resetGpuStats(size_t historySize);				// Start the GPU stats over from the next frame, keeping up to historySize frames
+	void collectGpuStats();								// Waits for the device, then reads back the frames still in flight
 
 	// Set Func
 	void updateModel(int modelId, glm::mat4 ModelInput);
 	//void setViewProjection(const UboViewProjection& inVP);
 	void setViewProjectionMat(const glm::mat4& viewMat, const glm::mat4& projectionMat);
+	void setDebugViewMode(DebugViewMode mode);
+	void setLatencyProfile(LatencyProfile profile);		// Call before init(), sizes the per frame resources
+	void setProfileDrawGroups(bool enabled);			// GPU timings per ImportMesh draw group, on top of the per pass timings
+	void setPipelineStatistics(bool enabled);			// Call before init(), overdraw / vertex reuse per subpass when the device supports it
+	// Depth pre-pass before subpass 0, takes effect from the next frame. Only pays off when the scene overdraws enough that the
+	// fragments saved in subpass 0 outweigh drawing the geometry twice: compare "Subpass 0 FS invocations" with and without
+	void setDepthPrepass(bool enabled);
+	// Frame pacing
+	void waitForFrameSlot();							// Blocks until the next frame slot is free, call before sampling input
+	void markInputSampled();							// Input for the next draw() was sampled now
 	void setMeshList(std::vector<Mesh>& meshList);
 	// - Set mesh data
 	void setMeshVertexData(const std::vector<std::vector<Vertex>>& inMeshVertices);
 	void setMeshIndicesData(const std::vector<std::vector<uint32_t>>& inMeshIndices);
 	void addTextureFileName(const std::string& fileName);
 
-	//
+	// meshFileName is relative to ../ImportObj/ or an absolute path, see getMeshFilePath()
 	void addNCreateImportMesh(std::string meshFileName, glm::mat4 inModelMat);
+	// Returns straight away: parsing, decoding and conversion run on the loader thread, the copies are polled by draw().
+	// The model only enters importMeshList (and gets its modelId) once its GPU data is resident
+	ImportHandle addNCreateImportMeshAsync(std::string meshFileName, glm::mat4 inModelMat);
+	ImportStatus getImportStatus(ImportHandle handle);
+	void setImportFrameBudget(double milliseconds);		// Render thread time per frame spent on async imports, IMPORT_FRAME_BUDGET_MS by default
+	void setImportOptions(const ImportOptions& options);	// Used by the imports requested after this call (hot reloads included)
+	// Hot reload: meshes, textures and shaders are watched for changes and replaced while running. Replaced resources are
+	// freed once the frames in flight are done with them, nothing waits for the device
+	void setHotReload(bool enabled);
+
+	// Loader Function
+	// - Decodes ../Textures/fileName to RGBA8, free with stbi_image_free()
+	static stbi_uc* loadTextureFile(std::string fileName, int* outWidth, int* outHeight, VkDeviceSize* outImageSize);
+	// - Size of ../Textures/fileName from its header, nothing is decoded
+	static void getTextureFileSize(std::string fileName, int* outWidth, int* outHeight);
 
 
 private:
 	GLFWwindow* window;
 
-	int currentFrame = 0; // keep track of the loop of frame, increment with each frame drawn, when it reaches 2, start from 0 again
+	int currentFrame = 0; // keep track of the loop of frame, increment with each frame drawn, when it reaches framesInFlight, start from 0 again
+
+	// Latency
+	LatencyProfile latencyProfile = LATENCY_PROFILE_DEFAULT;
+	uint32_t framesInFlight = 2;						// Number of per frame resource sets, from the latency profile
+	std::chrono::steady_clock::time_point inputSampleTime;
+	LatencyStats latencyStats;
+	uint32_t latencyFrameCount = 0;
+
+	// GPU timings
+	GpuProfiler gpuProfiler;
+	uint32_t drawCount = 0;
+	uint32_t prepassDrawCount = 0;
+	uint32_t textureBindCount = 0;
+	bool profileDrawGroups = false;
+	bool pipelineStatisticsRequested = false;
+	bool pipelineStatisticsEnabled = false;				// Requested and the pipelineStatisticsQuery feature is on
 
 	// Assets
 	// - Import Mesh
 	std::vector<ImportMesh> importMeshList;				// This is populated by addNCretaeImportMesh(), which is called from main()
+	// - Asynchronous imports
+	ImportLoader importLoader;
+	std::vector<std::unique_ptr<AsyncImport>> uploadingImports;		// Loaded, turned into GPU resources by processAsyncImports()
+	std::vector<ImportStatus> importStatuses;						// Indexed by ImportHandle
+	double importFrameBudgetMs = IMPORT_FRAME_BUDGET_MS;
+	ImportOptions importOptions;
+	std::vector<std::string> importMeshFileNames;					// Source file of each entry of importMeshList
+	// - Hot reload
+	bool hotReloadEnabled = false;
+	AssetWatcher assetWatcher;										// Every loaded mesh, texture and shader is watched, only polled when enabled
+	std::vector<std::unique_ptr<TextureReload>> uploadingTextureReloads;	// Decoded, waiting for their copy before the swap
+	uint64_t submittedFrameCount = 0;
+	std::deque<RetiredResource> retiredResources;					// Oldest first
 	// -- Meshes
 	std::vector<std::vector<Vertex>> meshVertexData;
 	std::vector<std::vector<uint32_t>> meshIndicesData;
 	std::vector<Mesh> meshList;
 	// -- Textures
 	std::vector<std::string> textureFileNameList;		// Store the fileName of the pictures to be loaded by addTextureFileName()
+	std::map<std::string, int> loadedTextures;			// Texture fileName -> sampler descriptor set index, textures shared by several imports are loaded once
+	std::set<std::string> pendingTextures;				// Created by an async import whose copies aren't done, not in loadedTextures yet
 	std::vector<VkImage> textureImages;					// Hold all the textureImages created from createTextureImage();
 	std::vector<VkDeviceMemory> textureImageMemory;		// Hold all the imageMemory created from createTextureImage();
 	std::vector<VkImageView>textureImageViews;
@@ -81,18 +156,32 @@ private:
 	VkQueue graphicsQueue;
 	VkQueue presentationQueue;
 	VkSurfaceKHR surface;		// A CHRONOS extension
-	VkSwapchainKHR swapchain;
-	std::vector<SwapChainImage> swapChainImages;		// swap chain holds multiple images, // [important]: commandBuffers[0] must correspond to swapChainFramebuffers[0], and then swapChainImages[0], index must be the same
-	std::vector<VkCommandBuffer> commandBuffers;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	bool framebufferResized = false;					// Set by the GLFW resize callback, the swapchain is recreated after the next present
+	std::vector<SwapChainImage> swapChainImages;		// swap chain holds multiple images
+	std::vector<VkFence> imagesInFlight;				// Per swapchain image, fence of the frame last rendering to it (VK_NULL_HANDLE if none)
+	// - Frames in flight
+	std::vector<FrameContext> frames;					// framesInFlight entries, indexed by currentFrame
 	// - FrameBuffer
-	std::vector<VkFramebuffer> swapChainFramebuffers;
+	std::vector<VkFramebuffer> swapChainFramebuffers;		// [frame in flight * swapChainImages.size() + swapchain image]
 	// - Render Pass
 	VkRenderPass renderPass;
 	// -- Pipeline
+	ShaderCompiler shaderCompiler;							// GLSL sources compiled at startup, SPIR-V cached on disk
+	PipelineCache pipelineCache;							// Persisted to PIPELINE_CACHE_FILE, used for every pipeline creation
 	VkPipeline graphicsPipeline;
+	VkPipeline depthEqualGraphicsPipeline;					// Subpass 0 after the depth pre-pass: EQUAL depth test, no depth write
+	VkPipeline depthPrepassPipeline;						// Position only, no fragment shader
+	bool depthPrepassEnabled = false;
 	VkPipelineLayout pipelineLayout;
-	VkPipeline subpass1GraphicsPipeline;
+	VkPipeline subpass1GraphicsPipeline;					// Composite variant in use, owned by compositeVariants
 	VkPipelineLayout subpass1PipelineLayout;
+	CompositeSpecialization compositeSpecialization;		// Specialization constants of the variant in use
+	std::vector<CompositeVariant> compositeVariants;		// Every composite variant built so far
+	// -- Meshlet Culling (compute pass before the render pass)
+	bool meshletCullingEnabled = false;						// False when the graphics queue can't run compute or the shader is missing
+	VkPipeline meshletCullPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout meshletCullPipelineLayout = VK_NULL_HANDLE;
 	// --- FrameBuffer Attachment ( Depth Buffers )							// Will be the input of Frame buffer
 	VkFormat depthBufferImageFormat;										// Assigned in createRenderPass();
 	std::vector<VkImage> depthBufferImage;									// Assigned in createDepthBufferImage(); // The reason why we need multiple subpasses is that we are using multi subpasses. So, for each subpass we would need to output a color attachment as well as a depth attachment to be taken over by the next subpass
@@ -104,13 +193,9 @@ private:
 	std::vector<VkDeviceMemory> colorBufferImageMemory;
 	std::vector<VkImageView> colorBufferImageView;
 
-	// - Push Constants 
-	VkPushConstantRange pushConstantRange;				// This describes the size of the data passed to push constant
-														
 	// - Descriptor Sets
 	VkDescriptorSetLayout descriptorSetLayout;				// set the binding
 	VkDescriptorPool descriptorPool;						// to hold data of Descriptor Sets
-	std::vector<VkDescriptorSet> descriptorSets;			// 1 descriptor set for one uniform buffer
 	// - Sampler Descriptor Set
 	VkDescriptorSetLayout samplerDescriptorSetLayout;
 	VkDescriptorPool samplerDescriptorPool;
@@ -118,33 +203,29 @@ private:
 	// - Subpass Input Descriptor Set
 	VkDescriptorSetLayout subpassInputSetLayout;
 	VkDescriptorPool subpassInputDescriptorPool;
-	std::vector<VkDescriptorSet> subpassInputDescritporSets;			// 1 descriptor set for one swapchain Image
+	std::vector<VkDescriptorSet> subpassInputDescritporSets;			// 1 descriptor set for one frame in flight
+	// - Meshlet Culling Descriptor Set
+	VkDescriptorSetLayout meshletCullSetLayout;
+	VkDescriptorPool meshletCullDescriptorPool;						// 1 descriptor set per mesh, the frame slot is picked with a dynamic offset
 	
-	// Uniform Buffer
-	std::vector<VkBuffer> vpUniformBuffer;					// 1 uniformBuffer for each swapchain image
-	std::vector<VkDeviceMemory> vpUniformBufferMemory;	
-	std::vector<VkBuffer> mUniformBufferDynamic;
-	std::vector<VkDeviceMemory> mUniformBufferMemory;
+	// Uniform Buffer (1 set per frame in flight, held by the FrameContext)
 	// -- Dynamic Uniform Buffer
 	VkDeviceSize minUniformBufferOffset;
+	VkDeviceSize minStorageBufferOffset;
 	size_t modelUniformAlignment;
 	Model* modelTransferSpace;
 
 	// Texture Sampler
 	VkSampler textureSampler;	
+	VkSampler packedTextureSampler;			// Packed texture arrays, anisotropy limited to what TEXTURE_ATLAS_GUTTER covers
 	
 	// - Pools
-	VkCommandPool graphicsCommandPool;			//this pool is only used for graphics queue
+	VkCommandPool graphicsCommandPool;			//this pool is only used for graphics queue, one-off transfer commands (frames record from their own pools)
 
 	// - utility
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 
-	// - synchronization
-	std::vector<VkSemaphore> semaphoreImageAvailable;		//signal for image available
-	std::vector<VkSemaphore> semaphoreFinishRender;			//signal for image done drawing
-	std::vector<VkFence> drawFences;
-
 	// - validation layers
 	ValidationLayers validationLayers;
 
@@ -152,6 +233,9 @@ private:
 	// -- create debug messenger ext
 	// -- destroy debug messenger ext
 	VkDebugUtilsMessengerEXT debugMessenger;
+	bool debugUtilsEnabled = false;						// VK_EXT_debug_utils enabled on the instance for names / labels (ENABLE_DEBUG_UTILS), see DebugUtils
+	bool physicalDeviceProperties2Enabled = false;		// VK_KHR_get_physical_device_properties2 enabled on the instance, needed for the memory budget
+	bool memoryBudgetEnabled = false;					// VK_EXT_memory_budget enabled on the device, see MemoryTracker
 
 	// - Functions
 	void setupDebugMessenger();
@@ -170,28 +254,69 @@ private:
 	void createLogicalDevice();
 	void createSuface();
 	void createSwapChain();
+	void recreateSwapChain();
+	void destroySwapChainResources();
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 	void createRenderPass();
 	void createDescriptorSetLayout();
-	void createPushConstantRange();
+	void compileShaders();
+	void createPipelineCache();
 	void createGraphicsPipeline();
+	VkPipeline createSubpass0Pipeline(bool afterDepthPrepass);
+	VkPipeline createDepthPrepassPipeline();
+	void createMeshletCullPipeline();
+	VkPipeline createMeshletCullComputePipeline();
+	VkPipeline getCompositePipeline(const CompositeSpecialization& specialization);
+	VkPipeline createCompositePipeline(const CompositeSpecialization& specialization);
 	void createDepthBufferImage();
 	void createColorBufferImage();
 	void createFramebuffer();
+	VkFramebuffer getFramebuffer(uint32_t swapchainImageIndex);		// Framebuffer of the current frame's attachments + the given swapchain image
 	void createCommandPool();
-	void allocateCommandBuffers();
-	void createSynchronization();
+	void createFrameContexts();
+	void createGpuProfiler();
+	void destroyFrameContexts();
 	void createTextureSampler();
+	VkSampler createSampler(float maxAnisotropy);
 	void createUniformBuffers();
 	void createDescriptorPool();
 	void allocateDescriptorSets();
 	void allocateSubpassInputDescriptorSets();
+	void updateSubpassInputDescriptorSets();
+	void allocateMeshletCullDescriptorSet(Mesh* mesh);
 		void createTestMesh();
 
 	// - Record commandBuffer
 	void recordCommands(uint32_t swapchainImageIndex);
+	void recordMeshDraw(VkCommandBuffer commandBuffer, Mesh* mesh);	// Vertex / index buffers + draw of the LOD picked (or the culled meshlets)
+
+	// - Level of detail
+	int selectMeshLod(Mesh* mesh, const glm::mat4& modelMat);
+
+	// - Meshlet culling
+	void recordMeshletCulling(VkCommandBuffer commandBuffer);
+
+	// - Asynchronous imports
+	void processAsyncImports();
+	int createAsyncTexture(const DecodedTexture& texture, StagingUploader& uploader);	// Returns the sampler descriptor set index
+	void publishTexture(const std::string& fileName, int descriptorIndex, bool packed);	// Only once the texture's copy is done
+	bool sharedTexturesReady(const AsyncImport& import);
+	void finishAsyncImport(AsyncImport& import);
+	int addImportMesh(std::vector<Mesh> meshes, glm::mat4 inModelMat, const std::string& meshFileName);	// Returns the modelId
+	ImportHandle requestImport(const std::string& meshFileName, glm::mat4 inModelMat, int reloadModelId);
+	void prepareImportMeshes(int modelId);							// Debug names + meshlet culling resources of a new mesh list
+
+	// - Hot reload
+	void processHotReload();
+	void reloadShader(const std::string& fileName);
+	void processTextureReloads();
+	void finishTextureReload(TextureReload& reload);
+	void replaceImportMeshes(int modelId, std::vector<Mesh> meshes);
+	void retire(std::function<void()> destroy);						// Destroyed once no frame in flight can use it anymore
+	void freeRetiredResources(bool all);
 
 	// - Update Uniform Buffer
-	void updateUniformBuffers(uint32_t nextSwapChainImageIndex);
+	void updateUniformBuffers(const FrameContext& frame);
 
 	// - Get Functions
 	void getPhysicalDevice();
@@ -211,23 +336,27 @@ private:
 
 	// -- choose best setting for swapchain
 	VkSurfaceFormatKHR chooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats);
+	void recordSubmitToPresent(int frame);
+	void reportLatency();
 	VkPresentModeKHR chooseBestPresentationMode(const std::vector<VkPresentModeKHR>& modes);
 	VkExtent2D chooseSwapChainExtent(const VkSurfaceCapabilitiesKHR& surfaceCapabilities);
 	VkFormat chooseSupportedFormat(const std::vector<VkFormat>& inFormats, VkImageTiling tiling, 
 		VkFormatFeatureFlags featureFlags);
 
 	// -- create 
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
-	VkShaderModule createShaderModule(const std::vector<char>& code);
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+		VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D, uint32_t layerCount = 1);
+	VkShaderModule createShaderModule(const std::vector<uint32_t>& code);
 	VkImage createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-		VkImageUsageFlags useFlags, VkMemoryPropertyFlags propertyFlags, VkDeviceMemory* outImageMemory);
+		VkImageUsageFlags useFlags, VkMemoryPropertyFlags propertyFlags, VkDeviceMemory* outImageMemory, MemoryCategory category,
+		uint32_t arrayLayers = 1);
 	int createTextureImage(std::string fileName);
 	int createTexture(std::string fileName);
-	int allocateTextureDescriptorSet(VkImageView textureImage);
+	// Image view + sampler descriptor set of a texture image. Every texture is sampled as a texture array, packed ones with packedTextureSampler
+	int createTextureDescriptor(int textureImageIndex, const std::string& fileName, uint32_t layerCount = 1, bool packed = false);
+	int allocateTextureDescriptorSet(VkImageView textureImage, VkSampler sampler);
+	VkDescriptorSet createSamplerDescriptorSet(VkImageView textureImage, VkSampler sampler);	// Allocated and written, not added to samplerDescriptorSets
 	
 
-	// -- Loader Function
-	stbi_uc* loadTextureFile(std::string fileName, int* outWidth, int* outHeight, VkDeviceSize* outImageSize);
-
 };
 
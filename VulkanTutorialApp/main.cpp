@@ -22,13 +22,31 @@ void initWindow(std::string wName = "Test Window", const int width = 800, const
 
 	//set glfw to not work with opengl
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 }
 
+// View Projection matrices, the aspect ratio follows the swapchain size
+void setCameraMatrices(uint32_t width, uint32_t height) {
+	glm::mat4 projectionMat = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
+	projectionMat[1][1] *= -1;
+	glm::mat4 viewMat = glm::lookAt(glm::vec3(0.0f, 10.0f, 15.0), glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	vulkanRenderer.setViewProjectionMat(viewMat, projectionMat);
+}
+
 // Update uniform every frame
 void update() {
+	CPU_PROFILE_ZONE("update");
+
+	// Window got resized, the swapchain was recreated in the last draw()
+	static VkExtent2D lastExtent = vulkanRenderer.getSwapChainExtent();
+	VkExtent2D extent = vulkanRenderer.getSwapChainExtent();
+	if (extent.width != lastExtent.width || extent.height != lastExtent.height)
+	{
+		setCameraMatrices(extent.width, extent.height);
+		lastExtent = extent;
+	}
 
 	static float angle = 0.0f;
 	angle += 1.0f * getDeltaTime();
@@ -73,24 +91,49 @@ void createTestMesh() {
 	//vulkanRenderer.setMeshIndicesData(meshIndicesList);
 
 	// View Projection matrices
-	int width, height;
-	glfwGetWindowSize(window, &width, &height);
-	glm::mat4 projectionMat = glm::perspective(glm::radians(45.0f), (float)width / (float)height, 0.1f, 100.0f);
-	projectionMat[1][1] *= -1;
-	glm::mat4 viewMat = glm::lookAt(glm::vec3(0.0f, 10.0f, 15.0), glm::vec3(0.0f, 0.0f, -4.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-	vulkanRenderer.setViewProjectionMat(viewMat, projectionMat);
+	VkExtent2D extent = vulkanRenderer.getSwapChainExtent();
+	setCameraMatrices(extent.width, extent.height);
+
+	// Model Matrix and Init Import Mesh, loaded in the background: the window is responsive straight away and the model shows up once resident
+	vulkanRenderer.addNCreateImportMeshAsync("Old House 2 3D Models.obj", glm::mat4(1.0f));
 
-	// Model Matrix and Init Import Mesh
-	vulkanRenderer.addNCreateImportMesh("Old House 2 3D Models.obj", glm::mat4(1.0f));
+}
 
+// Latency profile from the command line: --latency=low | --latency=throughput (anything else keeps the fixed default)
+LatencyProfile parseLatencyProfile(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--latency=low") return LATENCY_PROFILE_LOW_LATENCY;
+		if (arg == "--latency=throughput") return LATENCY_PROFILE_THROUGHPUT;
+	}
+	return LATENCY_PROFILE_DEFAULT;
 }
 
-void init() {
+// Render thread budget for async imports from the command line: --import-budget-ms=<milliseconds per frame>
+double parseImportFrameBudget(int argc, char** argv) {
+	const std::string prefix = "--import-budget-ms=";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.compare(0, prefix.size(), prefix) == 0) return std::stod(arg.substr(prefix.size()));
+	}
+	return IMPORT_FRAME_BUDGET_MS;
+}
+
+// True when the flag was passed on the command line
+bool hasArgument(int argc, char** argv, const std::string& flag) {
+	for (int i = 1; i < argc; i++) {
+		if (flag == argv[i]) return true;
+	}
+	return false;
+}
+
+void init(LatencyProfile latencyProfile) {
 
 	//create window
 	initWindow("Test WIndow", 1600, 900);
 
 	//create vulkan renderer instance
+	vulkanRenderer.setLatencyProfile(latencyProfile);
 	if (vulkanRenderer.init(window) == EXIT_FAILURE)
 	{
 		//return EXIT_FAILURE;
@@ -99,13 +142,27 @@ void init() {
 	createTestMesh();
 }
 
-int main() {
+int main(int argc, char** argv) {
 
-	init();
+	vulkanRenderer.setProfileDrawGroups(hasArgument(argc, argv, "--profile-draw-groups"));
+	vulkanRenderer.setPipelineStatistics(hasArgument(argc, argv, "--pipeline-stats"));
+	vulkanRenderer.setDepthPrepass(hasArgument(argc, argv, "--depth-prepass"));
+	vulkanRenderer.setImportFrameBudget(parseImportFrameBudget(argc, argv));
+	vulkanRenderer.setHotReload(hasArgument(argc, argv, "--hot-reload"));
+	ImportOptions importOptions;
+	importOptions.batchByTexture = hasArgument(argc, argv, "--batch-meshes");
+	importOptions.packTextures = hasArgument(argc, argv, "--pack-textures");
+	vulkanRenderer.setImportOptions(importOptions);
+	JobSystem::init(0, hasArgument(argc, argv, "--pin-threads"));
+	init(parseLatencyProfile(argc, argv));
 
 	while (!glfwWindowShouldClose(window)) {
+		CPU_PROFILE_ZONE("Frame");
 
+		// Wait for a free frame slot before sampling input, so input is as fresh as possible when it is submitted
+		vulkanRenderer.waitForFrameSlot();
 		glfwPollEvents();
+		vulkanRenderer.markInputSampled();
 
 		update();
 		vulkanRenderer.draw();
@@ -113,6 +170,11 @@ int main() {
 	
 	//free memory
 	vulkanRenderer.cleanup();
+	JobSystem::shutdown();
+
+	// CPU zones of the last frames (and of the import)
+	CpuProfiler::exportChromeTrace(CPU_TRACE_FILE);
+	CpuProfiler::exportFoldedStacks(CPU_FOLDED_FILE);
 
 	glfwDestroyWindow(window);
 	glfwTerminate();
@@ -1,5 +0,0 @@
-E:/ZHENG/C++/VulkanStudy/VulaknBin32/glslangValidator.exe -V shader.vert
-E:/ZHENG/C++/VulkanStudy/VulaknBin32/glslangValidator.exe -V shader.frag
-E:/ZHENG/C++/VulkanStudy/VulaknBin32/glslangValidator.exe -o subpass1_vert.spv -V subpass1.vert
-E:/ZHENG/C++/VulkanStudy/VulaknBin32/glslangValidator.exe -o subpass1_frag.spv -V subpass1.frag
-pause
\ No newline at end of file
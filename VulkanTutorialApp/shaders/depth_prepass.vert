@@ -0,0 +1,24 @@
+#version 450 		// Use GLSL 4.5
+
+// Position only version of shader.vert for the depth pre-pass. gl_Position has to come out bit for bit the same as in shader.vert
+// (same expression, invariant in both), the color subpass tests its depth with EQUAL against what this pass wrote
+
+// - INPUT
+// -- Attributes
+layout (location = 0) in vec3 pos;
+// -- Uniform
+layout (set = 0, binding = 0) uniform UboViewProjection{
+	mat4 projection;
+	mat4 view;
+}uboViewProjection;
+layout (set = 0 ,binding = 1) uniform UboModel{
+	mat4 model;
+}uboModel;
+
+// - OUTPUT
+invariant gl_Position;
+
+void main() {
+	gl_Position = uboViewProjection.projection * uboViewProjection.view* 
+	uboModel.model* vec4(pos, 1.0);
+}
@@ -5,16 +5,18 @@
 // INTPUT
 // - Varying
 layout (location = 0) in vec3 col_vsOut;
-layout (location = 9) in vec3 pushData_vsOut;
 layout (location = 1) in vec2 uv_vsOut;
 // - Uniform
-layout (set = 1, binding = 0) uniform sampler2D textureSampler;
+layout (set = 1, binding = 0) uniform sampler2DArray textureSampler;	// 1 layer unless the model's textures are packed
+// - Push constant
+layout (push_constant) uniform DrawPushConst {
+	uint textureLayer;
+} drawPushConst;
 
 
 // OUTPUT
 layout (location = 0) out vec4 outColour; 	// Final output colour (must also have location
 
 void main() {
-	//outColour = vec4(col_vsOut * pushData_vsOut.x, 1.0);
-	outColour = texture(textureSampler, uv_vsOut);
+	outColour = texture(textureSampler, vec3(uv_vsOut, drawPushConst.textureLayer));
 }
\ No newline at end of file
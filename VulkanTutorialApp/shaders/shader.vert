@@ -13,20 +13,15 @@ layout (set = 0, binding = 0) uniform UboViewProjection{		// Binding should matc
 layout (set = 0 ,binding = 1) uniform UboModel{			// Not int use, only shown as an example, will be discarded in shader compilation
 	mat4 model;
 }uboModel;
-// -- Push Constant
-layout (push_constant) uniform PushConstBlock{
-	vec3 pushData;
-}pushConstBlock;
 
 // - OUTPUT
 layout (location = 0) out vec3 col_vsOut;
-layout (location = 9) out vec3 pushData_vsOut;
 layout (location = 1) out vec2 uv_vsOut;
+invariant gl_Position;								// Same depth as depth_prepass.vert, the color subpass tests it with EQUAL after the pre-pass
 
 void main() { //main() could be renamed whatever in vk, since we can specify the function to call in shader, but for a good practice better stick with convention
 	gl_Position = uboViewProjection.projection * uboViewProjection.view* 
 	uboModel.model* vec4(pos, 1.0);
 	col_vsOut = col;
-	//pushData_vsOut = pushConstBlock.pushData;
 	uv_vsOut = uv;
 }
\ No newline at end of file
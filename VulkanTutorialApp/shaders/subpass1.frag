@@ -3,23 +3,38 @@
 layout(input_attachment_index = 0, binding = 0) uniform subpassInput inputColour; // Colour output from subpass 1
 layout(input_attachment_index = 1, binding = 1) uniform subpassInput inputDepth;  // Depth output from subpass 1
 
+// Specialization constants, set per pipeline variant (CompositeSpecialization in Utility.h) so the unused paths compile out
+layout(constant_id = 0) const int DEBUG_VIEW_MODE = 0;			// 0: colour, 1: split colour | depth, 2: depth
+layout(constant_id = 1) const float SPLIT_FRACTION = 0.5;		// Screen split as a fraction of the framebuffer width
+layout(constant_id = 2) const float DEPTH_LOWER_BOUND = 0.98;
+layout(constant_id = 3) const float DEPTH_UPPER_BOUND = 1.0;
+
+// Framebuffer width, pushed every frame so resizing does not need a new pipeline (CompositePushConst in Utility.h)
+layout(push_constant) uniform PushConst {
+	float framebufferWidth;
+} pushConst;
+
 layout(location = 0) out vec4 colour;
 
+vec4 depthColour()
+{
+	float depth = subpassLoad(inputDepth).r;
+	float depthColourScaled = 1.0f - ((depth - DEPTH_LOWER_BOUND) / (DEPTH_UPPER_BOUND - DEPTH_LOWER_BOUND));
+	return vec4(vec3(depthColourScaled), 1.0f);
+}
+
 void main()
 {
-	int xHalf = 1366/2;
-	if(gl_FragCoord.x > xHalf)
+	if (DEBUG_VIEW_MODE == 0)
+	{
+		colour = subpassLoad(inputColour).rgba;
+	}
+	else if (DEBUG_VIEW_MODE == 2 || gl_FragCoord.x > SPLIT_FRACTION * pushConst.framebufferWidth)
 	{
-		float lowerBound = 0.98;
-		float upperBound = 1;
-		
-		float depth = subpassLoad(inputDepth).r;
-		float depthColourScaled = 1.0f - ((depth - lowerBound) / (upperBound - lowerBound));
-		//colour = vec4(subpassLoad(inputColour).rgb * depthColourScaled, 1.0f);
-		colour = vec4(vec3(depthColourScaled), 1.0f);
+		colour = depthColour();
 	}
 	else
 	{
 		colour = subpassLoad(inputColour).rgba;
 	}
-}
\ No newline at end of file
+}